@@ -0,0 +1,743 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+// Benchmark harness for the shell's hot paths
+// Links the shell's object files (everything except shell.o) and drives the
+// same functions the REPL calls. Results go to a JSON file, one benchmark
+// per line, which "bench -c old.json new.json" compares.
+//
+// Usage: bench [-o file] [-n samples] [-t ms] [-f filter]
+//        bench -c base.json new.json
+
+#include "parser.h"
+#include "executor.h"
+#include "builtins.h"
+#include "jobs.h"
+#include "signals.h"
+#include "history.h"
+#include "eventloop.h"
+#include "jobqueue.h"
+#include "iobatch.h"
+#include "utils.h"
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+#define MAX_SAMPLES 1000
+#define CAT_FILES 1000        // Files in the cat / ls dataset
+#define CAT_FILE_SIZE 4096
+#define RM_DIRS 10            // rm -r dataset: RM_DIRS x RM_FILES files
+#define RM_FILES 100
+#define RM_DEPTH 1000         // rm -r deep dataset: nested directories, one file each
+#define BIG_FILE_SIZE (32 << 20)  // Pipeline throughput input
+#define JOBS_AT_SCALE 10000   // Jobs added and reaped per operation
+#define BG_JOBS 64            // Real background jobs launched per operation
+#define HISTORY_LINES 1000
+
+// A benchmark runs op() repeatedly
+// Without prepare() ops are timed in calibrated batches; with it each op is
+// timed on its own and prepare() runs untimed before it (for ops that
+// consume their input, like rm -r)
+typedef struct {
+    const char *name;
+    void (*op)(void);
+    void (*prepare)(void);
+    long bytes_per_op;        // For throughput (0 if not meaningful)
+    IoBackend backend;        // I/O backend the op runs with
+} Benchmark;
+
+typedef struct {
+    double min, median, mean, stddev, p95, ci95;
+    long ops;                 // Ops per sample
+    int samples;
+} Stats;
+
+static char data_dir[] = "/tmp/myshell-bench-XXXXXX";
+static char files_dir[64];
+static char tree_dir[64];
+static char deep_dir[64];
+static char big_file[64];
+static char **cat_argv;       // cat <every file in files_dir>
+
+static int num_samples = 20;
+static double min_sample_ns = 50e6;
+
+// Monotonic clock in nanoseconds
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Keep the compiler from discarding results
+static volatile long sink;
+
+// ---- Benchmarked operations ----
+
+// Representative input lines: plain commands, redirections, pipelines, prefixes
+static const char *const lines[] = {
+    "ls -la /usr/bin",
+    "echo hello world > out.txt",
+    "cat < input.txt | grep -v foo | sort | uniq -c | sort -rn > counts.txt",
+    "timeout -k 5 30s capture make -j8 all &",
+    "sched -c 0-3 -n 10 ./run --iterations 1000 --output /tmp/result.json",
+    "export PATH=/usr/local/bin:/usr/bin:/bin",
+    "find . -name '*.c' | xargs wc -l | tail -n 1",
+    "wait -n",
+};
+#define NUM_LINES (sizeof(lines) / sizeof(lines[0]))
+static long lines_bytes;
+
+static void op_tokenize(void) {
+    char buf[MAX_INPUT_SIZE];
+    for (size_t i = 0; i < NUM_LINES; i++) {
+        strcpy(buf, lines[i]);
+        char **tokens = NULL;
+        int count = tokenize(buf, &tokens);
+        sink += count;
+        free_tokens(tokens, count);
+    }
+}
+
+static void op_parse(void) {
+    char buf[MAX_INPUT_SIZE];
+    for (size_t i = 0; i < NUM_LINES; i++) {
+        strcpy(buf, lines[i]);
+        char **tokens = NULL;
+        int count = tokenize(buf, &tokens);
+        Pipeline pipeline;
+        if (parse_pipeline(tokens, &pipeline) == 0) {
+            sink += pipeline.num_commands;
+            free_pipeline(&pipeline);
+        }
+        free_tokens(tokens, count);
+    }
+}
+
+// Parse and run a command line the way the REPL does
+static void run_line(const char *line) {
+    char buf[MAX_INPUT_SIZE];
+    snprintf(buf, sizeof(buf), "%s", line);
+    char **tokens = NULL;
+    int count = tokenize(buf, &tokens);
+    if (count <= 0) {
+        free_tokens(tokens, count < 0 ? 0 : count);
+        return;
+    }
+    Pipeline pipeline;
+    if (parse_pipeline(tokens, &pipeline) == 0) {
+        sink += execute_pipeline(&pipeline);
+        free_pipeline(&pipeline);
+    }
+    free_tokens(tokens, count);
+    reap_children();
+    cleanup_jobs();
+}
+
+static void op_launch(void) {
+    run_line("/bin/true");
+}
+
+static void op_pipeline_2(void) {
+    run_line("/bin/true | /bin/true");
+}
+
+static void op_pipeline_4(void) {
+    run_line("/bin/true | /bin/true | /bin/true | /bin/true");
+}
+
+static void op_pipeline_8(void) {
+    run_line("/bin/true | /bin/true | /bin/true | /bin/true | "
+             "/bin/true | /bin/true | /bin/true | /bin/true");
+}
+
+static void op_pipeline_throughput(void) {
+    char line[MAX_INPUT_SIZE];
+    snprintf(line, sizeof(line), "/bin/cat %s | /bin/cat | /bin/cat", big_file);
+    run_line(line);
+}
+
+static void op_cat(void) {
+    sink += execute_builtin(cat_argv);
+}
+
+// checksum builtin against the standalone tools on the same 32 MiB file
+static void op_checksum_sha256(void) {
+    char *argv[] = { "checksum", "-a", "sha256", big_file, NULL };
+    sink += execute_builtin(argv);
+}
+
+static void op_checksum_crc32c(void) {
+    char *argv[] = { "checksum", "-a", "crc32c", big_file, NULL };
+    sink += execute_builtin(argv);
+}
+
+static void op_checksum_xxh64(void) {
+    char *argv[] = { "checksum", "-a", "xxh64", big_file, NULL };
+    sink += execute_builtin(argv);
+}
+
+static void op_checksum_1000(void) {
+    char *saved = cat_argv[0];
+    cat_argv[0] = "checksum";  // Same files as cat_1000
+    sink += execute_builtin(cat_argv);
+    cat_argv[0] = saved;
+}
+
+static void op_sha256sum(void) {
+    char line[MAX_INPUT_SIZE];
+    snprintf(line, sizeof(line), "sha256sum %s", big_file);
+    run_line(line);
+}
+
+static void op_cksum(void) {
+    char line[MAX_INPUT_SIZE];
+    snprintf(line, sizeof(line), "cksum %s", big_file);
+    run_line(line);
+}
+
+static void op_ls(void) {
+    char *argv[] = { "ls", "-a", files_dir, NULL };
+    sink += execute_builtin(argv);
+}
+
+static void op_rm(void) {
+    char *argv[] = { "rm", "-r", tree_dir, NULL };
+    sink += execute_builtin(argv);
+}
+
+static void op_rm_deep(void) {
+    char *argv[] = { "rm", "-r", deep_dir, NULL };
+    sink += execute_builtin(argv);
+}
+
+// Fake process IDs well above pid_max so they never match real children
+#define FAKE_PID_BASE 100000000
+
+static void op_jobs_at_scale(void) {
+    for (int i = 0; i < JOBS_AT_SCALE; i++) {
+        int job_id = add_job(FAKE_PID_BASE + i, "sleep 1", JOB_RUNNING);
+        add_job_process(job_id, FAKE_PID_BASE + i);
+    }
+    // Reap in reverse order, as the kernel reports children in no
+    // particular order
+    for (int i = JOBS_AT_SCALE - 1; i >= 0; i--) {
+        mark_process_status(FAKE_PID_BASE + i, 0);
+    }
+    cleanup_jobs();
+    sink += count_jobs(JOB_RUNNING);
+}
+
+static void op_background_jobs(void) {
+    for (int i = 0; i < BG_JOBS; i++) {
+        run_line("/bin/true &");
+    }
+    run_line("wait");
+}
+
+static char history_lines[HISTORY_LINES][64];
+
+static void op_history_insert(void) {
+    for (int i = 0; i < HISTORY_LINES; i++) {
+        add_to_history(history_lines[i]);
+    }
+}
+
+static void op_history_lookup(void) {
+    // Every entry by index, then a newest-first prefix search ("!make")
+    int count = get_history_count();
+    for (int i = 1; i <= count; i++) {
+        sink += get_history_entry(i)[0];
+    }
+    for (int i = count; i >= 1; i--) {
+        if (strncmp(get_history_entry(i), "make", 4) == 0) {
+            sink += i;
+            break;
+        }
+    }
+}
+
+// ---- Datasets ----
+
+static int write_file(const char *path, size_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror(path);
+        return -1;
+    }
+    char block[65536];
+    memset(block, 'x', sizeof(block));
+    for (size_t i = 0; i < sizeof(block); i += 64) {
+        block[i + 63] = '\n';
+    }
+    while (size > 0) {
+        size_t n = size < sizeof(block) ? size : sizeof(block);
+        if (write(fd, block, n) != (ssize_t)n) {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+        size -= n;
+    }
+    close(fd);
+    return 0;
+}
+
+// Fresh tree for rm -r (untimed)
+static void prepare_rm(void) {
+    char path[PATH_MAX];
+    mkdir(tree_dir, 0755);
+    for (int d = 0; d < RM_DIRS; d++) {
+        snprintf(path, sizeof(path), "%s/d%d", tree_dir, d);
+        mkdir(path, 0755);
+        for (int f = 0; f < RM_FILES; f++) {
+            snprintf(path, sizeof(path), "%s/d%d/f%d", tree_dir, d, f);
+            int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+}
+
+// Fresh deep tree for rm -r (untimed): RM_DEPTH levels of "d", each holding
+// one file, so every level of the recursion has a batch in flight
+static void prepare_rm_deep(void) {
+    mkdir(deep_dir, 0755);
+    int dirfd = open(deep_dir, O_RDONLY | O_DIRECTORY);
+    for (int level = 0; dirfd != -1 && level < RM_DEPTH; level++) {
+        int fd = openat(dirfd, "f", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd != -1) {
+            close(fd);
+        }
+        mkdirat(dirfd, "d", 0755);
+        int next = openat(dirfd, "d", O_RDONLY | O_DIRECTORY);
+        close(dirfd);
+        dirfd = next;
+    }
+    if (dirfd != -1) {
+        close(dirfd);
+    }
+}
+
+static int create_datasets(void) {
+    if (mkdtemp(data_dir) == NULL) {
+        perror("mkdtemp");
+        return -1;
+    }
+    snprintf(files_dir, sizeof(files_dir), "%s/files", data_dir);
+    snprintf(tree_dir, sizeof(tree_dir), "%s/tree", data_dir);
+    snprintf(deep_dir, sizeof(deep_dir), "%s/deep", data_dir);
+    snprintf(big_file, sizeof(big_file), "%s/big", data_dir);
+
+    if (mkdir(files_dir, 0755) == -1) {
+        perror(files_dir);
+        return -1;
+    }
+    cat_argv = calloc(CAT_FILES + 2, sizeof(char *));
+    if (!cat_argv) {
+        perror("calloc");
+        return -1;
+    }
+    cat_argv[0] = "cat";
+    for (int i = 0; i < CAT_FILES; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/file%04d.txt", files_dir, i);
+        if (write_file(path, CAT_FILE_SIZE) == -1) {
+            return -1;
+        }
+        cat_argv[i + 1] = strdup(path);
+    }
+
+    if (write_file(big_file, BIG_FILE_SIZE) == -1) {
+        return -1;
+    }
+
+    for (int i = 0; i < HISTORY_LINES; i++) {
+        snprintf(history_lines[i], sizeof(history_lines[i]),
+                 i % 10 == 0 ? "make -j%d all" : "git log --oneline -n %d", i);
+    }
+    for (size_t i = 0; i < NUM_LINES; i++) {
+        lines_bytes += strlen(lines[i]);
+    }
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+static void remove_datasets(void) {
+    nftw(data_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// ---- Statistics ----
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Two-sided 95% Student t quantile for df degrees of freedom
+static double t_quantile(int df) {
+    static const double table[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+        2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (df < 1) {
+        return 0;
+    }
+    return df < (int)(sizeof(table) / sizeof(table[0])) ? table[df] : 1.96;
+}
+
+// Sorts samples in place
+static void compute_stats(double *samples, int n, Stats *stats) {
+    qsort(samples, n, sizeof(double), compare_double);
+
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    double mean = sum / n;
+    double var = 0;
+    for (int i = 0; i < n; i++) {
+        var += (samples[i] - mean) * (samples[i] - mean);
+    }
+    double stddev = n > 1 ? sqrt(var / (n - 1)) : 0;
+
+    stats->min = samples[0];
+    stats->median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    stats->mean = mean;
+    stats->stddev = stddev;
+    stats->p95 = samples[(int)ceil(0.95 * n) - 1];
+    stats->ci95 = n > 1 ? t_quantile(n - 1) * stddev / sqrt(n) : 0;
+    stats->samples = n;
+}
+
+// Run a benchmark; samples are nanoseconds per op
+static void run_benchmark(const Benchmark *bench, Stats *stats) {
+    double samples[MAX_SAMPLES];
+    iobatch_set_backend(bench->backend);
+
+    if (bench->prepare) {
+        // Warm up once, then time each op on its own
+        bench->prepare();
+        bench->op();
+        for (int i = 0; i < num_samples; i++) {
+            bench->prepare();
+            double start = now_ns();
+            bench->op();
+            samples[i] = now_ns() - start;
+        }
+        stats->ops = 1;
+    } else {
+        // Calibrate: double the batch until one sample takes min_sample_ns
+        // (this also warms caches and the allocator)
+        long ops = 1;
+        for (;;) {
+            double start = now_ns();
+            for (long i = 0; i < ops; i++) {
+                bench->op();
+            }
+            double elapsed = now_ns() - start;
+            if (elapsed >= min_sample_ns || ops >= (1L << 30)) {
+                break;
+            }
+            ops *= 2;
+        }
+        for (int i = 0; i < num_samples; i++) {
+            double start = now_ns();
+            for (long j = 0; j < ops; j++) {
+                bench->op();
+            }
+            samples[i] = (now_ns() - start) / ops;
+        }
+        stats->ops = ops;
+    }
+
+    compute_stats(samples, num_samples, stats);
+    iobatch_set_backend(IO_BACKEND_SYNC);
+}
+
+// ---- Output and comparison ----
+
+static void json_string(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const char *p = str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', out);
+        }
+        fputc((unsigned char)*p < 0x20 ? ' ' : *p, out);
+    }
+    fputc('"', out);
+}
+
+static void write_result(FILE *out, const Benchmark *bench, const Stats *s, int last) {
+    fprintf(out, "    {\"name\": ");
+    json_string(out, bench->name);
+    fprintf(out, ", \"unit\": \"ns/op\", \"samples\": %d, \"ops_per_sample\": %ld, "
+                 "\"min\": %.1f, \"median\": %.1f, \"mean\": %.1f, \"stddev\": %.1f, "
+                 "\"p95\": %.1f, \"ci95\": %.1f",
+            s->samples, s->ops, s->min, s->median, s->mean, s->stddev, s->p95, s->ci95);
+    if (bench->bytes_per_op > 0) {
+        fprintf(out, ", \"bytes_per_op\": %ld, \"mb_per_s\": %.1f", bench->bytes_per_op,
+                bench->bytes_per_op / s->median * 1e9 / (1 << 20));
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+typedef struct {
+    char name[64];
+    double median;
+    double ci95;
+} SavedResult;
+
+// Read the results of a previous run (one benchmark per line, as written above)
+static int load_results(const char *path, SavedResult **results) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    int count = 0, capacity = 0;
+    *results = NULL;
+    char line[1024];
+    while (fgets(line, sizeof(line), in)) {
+        char *name = strstr(line, "\"name\": \"");
+        char *median = strstr(line, "\"median\": ");
+        char *ci95 = strstr(line, "\"ci95\": ");
+        if (!name || !median || !ci95) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            SavedResult *grown = realloc(*results, capacity * sizeof(SavedResult));
+            if (!grown) {
+                perror("realloc");
+                fclose(in);
+                return -1;
+            }
+            *results = grown;
+        }
+        SavedResult *r = &(*results)[count++];
+        name += strlen("\"name\": \"");
+        size_t len = strcspn(name, "\"");
+        if (len >= sizeof(r->name)) {
+            len = sizeof(r->name) - 1;
+        }
+        memcpy(r->name, name, len);
+        r->name[len] = '\0';
+        r->median = strtod(median + strlen("\"median\": "), NULL);
+        r->ci95 = strtod(ci95 + strlen("\"ci95\": "), NULL);
+    }
+    fclose(in);
+    return count;
+}
+
+// Print the change of every benchmark between two result files
+// A change counts only if it is above 5% and the confidence intervals of
+// the two medians do not overlap
+// Returns 1 if anything got slower, 0 otherwise
+static int compare_results(const char *base_path, const char *new_path) {
+    SavedResult *base, *current;
+    int num_base = load_results(base_path, &base);
+    if (num_base == -1) {
+        return 2;
+    }
+    int num_current = load_results(new_path, &current);
+    if (num_current == -1) {
+        free(base);
+        return 2;
+    }
+
+    int regressions = 0;
+    printf("%-28s %14s %14s %9s\n", "benchmark", "base ns/op", "new ns/op", "change");
+    for (int i = 0; i < num_current; i++) {
+        const SavedResult *now = &current[i];
+        const SavedResult *old = NULL;
+        for (int j = 0; j < num_base; j++) {
+            if (strcmp(base[j].name, now->name) == 0) {
+                old = &base[j];
+                break;
+            }
+        }
+        if (!old) {
+            printf("%-28s %14s %14.1f %9s\n", now->name, "-", now->median, "new");
+            continue;
+        }
+
+        double change = (now->median - old->median) / old->median * 100;
+        int overlap = fabs(now->median - old->median) <= now->ci95 + old->ci95;
+        const char *verdict = "";
+        if (!overlap && change > 5) {
+            verdict = "  SLOWER";
+            regressions++;
+        } else if (!overlap && change < -5) {
+            verdict = "  faster";
+        }
+        printf("%-28s %14.1f %14.1f %+8.1f%%%s\n", now->name, old->median, now->median,
+               change, verdict);
+    }
+
+    free(base);
+    free(current);
+    return regressions > 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench [-o file] [-n samples] [-t ms] [-f filter]\n"
+                    "       bench -c base.json new.json\n");
+}
+
+int main(int argc, char **argv) {
+    const char *output_path = "bench-results.json";
+    const char *filter = NULL;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 2 < argc) {
+            return compare_results(argv[i + 1], argv[i + 2]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            num_samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            min_sample_ns = atof(argv[++i]) * 1e6;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (i != argc || num_samples < 2 || num_samples > MAX_SAMPLES || min_sample_ns <= 0) {
+        usage();
+        return 2;
+    }
+
+    // Same setup as the shell's main(), minus the terminal
+    init_jobs();
+    init_jobqueue();
+    init_history();
+    init_event_loop();
+    init_signals();
+    signal(SIGINT, SIG_DFL);  // Let Ctrl+C stop the run
+
+    if (create_datasets() == -1) {
+        remove_datasets();
+        return 1;
+    }
+    atexit(remove_datasets);
+
+    // Builtins and jobs write to stdout; results go to stderr and the file
+    FILE *out = fopen(output_path, "w");
+    if (!out) {
+        perror(output_path);
+        return 1;
+    }
+    fflush(stdout);
+    int devnull = open("/dev/null", O_RDWR);
+    if (devnull == -1) {
+        perror("/dev/null");
+        return 1;
+    }
+    dup2(devnull, STDIN_FILENO);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    const Benchmark benchmarks[] = {
+        { "tokenize",             op_tokenize,            NULL, lines_bytes, IO_BACKEND_SYNC },
+        { "parse",                op_parse,               NULL, lines_bytes, IO_BACKEND_SYNC },
+        { "launch",               op_launch,              NULL, 0, IO_BACKEND_SYNC },
+        { "pipeline_2",           op_pipeline_2,          NULL, 0, IO_BACKEND_SYNC },
+        { "pipeline_4",           op_pipeline_4,          NULL, 0, IO_BACKEND_SYNC },
+        { "pipeline_8",           op_pipeline_8,          NULL, 0, IO_BACKEND_SYNC },
+        { "pipeline_throughput",  op_pipeline_throughput, NULL, BIG_FILE_SIZE, IO_BACKEND_SYNC },
+        { "cat_1000/sync",        op_cat,                 NULL, (long)CAT_FILES * CAT_FILE_SIZE, IO_BACKEND_SYNC },
+        { "cat_1000/uring",       op_cat,                 NULL, (long)CAT_FILES * CAT_FILE_SIZE, IO_BACKEND_URING },
+        { "checksum_sha256_32m",  op_checksum_sha256,     NULL, BIG_FILE_SIZE, IO_BACKEND_SYNC },
+        { "checksum_crc32c_32m",  op_checksum_crc32c,     NULL, BIG_FILE_SIZE, IO_BACKEND_SYNC },
+        { "checksum_xxh64_32m",   op_checksum_xxh64,      NULL, BIG_FILE_SIZE, IO_BACKEND_SYNC },
+        { "checksum_1000",        op_checksum_1000,       NULL, (long)CAT_FILES * CAT_FILE_SIZE, IO_BACKEND_SYNC },
+        { "sha256sum_32m",        op_sha256sum,           NULL, BIG_FILE_SIZE, IO_BACKEND_SYNC },
+        { "cksum_32m",            op_cksum,               NULL, BIG_FILE_SIZE, IO_BACKEND_SYNC },
+        { "ls_1000/sync",         op_ls,                  NULL, 0, IO_BACKEND_SYNC },
+        { "ls_1000/uring",        op_ls,                  NULL, 0, IO_BACKEND_URING },
+        { "rm_r_1000/sync",       op_rm,                  prepare_rm, 0, IO_BACKEND_SYNC },
+        { "rm_r_1000/uring",      op_rm,                  prepare_rm, 0, IO_BACKEND_URING },
+        { "rm_r_deep_1000/sync",  op_rm_deep,             prepare_rm_deep, 0, IO_BACKEND_SYNC },
+        { "rm_r_deep_1000/uring", op_rm_deep,             prepare_rm_deep, 0, IO_BACKEND_URING },
+        { "jobs_add_reap_10000",  op_jobs_at_scale,       NULL, 0, IO_BACKEND_SYNC },
+        { "background_jobs_64",   op_background_jobs,     NULL, 0, IO_BACKEND_SYNC },
+        { "history_insert_1000",  op_history_insert,      NULL, 0, IO_BACKEND_SYNC },
+        { "history_lookup_1000",  op_history_lookup,      NULL, 0, IO_BACKEND_SYNC },
+    };
+    int num_benchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    // Drop benchmarks that are filtered out or whose backend is unavailable
+    const Benchmark *selected[sizeof(benchmarks) / sizeof(benchmarks[0])];
+    int num_selected = 0;
+    for (int b = 0; b < num_benchmarks; b++) {
+        if (filter && strstr(benchmarks[b].name, filter) == NULL) {
+            continue;
+        }
+        iobatch_set_backend(benchmarks[b].backend);
+        int available = benchmarks[b].backend != IO_BACKEND_URING ||
+                        strcmp(iobatch_backend_name(), "io_uring") == 0;
+        iobatch_set_backend(IO_BACKEND_SYNC);
+        if (!available) {
+            fprintf(stderr, "%-28s skipped (io_uring not available)\n", benchmarks[b].name);
+            continue;
+        }
+        selected[num_selected++] = &benchmarks[b];
+    }
+
+    struct utsname uts;
+    uname(&uts);
+    time_t t = time(NULL);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+    fprintf(out, "{\n  \"commit\": ");
+    json_string(out, BENCH_COMMIT);
+    fprintf(out, ",\n  \"date\": \"%s\",\n  \"kernel\": ", date);
+    json_string(out, uts.release);
+    fprintf(out, ",\n  \"cpus\": %ld,\n  \"compiler\": ", sysconf(_SC_NPROCESSORS_ONLN));
+    json_string(out, __VERSION__);
+    fprintf(out, ",\n  \"samples\": %d,\n  \"min_sample_ms\": %.0f,\n  \"benchmarks\": [\n",
+            num_samples, min_sample_ns / 1e6);
+
+    fprintf(stderr, "%-28s %12s %12s %10s %12s\n", "benchmark", "median ns", "mean ns",
+            "+/- 95%", "MiB/s");
+    for (int b = 0; b < num_selected; b++) {
+        Stats stats;
+        run_benchmark(selected[b], &stats);
+        write_result(out, selected[b], &stats, b == num_selected - 1);
+        fflush(out);
+
+        fprintf(stderr, "%-28s %12.1f %12.1f %9.1f%%", selected[b]->name, stats.median,
+                stats.mean, stats.ci95 / stats.mean * 100);
+        if (selected[b]->bytes_per_op > 0) {
+            fprintf(stderr, " %12.1f", selected[b]->bytes_per_op / stats.median * 1e9 / (1 << 20));
+        }
+        fprintf(stderr, "\n");
+    }
+
+    fprintf(out, "  ]\n}\n");
+    fclose(out);
+    fprintf(stderr, "results written to %s\n", output_path);
+    return 0;
+}
@@ -0,0 +1,383 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+// Microbenchmarks for the shell's per-line fast paths
+// Links the shell's object files like bench.c, but times single calls that
+// take nanoseconds: builtin lookup and dispatch, variable expansion with
+// small and large environments, and history insertion into a full ring.
+//
+// Each sample is a short batch of calls (about 20 us) timed with the TSC
+// (rdtsc, fenced) when it is invariant, or CLOCK_MONOTONIC otherwise.
+// Samples are taken after a warmup, the timer's own overhead is
+// subtracted, and samples above Q3 + 3 * IQR (interrupts, migrations) are
+// rejected before the statistics are computed.
+//
+// Usage: micro [-n samples] [-f filter] [-c]
+//   -c  use clock_gettime even if the TSC is usable
+
+#include "parser.h"
+#include "builtins.h"
+#include "history.h"
+#include "jobs.h"
+#include "memacct.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define MAX_SAMPLES 100000
+#define WARMUP_SAMPLES 200
+#define SAMPLE_NS 20000.0         // Target length of one sample
+#define OUTLIER_IQRS 3.0          // Rejection fence above the third quartile
+#define SMALL_ENV 16              // Variables in the small environment
+#define LARGE_ENV 4096            // Variables in the large environment
+#define HISTORY_POOL 1024         // Distinct lines fed to add_to_history
+
+typedef struct {
+    const char *name;
+    void (*setup)(void);          // Untimed, before the warmup (may be NULL)
+    void (*op)(long n);           // Runs n operations
+} MicroBench;
+
+typedef struct {
+    double median, mean, min, p99, stddev;  // Per op, in ticks
+    long ops;                     // Ops per sample
+    int kept, rejected;
+} MicroStats;
+
+static int use_tsc = 0;
+static double ticks_per_ns = 1.0;
+static int num_samples = 2000;
+
+// Keep the compiler from discarding results
+static volatile long sink;
+
+// ---- Timer ----
+
+// Current time in ticks (TSC cycles or nanoseconds)
+// The fences keep the measured code from moving across the read
+static inline uint64_t ticks(void) {
+#ifdef HAVE_TSC
+    if (use_tsc) {
+        _mm_lfence();
+        uint64_t t = __rdtsc();
+        _mm_lfence();
+        return t;
+    }
+#endif
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The TSC is only a clock if it runs at a constant rate in every C-state
+static int tsc_is_invariant(void) {
+    FILE *in = fopen("/proc/cpuinfo", "r");
+    if (!in) {
+        return 0;
+    }
+    char line[4096];
+    int invariant = 0;
+    while (fgets(line, sizeof(line), in)) {
+        if (strncmp(line, "flags", 5) == 0) {
+            invariant = strstr(line, " constant_tsc") && strstr(line, " nonstop_tsc");
+            break;
+        }
+    }
+    fclose(in);
+    return invariant;
+}
+
+// Pick the timer and measure the TSC frequency against CLOCK_MONOTONIC
+static void init_timer(int force_clock) {
+#ifdef HAVE_TSC
+    if (!force_clock && tsc_is_invariant()) {
+        use_tsc = 1;
+        double start_ns = now_ns();
+        uint64_t start = ticks();
+        while (now_ns() - start_ns < 50e6) {
+        }
+        ticks_per_ns = (ticks() - start) / (now_ns() - start_ns);
+        return;
+    }
+#endif
+    (void)force_clock;
+    use_tsc = 0;
+    ticks_per_ns = 1.0;
+}
+
+// ---- Benchmarked operations ----
+
+static void op_is_builtin_first(long n) {
+    for (long i = 0; i < n; i++) {
+        sink += is_builtin("cd");
+    }
+}
+
+static void op_is_builtin_last(long n) {
+    for (long i = 0; i < n; i++) {
+        sink += is_builtin("unset");
+    }
+}
+
+static void op_is_builtin_miss(long n) {
+    for (long i = 0; i < n; i++) {
+        sink += is_builtin("grep");
+    }
+}
+
+// pwd is near the front of the dispatch chain, unset at the very end
+static void op_dispatch_pwd(long n) {
+    char *argv[] = { "pwd", NULL };
+    for (long i = 0; i < n; i++) {
+        sink += execute_builtin(argv);
+    }
+}
+
+static void op_dispatch_unset(long n) {
+    char *argv[] = { "unset", "MICRO_NEVER_SET", NULL };
+    for (long i = 0; i < n; i++) {
+        sink += execute_builtin(argv);
+    }
+}
+
+static void expand(const char *name, long n) {
+    for (long i = 0; i < n; i++) {
+        char *value = expand_variable(name);
+        if (value) {
+            sink += value[0];
+            mem_free(MEM_PARSER, value);
+        }
+    }
+}
+
+// MICRO_VAR is the last variable set, so getenv scans the whole environment
+static void op_expand_hit(long n) {
+    expand("MICRO_VAR", n);
+}
+
+static void op_expand_miss(long n) {
+    expand("MICRO_MISSING", n);
+}
+
+static char history_pool[HISTORY_POOL][48];
+static long history_pos = 0;
+
+static void op_history_full(long n) {
+    for (long i = 0; i < n; i++) {
+        add_to_history(history_pool[history_pos++ % HISTORY_POOL]);
+    }
+}
+
+// ---- Setup ----
+
+// Replace the environment with count filler variables, then MICRO_VAR
+static void make_environment(int count) {
+    clearenv();
+    char name[32];
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "MICRO_FILL_%d", i);
+        setenv(name, "/usr/local/bin:/usr/bin:/bin", 1);
+    }
+    setenv("MICRO_VAR", "/home/user/projects/myshell", 1);
+}
+
+static void setup_small_env(void) {
+    make_environment(SMALL_ENV - 1);
+}
+
+static void setup_large_env(void) {
+    make_environment(LARGE_ENV - 1);
+}
+
+static void setup_full_history(void) {
+    for (int i = 0; i < HISTORY_POOL; i++) {
+        snprintf(history_pool[i], sizeof(history_pool[i]),
+                 "git log --oneline -n %d -- src/file%d.c", i, i % 97);
+    }
+    while (get_history_count() < MAX_HISTORY) {
+        op_history_full(1);
+    }
+}
+
+// ---- Measurement ----
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Median cost of reading the timer twice back to back
+static double timer_overhead(void) {
+    double samples[1000];
+    for (int i = 0; i < 1000; i++) {
+        uint64_t start = ticks();
+        samples[i] = ticks() - start;
+    }
+    qsort(samples, 1000, sizeof(double), compare_double);
+    return samples[500];
+}
+
+static void run_micro(const MicroBench *bench, double overhead, double *samples,
+                      MicroStats *stats) {
+    if (bench->setup) {
+        bench->setup();
+    }
+
+    // Calibrate: double the batch until a sample takes about SAMPLE_NS
+    long ops = 1;
+    for (;;) {
+        uint64_t start = ticks();
+        bench->op(ops);
+        double elapsed = (ticks() - start) / ticks_per_ns;
+        if (elapsed >= SAMPLE_NS || ops >= (1L << 24)) {
+            break;
+        }
+        ops *= 2;
+    }
+
+    for (int i = 0; i < WARMUP_SAMPLES; i++) {
+        bench->op(ops);
+    }
+    for (int i = 0; i < num_samples; i++) {
+        uint64_t start = ticks();
+        bench->op(ops);
+        double elapsed = (double)(ticks() - start) - overhead;
+        samples[i] = (elapsed > 0 ? elapsed : 0) / ops;
+    }
+
+    // Reject slow outliers (interrupts, migrations) above Q3 + 3 * IQR
+    // The fence sits above both modes of a bimodal run, unlike a MAD cut
+    qsort(samples, num_samples, sizeof(double), compare_double);
+    double q1 = samples[num_samples / 4];
+    double q3 = samples[num_samples * 3 / 4];
+    double limit = q3 + OUTLIER_IQRS * (q3 - q1);
+
+    int kept = 0;
+    while (kept < num_samples && samples[kept] <= limit) {
+        kept++;
+    }
+    double sum = 0, var = 0;
+    for (int i = 0; i < kept; i++) {
+        sum += samples[i];
+    }
+    double mean = sum / kept;
+    for (int i = 0; i < kept; i++) {
+        var += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    stats->median = kept % 2 ? samples[kept / 2]
+                             : (samples[kept / 2 - 1] + samples[kept / 2]) / 2;
+    stats->mean = mean;
+    stats->min = samples[0];
+    stats->p99 = samples[(int)ceil(0.99 * kept) - 1];
+    stats->stddev = kept > 1 ? sqrt(var / (kept - 1)) : 0;
+    stats->ops = ops;
+    stats->kept = kept;
+    stats->rejected = num_samples - kept;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: micro [-n samples] [-f filter] [-c]\n");
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    int force_clock = 0;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            num_samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0) {
+            force_clock = 1;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (i != argc || num_samples < 10 || num_samples > MAX_SAMPLES) {
+        usage();
+        return 2;
+    }
+
+    init_jobs();
+    init_history();
+    init_timer(force_clock);
+
+    // Builtins write to stdout; results go to stderr
+    fflush(stdout);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull == -1) {
+        perror("/dev/null");
+        return 1;
+    }
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    // Benchmarks that change the environment come last, small before large
+    const MicroBench benchmarks[] = {
+        { "is_builtin/first",          NULL,               op_is_builtin_first },
+        { "is_builtin/last",           NULL,               op_is_builtin_last },
+        { "is_builtin/miss",           NULL,               op_is_builtin_miss },
+        { "execute_builtin/pwd",       NULL,               op_dispatch_pwd },
+        { "execute_builtin/unset",     NULL,               op_dispatch_unset },
+        { "add_to_history/full",       setup_full_history, op_history_full },
+        { "expand_variable/env16/hit", setup_small_env,    op_expand_hit },
+        { "expand_variable/env16/miss", NULL,              op_expand_miss },
+        { "expand_variable/env4096/hit", setup_large_env,  op_expand_hit },
+        { "expand_variable/env4096/miss", NULL,            op_expand_miss },
+    };
+    int num_benchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    double *samples = malloc(num_samples * sizeof(double));
+    if (!samples) {
+        perror("malloc");
+        return 1;
+    }
+    double overhead = timer_overhead();
+    const char *unit = use_tsc ? "cycles" : "ns";
+    fprintf(stderr, "timer: %s", use_tsc ? "rdtsc" : "clock_gettime");
+    if (use_tsc) {
+        fprintf(stderr, " (%.3f GHz)", ticks_per_ns);
+    }
+    fprintf(stderr, ", overhead %.0f %s, %d samples of ~%.0f us\n\n", overhead, unit,
+            num_samples, SAMPLE_NS / 1e3);
+
+    fprintf(stderr, "%-30s %10s %10s %10s %10s %9s %8s %9s\n", "benchmark", "median", "mean",
+            "min", "p99", "stddev", "ns/op", "rejected");
+    for (int b = 0; b < num_benchmarks; b++) {
+        // Setups run even when filtered out, so the environment is the same
+        if (filter && strstr(benchmarks[b].name, filter) == NULL) {
+            if (benchmarks[b].setup) {
+                benchmarks[b].setup();
+            }
+            continue;
+        }
+        MicroStats stats;
+        run_micro(&benchmarks[b], overhead, samples, &stats);
+        fprintf(stderr, "%-30s %10.1f %10.1f %10.1f %10.1f %8.1f%% %8.1f %8.1f%%\n",
+                benchmarks[b].name, stats.median, stats.mean, stats.min, stats.p99,
+                stats.stddev / stats.mean * 100, stats.median / ticks_per_ns,
+                100.0 * stats.rejected / num_samples);
+    }
+    fprintf(stderr, "\n(per call, in %s)\n", unit);
+
+    free(samples);
+    return 0;
+}
@@ -1,789 +1,1872 @@
-// Feature test macros must be defined before any includes
-#define _POSIX_C_SOURCE 200809L
-#define _GNU_SOURCE
-
-#include "builtins.h"
-#include "utils.h"
-#include "jobs.h"
-#include "history.h"
-#include <limits.h>
-#include <stdlib.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <dirent.h>
-#include <time.h>
-#include <signal.h>
-
-// Built-in command: cd
-// Changes current working directory
-static int builtin_cd(char **argv) {
-    char *dir = NULL;
-
-    // cd with no arguments goes to home directory
-    if (argv[1] == NULL) {
-        dir = getenv("HOME");
-        if (dir == NULL) {
-            fprintf(stderr, "myshell: cd: HOME not set\n");
-            return 1;
-        }
-    } else {
-        dir = argv[1];
-    }
-
-    if (chdir(dir) == -1) {
-        perror("myshell: cd");
-        return 1;
-    }
-
-    return 0;
-}
-
-// Built-in command: pwd
-// Prints current working directory
-static int builtin_pwd(char **argv) {
-    (void)argv; // Unused parameter
-
-    char cwd[PATH_MAX];
-    if (getcwd(cwd, sizeof(cwd)) == NULL) {
-        perror("myshell: pwd");
-        return 1;
-    }
-
-    printf("%s\n", cwd);
-    fflush(stdout);  // Ensure output is flushed (important when piped)
-    return 0;
-}
-
-// Built-in command: exit
-// Exits the shell with optional status code
-static int builtin_exit(char **argv) {
-    int status = 0;
-
-    if (argv[1] != NULL) {
-        status = atoi(argv[1]);
-    }
-
-    exit(status);
-    // Never returns
-}
-
-// Built-in command: echo
-// Prints arguments to stdout, handles -n flag
-// Uses write() system call directly
-static int builtin_echo(char **argv) {
-    int no_newline = 0;
-    int start_idx = 1;
-
-    // Check for -n flag
-    if (argv[1] != NULL && strcmp(argv[1], "-n") == 0) {
-        no_newline = 1;
-        start_idx = 2;
-    }
-
-    // Print all arguments
-    for (int i = start_idx; argv[i] != NULL; i++) {
-        if (i > start_idx) {
-            // Add space between arguments
-            if (write(STDOUT_FILENO, " ", 1) == -1) {
-                perror("myshell: echo");
-                return 1;
-            }
-        }
-        // Write the argument
-        size_t len = strlen(argv[i]);
-        if (write(STDOUT_FILENO, argv[i], len) == -1) {
-            perror("myshell: echo");
-            return 1;
-        }
-    }
-
-    // Add newline unless -n flag is set
-    if (!no_newline) {
-        if (write(STDOUT_FILENO, "\n", 1) == -1) {
-            perror("myshell: echo");
-            return 1;
-        }
-    }
-
-    return 0;
-}
-
-// Built-in command: mkdir
-// Creates a directory using mkdir() system call
-static int builtin_mkdir(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: mkdir: missing operand\n");
-        return 1;
-    }
-
-    int error_occurred = 0;
-
-    // Handle multiple directories
-    for (int i = 1; argv[i] != NULL; i++) {
-        // Create directory with permissions 0755 (rwxr-xr-x)
-        if (mkdir(argv[i], 0755) == -1) {
-            fprintf(stderr, "myshell: mkdir: cannot create directory '%s': ", argv[i]);
-            perror("");
-            error_occurred = 1;
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Built-in command: touch
-// Creates an empty file or updates its timestamp
-// Uses open() with O_CREAT flag
-static int builtin_touch(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: touch: missing file operand\n");
-        return 1;
-    }
-
-    int error_occurred = 0;
-
-    // Handle multiple files
-    for (int i = 1; argv[i] != NULL; i++) {
-        // Open file with O_CREAT and O_WRONLY
-        // If file exists, this will just open it (updating access time)
-        // If file doesn't exist, it will be created
-        int fd = open(argv[i], O_CREAT | O_WRONLY, 0644);
-        if (fd == -1) {
-            fprintf(stderr, "myshell: touch: cannot touch '%s': ", argv[i]);
-            perror("");
-            error_occurred = 1;
-        } else {
-            // Update modification time by writing nothing (or just closing)
-            // Actually, just opening with O_WRONLY and closing updates the access time
-            // To update modification time, we'd need utimensat(), but for simplicity
-            // we'll just close the file
-            close(fd);
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Built-in command: rmdir
-// Removes empty directories using rmdir() system call
-static int builtin_rmdir(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: rmdir: missing operand\n");
-        return 1;
-    }
-
-    int error_occurred = 0;
-
-    // Handle multiple directories
-    for (int i = 1; argv[i] != NULL; i++) {
-        if (rmdir(argv[i]) == -1) {
-            fprintf(stderr, "myshell: rmdir: cannot remove '%s': ", argv[i]);
-            perror("");
-            error_occurred = 1;
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Helper function to recursively remove directory
-static int remove_directory_recursive(const char *path, int force) {
-    DIR *dir = opendir(path);
-    if (dir == NULL) {
-        if (!force) {
-            perror("myshell: rm: opendir");
-        }
-        return -1;
-    }
-
-    struct dirent *entry;
-    char full_path[PATH_MAX + 1];
-
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        // Build full path
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-
-        struct stat st;
-        if (stat(full_path, &st) == -1) {
-            if (!force) {
-                perror("myshell: rm: stat");
-            }
-            continue;
-        }
-
-        if (S_ISDIR(st.st_mode)) {
-            // Recursively remove directory
-            if (remove_directory_recursive(full_path, force) == -1) {
-                closedir(dir);
-                return -1;
-            }
-        } else {
-            // Remove file
-            if (unlink(full_path) == -1) {
-                if (!force) {
-                    fprintf(stderr, "myshell: rm: cannot remove '%s': ", full_path);
-                    perror("");
-                }
-            }
-        }
-    }
-
-    closedir(dir);
-
-    // Remove the directory itself
-    if (rmdir(path) == -1) {
-        if (!force) {
-            fprintf(stderr, "myshell: rm: cannot remove '%s': ", path);
-            perror("");
-        }
-        return -1;
-    }
-
-    return 0;
-}
-
-// Built-in command: rm
-// Removes files and directories using unlink() and rmdir() system calls
-// Supports -r (recursive) and -f (force) flags
-static int builtin_rm(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: rm: missing operand\n");
-        return 1;
-    }
-
-    int recursive = 0;
-    int force = 0;
-    int arg_start = 1;
-
-    // Parse flags
-    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
-        char *flags = argv[arg_start] + 1;
-        for (int i = 0; flags[i] != '\0'; i++) {
-            if (flags[i] == 'r') {
-                recursive = 1;
-            } else if (flags[i] == 'f') {
-                force = 1;
-            } else {
-                fprintf(stderr, "myshell: rm: invalid option -- '%c'\n", flags[i]);
-                return 1;
-            }
-        }
-        arg_start++;
-    }
-
-    if (argv[arg_start] == NULL) {
-        fprintf(stderr, "myshell: rm: missing operand\n");
-        return 1;
-    }
-
-    int error_occurred = 0;
-
-    // Process each file/directory
-    for (int i = arg_start; argv[i] != NULL; i++) {
-        struct stat st;
-        if (stat(argv[i], &st) == -1) {
-            if (!force) {
-                fprintf(stderr, "myshell: rm: cannot remove '%s': ", argv[i]);
-                perror("");
-                error_occurred = 1;
-            }
-            continue;
-        }
-
-        if (S_ISDIR(st.st_mode)) {
-            if (!recursive) {
-                if (!force) {
-                    fprintf(stderr, "myshell: rm: '%s': is a directory\n", argv[i]);
-                }
-                error_occurred = 1;
-            } else {
-                // Recursively remove directory
-                if (remove_directory_recursive(argv[i], force) == -1) {
-                    error_occurred = 1;
-                }
-            }
-        } else {
-            // Remove file
-            if (unlink(argv[i]) == -1) {
-                if (!force) {
-                    fprintf(stderr, "myshell: rm: cannot remove '%s': ", argv[i]);
-                    perror("");
-                    error_occurred = 1;
-                }
-            }
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Built-in command: cat
-// Concatenates and prints files using open/read/write
-// Uses 4KB buffer for reading
-// If no arguments, reads from stdin
-static int builtin_cat(char **argv) {
-    int error_occurred = 0;
-    char buffer[4096];  // 4KB buffer
-    ssize_t bytes_read;
-
-    // If no arguments, read from stdin
-    if (argv[1] == NULL) {
-        // Read from stdin in 4KB chunks and write to stdout
-        while ((bytes_read = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
-            ssize_t bytes_written = 0;
-            ssize_t total_written = 0;
-
-            // Write all bytes (handle partial writes)
-            while (total_written < bytes_read) {
-                bytes_written = write(STDOUT_FILENO, buffer + total_written, 
-                                     bytes_read - total_written);
-                if (bytes_written == -1) {
-                    perror("myshell: cat");
-                    return 1;
-                }
-                total_written += bytes_written;
-            }
-        }
-
-        if (bytes_read == -1) {
-            perror("myshell: cat");
-            return 1;
-        }
-
-        return 0;
-    }
-
-    // Process each file
-    for (int i = 1; argv[i] != NULL; i++) {
-        int fd = open(argv[i], O_RDONLY);
-        if (fd == -1) {
-            fprintf(stderr, "myshell: cat: %s: ", argv[i]);
-            perror("");
-            error_occurred = 1;
-            continue;
-        }
-
-        // Read file in 4KB chunks and write to stdout
-        while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0) {
-            ssize_t bytes_written = 0;
-            ssize_t total_written = 0;
-
-            // Write all bytes (handle partial writes)
-            while (total_written < bytes_read) {
-                bytes_written = write(STDOUT_FILENO, buffer + total_written, 
-                                     bytes_read - total_written);
-                if (bytes_written == -1) {
-                    perror("myshell: cat");
-                    error_occurred = 1;
-                    break;
-                }
-                total_written += bytes_written;
-            }
-        }
-
-        if (bytes_read == -1) {
-            fprintf(stderr, "myshell: cat: %s: ", argv[i]);
-            perror("");
-            error_occurred = 1;
-        }
-
-        close(fd);
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Built-in command: ls
-// Lists directory contents using opendir/readdir/stat
-// Color codes directories (blue) and files
-static int builtin_ls(char **argv) {
-    int show_all = 0;  // -a flag for hidden files
-    int arg_start = 1;
-    char *dirs[MAX_ARGS];
-    int dir_count = 0;
-
-    // Parse flags (only -a for now)
-    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
-        if (strcmp(argv[arg_start], "-a") == 0) {
-            show_all = 1;
-        } else {
-            fprintf(stderr, "myshell: ls: invalid option -- '%s'\n", 
-                   argv[arg_start] + 1);
-            return 1;
-        }
-        arg_start++;
-    }
-
-    // Collect directories to list
-    if (argv[arg_start] == NULL) {
-        // No directory specified, use current directory
-        dirs[0] = ".";
-        dir_count = 1;
-    } else {
-        // Collect all specified directories
-        for (int i = arg_start; argv[i] != NULL && dir_count < MAX_ARGS - 1; i++) {
-            dirs[dir_count++] = argv[i];
-        }
-    }
-
-    int error_occurred = 0;
-
-    // List each directory
-    for (int d = 0; d < dir_count; d++) {
-        if (dir_count > 1) {
-            // Print directory name if multiple directories
-            printf("%s:\n", dirs[d]);
-            fflush(stdout);
-        }
-
-        DIR *dir = opendir(dirs[d]);
-        if (dir == NULL) {
-            fprintf(stderr, "myshell: ls: cannot access '%s': ", dirs[d]);
-            perror("");
-            error_occurred = 1;
-            continue;
-        }
-
-        struct dirent *entry;
-        struct stat file_stat;
-        char full_path[PATH_MAX + 1];
-
-        // Read directory entries
-        while ((entry = readdir(dir)) != NULL) {
-            // Skip hidden files unless -a flag is set
-            if (!show_all && entry->d_name[0] == '.') {
-                continue;
-            }
-
-            // Build full path for stat()
-            snprintf(full_path, sizeof(full_path), "%s/%s", dirs[d], entry->d_name);
-
-            // Get file information
-            if (stat(full_path, &file_stat) == -1) {
-                // If stat fails, just print the name without color
-                printf("%s\n", entry->d_name);
-                fflush(stdout);
-                continue;
-            }
-
-            // Color code: blue for directories, default for files
-            if (S_ISDIR(file_stat.st_mode)) {
-                // Blue color for directories: \033[34m (ANSI escape code)
-                printf("\033[34m%s\033[0m\n", entry->d_name);
-                fflush(stdout);
-            } else {
-                printf("%s\n", entry->d_name);
-                fflush(stdout);
-            }
-        }
-
-        closedir(dir);
-
-        if (d < dir_count - 1) {
-            printf("\n");  // Blank line between directories
-            fflush(stdout);
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Built-in command: jobs
-// Lists all background and stopped jobs
-static int builtin_jobs(char **argv) {
-    (void)argv; // Unused parameter
-
-    Job jobs[MAX_JOBS];
-    int num_jobs = get_all_jobs(jobs, MAX_JOBS);
-
-    if (num_jobs == 0) {
-        return 0;  // No jobs
-    }
-
-    for (int i = 0; i < num_jobs; i++) {
-        const char *status_str;
-        switch (jobs[i].status) {
-            case JOB_RUNNING:
-                status_str = "Running";
-                break;
-            case JOB_STOPPED:
-                status_str = "Stopped";
-                break;
-            case JOB_DONE:
-                status_str = "Done";
-                break;
-            default:
-                status_str = "Unknown";
-                break;
-        }
-        printf("[%d] %s %s\n", jobs[i].job_id, status_str, jobs[i].command);
-    }
-    fflush(stdout);
-
-    return 0;
-}
-
-// Built-in command: fg
-// Brings a background/stopped job to foreground
-static int builtin_fg(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: fg: usage: fg [job_id]\n");
-        return 1;
-    }
-
-    int job_id = atoi(argv[1]);
-    if (job_id <= 0) {
-        fprintf(stderr, "myshell: fg: %s: no such job\n", argv[1]);
-        return 1;
-    }
-
-    Job *job = find_job(job_id);
-    if (!job) {
-        fprintf(stderr, "myshell: fg: %d: no such job\n", job_id);
-        return 1;
-    }
-
-    // Bring process group to foreground
-    if (tcsetpgrp(STDIN_FILENO, job->pgid) == -1) {
-        perror("myshell: fg: tcsetpgrp");
-        return 1;
-    }
-
-    // Send SIGCONT to resume if stopped
-    if (job->status == JOB_STOPPED) {
-        if (kill(-job->pgid, SIGCONT) == -1) {
-            perror("myshell: fg: kill");
-            return 1;
-        }
-        update_job_status(job_id, JOB_RUNNING);
-    }
-
-    // Wait for the process group
-    int status;
-    pid_t pid;
-    while ((pid = waitpid(-job->pgid, &status, WUNTRACED)) > 0) {
-        if (WIFSTOPPED(status)) {
-            update_job_status_by_pgid(job->pgid, JOB_STOPPED);
-            printf("\n[%d]+  Stopped    %s\n", job_id, job->command);
-            break;
-        } else if (WIFEXITED(status) || WIFSIGNALED(status)) {
-            remove_job(job_id);
-            break;
-        }
-    }
-
-    // Return shell's process group to foreground
-    if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-        perror("myshell: fg: tcsetpgrp");
-    }
-
-    return 0;
-}
-
-// Built-in command: bg
-// Resumes a stopped job in background
-static int builtin_bg(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: bg: usage: bg [job_id]\n");
-        return 1;
-    }
-
-    int job_id = atoi(argv[1]);
-    if (job_id <= 0) {
-        fprintf(stderr, "myshell: bg: %s: no such job\n", argv[1]);
-        return 1;
-    }
-
-    Job *job = find_job(job_id);
-    if (!job) {
-        fprintf(stderr, "myshell: bg: %d: no such job\n", job_id);
-        return 1;
-    }
-
-    if (job->status != JOB_STOPPED) {
-        fprintf(stderr, "myshell: bg: job %d is not stopped\n", job_id);
-        return 1;
-    }
-
-    // Send SIGCONT to resume
-    if (kill(-job->pgid, SIGCONT) == -1) {
-        perror("myshell: bg: kill");
-        return 1;
-    }
-
-    update_job_status(job_id, JOB_RUNNING);
-    printf("[%d]+ %s &\n", job_id, job->command);
-
-    return 0;
-}
-
-// Built-in command: history
-// Lists command history
-static int builtin_history(char **argv) {
-    (void)argv; // Unused parameter
-
-    const char *history[1000];  // Use fixed size matching MAX_HISTORY
-    int count = get_all_history(history, 1000);
-
-    // Print history with line numbers (1-based, like bash)
-    int start_num = 1;
-    if (count < get_history_count()) {
-        start_num = get_history_count() - count + 1;
-    }
-
-    for (int i = 0; i < count; i++) {
-        printf("%5d  %s\n", start_num + i, history[i]);
-    }
-    fflush(stdout);
-
-    return 0;
-}
-
-// Built-in command: export
-// Sets environment variable: export VAR=value
-static int builtin_export(char **argv) {
-    if (argv[1] == NULL) {
-        // Print all environment variables (simplified - just show a few common ones)
-        extern char **environ;
-        for (int i = 0; environ[i] != NULL; i++) {
-            printf("declare -x %s\n", environ[i]);
-        }
-        fflush(stdout);
-        return 0;
-    }
-
-    int error_occurred = 0;
-
-    for (int i = 1; argv[i] != NULL; i++) {
-        char *arg = argv[i];
-        char *equals = strchr(arg, '=');
-        
-        if (equals == NULL) {
-            // Just variable name - check if it exists
-            char *value = getenv(arg);
-            if (value == NULL) {
-                fprintf(stderr, "myshell: export: %s: variable not set\n", arg);
-                error_occurred = 1;
-            } else {
-                // Variable exists, export it (already exported if from environment)
-                setenv(arg, value, 1);
-            }
-        } else {
-            // VAR=value format - need to copy to avoid modifying argv
-            int name_len = equals - arg;
-            char *var_name = malloc(name_len + 1);
-            if (!var_name) {
-                perror("malloc");
-                error_occurred = 1;
-                continue;
-            }
-            strncpy(var_name, arg, name_len);
-            var_name[name_len] = '\0';
-            char *var_value = equals + 1;
-            
-            if (setenv(var_name, var_value, 1) == -1) {
-                perror("myshell: export");
-                error_occurred = 1;
-            }
-            
-            free(var_name);
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Built-in command: unset
-// Unsets environment variable
-static int builtin_unset(char **argv) {
-    if (argv[1] == NULL) {
-        fprintf(stderr, "myshell: unset: usage: unset [variable...]\n");
-        return 1;
-    }
-
-    int error_occurred = 0;
-
-    for (int i = 1; argv[i] != NULL; i++) {
-        if (unsetenv(argv[i]) == -1) {
-            perror("myshell: unset");
-            error_occurred = 1;
-        }
-    }
-
-    return error_occurred ? 1 : 0;
-}
-
-// Check if command is a built-in
-int is_builtin(char *cmd) {
-    if (!cmd) {
-        return 0;
-    }
-
-    return (strcmp(cmd, "cd") == 0 ||
-            strcmp(cmd, "pwd") == 0 ||
-            strcmp(cmd, "exit") == 0 ||
-            strcmp(cmd, "echo") == 0 ||
-            strcmp(cmd, "mkdir") == 0 ||
-            strcmp(cmd, "rmdir") == 0 ||
-            strcmp(cmd, "touch") == 0 ||
-            strcmp(cmd, "rm") == 0 ||
-            strcmp(cmd, "cat") == 0 ||
-            strcmp(cmd, "ls") == 0 ||
-            strcmp(cmd, "jobs") == 0 ||
-            strcmp(cmd, "fg") == 0 ||
-            strcmp(cmd, "bg") == 0 ||
-            strcmp(cmd, "history") == 0 ||
-            strcmp(cmd, "export") == 0 ||
-            strcmp(cmd, "unset") == 0);
-}
-
-// Execute built-in command
-int execute_builtin(char **argv) {
-    if (!argv || !argv[0]) {
-        return -1;
-    }
-
-    char *cmd = argv[0];
-
-    if (strcmp(cmd, "cd") == 0) {
-        return builtin_cd(argv);
-    } else if (strcmp(cmd, "pwd") == 0) {
-        return builtin_pwd(argv);
-    } else if (strcmp(cmd, "exit") == 0) {
-        return builtin_exit(argv);
-    } else if (strcmp(cmd, "echo") == 0) {
-        return builtin_echo(argv);
-    } else if (strcmp(cmd, "mkdir") == 0) {
-        return builtin_mkdir(argv);
-    } else if (strcmp(cmd, "rmdir") == 0) {
-        return builtin_rmdir(argv);
-    } else if (strcmp(cmd, "touch") == 0) {
-        return builtin_touch(argv);
-    } else if (strcmp(cmd, "rm") == 0) {
-        return builtin_rm(argv);
-    } else if (strcmp(cmd, "cat") == 0) {
-        return builtin_cat(argv);
-    } else if (strcmp(cmd, "ls") == 0) {
-        return builtin_ls(argv);
-    } else if (strcmp(cmd, "jobs") == 0) {
-        return builtin_jobs(argv);
-    } else if (strcmp(cmd, "fg") == 0) {
-        return builtin_fg(argv);
-    } else if (strcmp(cmd, "bg") == 0) {
-        return builtin_bg(argv);
-    } else if (strcmp(cmd, "history") == 0) {
-        return builtin_history(argv);
-    } else if (strcmp(cmd, "export") == 0) {
-        return builtin_export(argv);
-    } else if (strcmp(cmd, "unset") == 0) {
-        return builtin_unset(argv);
-    }
-
-    return -1;
-}
-
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "builtins.h"
+#include "utils.h"
+#include "jobs.h"
+#include "history.h"
+#include "signals.h"
+#include "capture.h"
+#include "jobqueue.h"
+#include "launch.h"
+#include "cgroup.h"
+#include "ulimit.h"
+#include "iobatch.h"
+#include "trace.h"
+#include "sysacct.h"
+#include "memacct.h"
+#include "cond.h"
+#include "linebuf.h"
+#include "outbuf.h"
+#include "printfmt.h"
+#include "checksum.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <time.h>
+#include <signal.h>
+
+// Built-in command: cd
+// Changes current working directory
+static int builtin_cd(char **argv) {
+    char *dir = NULL;
+
+    // cd with no arguments goes to home directory
+    if (argv[1] == NULL) {
+        dir = getenv("HOME");
+        if (dir == NULL) {
+            fprintf(stderr, "myshell: cd: HOME not set\n");
+            return 1;
+        }
+    } else {
+        dir = argv[1];
+    }
+
+    if (chdir(dir) == -1) {
+        perror("myshell: cd");
+        return 1;
+    }
+
+    return 0;
+}
+
+// Built-in command: pwd
+// Prints current working directory
+static int builtin_pwd(char **argv) {
+    (void)argv; // Unused parameter
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        perror("myshell: pwd");
+        return 1;
+    }
+
+    out_printf("%s\n", cwd);
+    return 0;
+}
+
+// Built-in command: exit
+// Exits the shell with optional status code
+static int builtin_exit(char **argv) {
+    int status = 0;
+
+    if (argv[1] != NULL) {
+        status = atoi(argv[1]);
+    }
+
+    exit(status);
+    // Never returns
+}
+
+// Built-in command: echo
+// Prints arguments to stdout, handles -n flag
+// Output goes to the builtin output buffer (see outbuf.h)
+static int builtin_echo(char **argv) {
+    int no_newline = 0;
+    int start_idx = 1;
+
+    // Check for -n flag
+    if (argv[1] != NULL && strcmp(argv[1], "-n") == 0) {
+        no_newline = 1;
+        start_idx = 2;
+    }
+
+    // Print all arguments, separated by spaces
+    for (int i = start_idx; argv[i] != NULL; i++) {
+        if (i > start_idx) {
+            out_putc(' ');
+        }
+        out_puts(argv[i]);
+    }
+
+    // Add newline unless -n flag is set
+    if (!no_newline) {
+        out_putc('\n');
+    }
+
+    return 0;
+}
+
+// Built-in command: printf
+// Formats and prints arguments (see printfmt.h)
+static int builtin_printf(char **argv) {
+    int arg_start = 1;
+    if (argv[arg_start] != NULL && strcmp(argv[arg_start], "--") == 0) {
+        arg_start++;
+    }
+    if (argv[arg_start] == NULL) {
+        fprintf(stderr, "myshell: printf: usage: printf format [arguments]\n");
+        return 1;
+    }
+
+    return format_print(argv[arg_start], argv + arg_start + 1);
+}
+
+// Built-in command: mkdir
+// Creates a directory using mkdir() system call
+static int builtin_mkdir(char **argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "myshell: mkdir: missing operand\n");
+        return 1;
+    }
+
+    int error_occurred = 0;
+
+    // Handle multiple directories
+    for (int i = 1; argv[i] != NULL; i++) {
+        // Create directory with permissions 0755 (rwxr-xr-x)
+        if (mkdir(argv[i], 0755) == -1) {
+            fprintf(stderr, "myshell: mkdir: cannot create directory '%s': ", argv[i]);
+            perror("");
+            error_occurred = 1;
+        }
+    }
+
+    return error_occurred ? 1 : 0;
+}
+
+// Built-in command: touch
+// Creates empty files
+// Uses batched openat() with O_CREAT (see iobatch.h)
+static int builtin_touch(char **argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "myshell: touch: missing file operand\n");
+        return 1;
+    }
+
+    int count = 0;
+    while (argv[1 + count] != NULL) {
+        count++;
+    }
+    int *fds = malloc(count * sizeof(int));
+    if (!fds) {
+        perror("malloc");
+        return 1;
+    }
+
+    // Open (creating if needed) every file in one batch, then close them
+    // Opening an existing file leaves it untouched
+    int error_occurred = 0;
+    iobatch_openat(AT_FDCWD, &argv[1], count, O_CREAT | O_WRONLY, 0644, fds);
+    for (int i = 0; i < count; i++) {
+        if (fds[i] < 0) {
+            fprintf(stderr, "myshell: touch: cannot touch '%s': %s\n", argv[1 + i],
+                    strerror(-fds[i]));
+            error_occurred = 1;
+        }
+    }
+    iobatch_close(fds, count);
+    free(fds);
+
+    return error_occurred ? 1 : 0;
+}
+
+// Built-in command: rmdir
+// Removes empty directories using rmdir() system call
+static int builtin_rmdir(char **argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "myshell: rmdir: missing operand\n");
+        return 1;
+    }
+
+    int error_occurred = 0;
+
+    // Handle multiple directories
+    for (int i = 1; argv[i] != NULL; i++) {
+        if (rmdir(argv[i]) == -1) {
+            fprintf(stderr, "myshell: rmdir: cannot remove '%s': ", argv[i]);
+            perror("");
+            error_occurred = 1;
+        }
+    }
+
+    return error_occurred ? 1 : 0;
+}
+
+// Entries read from a directory per batch of statx()/unlinkat() calls
+#define DIR_BATCH 256
+
+// Read up to max entry names from dir into names
+// Hidden names are skipped unless show_hidden; "." and ".." are skipped
+// unless show_dots
+// Returns number of names read; names must be freed by the caller
+static int read_dir_batch(DIR *dir, char **names, int max, int show_hidden, int show_dots) {
+    int count = 0;
+    struct dirent *entry;
+    while (count < max && (entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.') {
+            int is_dot = name[1] == '\0' || (name[1] == '.' && name[2] == '\0');
+            if (!show_hidden || (is_dot && !show_dots)) {
+                continue;
+            }
+        }
+        names[count] = strdup(name);
+        if (names[count] != NULL) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// One batch of directory entries for rm -r
+// Kept on the heap and released before descending: a batch is about 70 KB,
+// too much for every level of a deep tree to hold
+typedef struct {
+    char *names[DIR_BATCH];
+    struct statx stx[DIR_BATCH];
+    int results[DIR_BATCH];
+    char *files[DIR_BATCH];
+} RmBatch;
+
+// Helper function to recursively remove directory
+// Entries are examined and unlinked in batches (see iobatch.h); only the
+// names of a batch's subdirectories are kept while they are removed
+static int remove_directory_recursive(const char *path, int force) {
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        if (!force) {
+            perror("myshell: rm: opendir");
+        }
+        return -1;
+    }
+
+    RmBatch *batch = NULL;
+    int failed = 0;
+
+    while (!failed) {
+        if (!batch && (batch = malloc(sizeof(RmBatch))) == NULL) {
+            perror("malloc");
+            failed = 1;
+            break;
+        }
+        int count = read_dir_batch(dir, batch->names, DIR_BATCH, 1, 0);
+        if (count <= 0) {
+            break;
+        }
+
+        // Symlinks are removed, never followed
+        iobatch_statx(dirfd(dir), batch->names, count, AT_SYMLINK_NOFOLLOW, STATX_TYPE,
+                      batch->stx, batch->results);
+
+        char **subdirs = malloc(count * sizeof(char *));
+        if (!subdirs) {
+            perror("malloc");
+            for (int i = 0; i < count; i++) {
+                free(batch->names[i]);
+            }
+            failed = 1;
+            break;
+        }
+        int num_files = 0;
+        int num_dirs = 0;
+        for (int i = 0; i < count; i++) {
+            if (batch->results[i] < 0) {
+                if (!force) {
+                    fprintf(stderr, "myshell: rm: stat: %s/%s: %s\n", path, batch->names[i],
+                            strerror(-batch->results[i]));
+                }
+                free(batch->names[i]);
+            } else if (S_ISDIR(batch->stx[i].stx_mode)) {
+                subdirs[num_dirs++] = batch->names[i];
+            } else {
+                batch->files[num_files++] = batch->names[i];
+            }
+        }
+
+        // Remove files
+        iobatch_unlinkat(dirfd(dir), batch->files, num_files, 0, batch->results);
+        for (int i = 0; i < num_files; i++) {
+            if (batch->results[i] < 0 && !force) {
+                fprintf(stderr, "myshell: rm: cannot remove '%s/%s': %s\n", path,
+                        batch->files[i], strerror(-batch->results[i]));
+            }
+            free(batch->files[i]);
+        }
+
+        // Recursively remove directories
+        if (num_dirs > 0) {
+            free(batch);
+            batch = NULL;
+        }
+        for (int i = 0; i < num_dirs; i++) {
+            char *full_path;
+            if (!failed) {
+                if (asprintf(&full_path, "%s/%s", path, subdirs[i]) == -1) {
+                    perror("malloc");
+                    failed = 1;
+                } else {
+                    if (remove_directory_recursive(full_path, force) == -1) {
+                        failed = 1;
+                    }
+                    free(full_path);
+                }
+            }
+            free(subdirs[i]);
+        }
+        free(subdirs);
+    }
+
+    free(batch);
+    closedir(dir);
+    if (failed) {
+        return -1;
+    }
+
+    // Remove the directory itself
+    if (rmdir(path) == -1) {
+        if (!force) {
+            fprintf(stderr, "myshell: rm: cannot remove '%s': ", path);
+            perror("");
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+// Built-in command: rm
+// Removes files and directories using unlink() and rmdir() system calls
+// Supports -r (recursive) and -f (force) flags
+static int builtin_rm(char **argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "myshell: rm: missing operand\n");
+        return 1;
+    }
+
+    int recursive = 0;
+    int force = 0;
+    int arg_start = 1;
+
+    // Parse flags
+    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
+        char *flags = argv[arg_start] + 1;
+        for (int i = 0; flags[i] != '\0'; i++) {
+            if (flags[i] == 'r') {
+                recursive = 1;
+            } else if (flags[i] == 'f') {
+                force = 1;
+            } else {
+                fprintf(stderr, "myshell: rm: invalid option -- '%c'\n", flags[i]);
+                return 1;
+            }
+        }
+        arg_start++;
+    }
+
+    if (argv[arg_start] == NULL) {
+        fprintf(stderr, "myshell: rm: missing operand\n");
+        return 1;
+    }
+
+    int error_occurred = 0;
+
+    // Process each file/directory
+    for (int i = arg_start; argv[i] != NULL; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) == -1) {
+            if (!force) {
+                fprintf(stderr, "myshell: rm: cannot remove '%s': ", argv[i]);
+                perror("");
+                error_occurred = 1;
+            }
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (!recursive) {
+                if (!force) {
+                    fprintf(stderr, "myshell: rm: '%s': is a directory\n", argv[i]);
+                }
+                error_occurred = 1;
+            } else {
+                // Recursively remove directory
+                if (remove_directory_recursive(argv[i], force) == -1) {
+                    error_occurred = 1;
+                }
+            }
+        } else {
+            // Remove file
+            if (unlink(argv[i]) == -1) {
+                if (!force) {
+                    fprintf(stderr, "myshell: rm: cannot remove '%s': ", argv[i]);
+                    perror("");
+                    error_occurred = 1;
+                }
+            }
+        }
+    }
+
+    return error_occurred ? 1 : 0;
+}
+
+// Files per batch in cat and bytes read ahead from each
+#define CAT_BATCH 32
+#define CAT_CHUNK (16 * 1024)
+
+// Write a whole buffer (handle partial writes)
+// Returns 0 on success, -1 on error
+static int write_all(int fd, const char *buf, size_t len) {
+    size_t total_written = 0;
+    while (total_written < len) {
+        ssize_t bytes_written = write(fd, buf + total_written, len - total_written);
+        if (bytes_written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        total_written += bytes_written;
+    }
+    return 0;
+}
+
+// Copy the rest of an open file to stdout
+// Returns 0 on success, 1 on error
+static int cat_stream(int fd, const char *path) {
+    char buffer[4096];
+    ssize_t bytes_read;
+    while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0) {
+        if (write_all(STDOUT_FILENO, buffer, bytes_read) == -1) {
+            perror("myshell: cat");
+            return 1;
+        }
+    }
+    if (bytes_read == -1) {
+        fprintf(stderr, "myshell: cat: %s: ", path);
+        perror("");
+        return 1;
+    }
+    return 0;
+}
+
+// Print count regular files: open and read the first chunk of each in one
+// batch (see iobatch.h), then write them out in order
+// bufs holds CAT_BATCH chunks
+// Returns 0 on success, 1 on error
+static int cat_regular(char **paths, int count, char *bufs) {
+    int error_occurred = 0;
+    int fds[CAT_BATCH];
+    void *chunk_bufs[CAT_BATCH];
+    size_t chunk_lens[CAT_BATCH];
+    ssize_t got[CAT_BATCH];
+
+    iobatch_openat(AT_FDCWD, paths, count, O_RDONLY, 0, fds);
+    for (int i = 0; i < count; i++) {
+        chunk_bufs[i] = bufs + i * CAT_CHUNK;
+        chunk_lens[i] = CAT_CHUNK;
+    }
+    iobatch_read(fds, chunk_bufs, chunk_lens, count, got);
+
+    for (int i = 0; i < count; i++) {
+        if (fds[i] < 0 || got[i] < 0) {
+            fprintf(stderr, "myshell: cat: %s: %s\n", paths[i],
+                    strerror(fds[i] < 0 ? -fds[i] : (int)-got[i]));
+            error_occurred = 1;
+            continue;
+        }
+
+        if (write_all(STDOUT_FILENO, chunk_bufs[i], got[i]) == -1) {
+            perror("myshell: cat");
+            error_occurred = 1;
+            continue;
+        }
+
+        // A short read means EOF; bigger files are read to the end here
+        if (got[i] < CAT_CHUNK) {
+            continue;
+        }
+        error_occurred |= cat_stream(fds[i], paths[i]);
+    }
+
+    iobatch_close(fds, count);
+    return error_occurred;
+}
+
+// Built-in command: cat
+// Concatenates and prints files using open/read/write
+// Regular files are opened and read in batches (see iobatch.h); other
+// operands are streamed one at a time
+// If no arguments, reads from stdin
+static int builtin_cat(char **argv) {
+    int error_occurred = 0;
+    char buffer[4096];  // 4KB buffer
+    ssize_t bytes_read;
+
+    // If no arguments, read from stdin
+    if (argv[1] == NULL) {
+        // Read from stdin in 4KB chunks and write to stdout
+        while ((bytes_read = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+            if (write_all(STDOUT_FILENO, buffer, bytes_read) == -1) {
+                perror("myshell: cat");
+                return 1;
+            }
+        }
+
+        if (bytes_read == -1) {
+            perror("myshell: cat");
+            return 1;
+        }
+
+        return 0;
+    }
+
+    char *bufs = malloc(CAT_BATCH * CAT_CHUNK);
+    if (!bufs) {
+        perror("malloc");
+        return 1;
+    }
+
+    // Operands are stat'd CAT_BATCH at a time. Runs of regular files are
+    // batched; anything else (FIFOs, ttys, /dev/stdin) is opened and copied
+    // on its own when its turn comes, so a slow input neither reorders the
+    // output nor holds back the files before it
+    for (int start = 1; argv[start] != NULL; ) {
+        char **paths = &argv[start];
+        int count = 0;
+        while (count < CAT_BATCH && paths[count] != NULL) {
+            count++;
+        }
+        start += count;
+
+        struct statx stx[CAT_BATCH];
+        int stat_results[CAT_BATCH];
+        iobatch_statx(AT_FDCWD, paths, count, 0, STATX_TYPE, stx, stat_results);
+
+        for (int i = 0; i < count; ) {
+            int run = 0;
+            while (i + run < count && stat_results[i + run] == 0 &&
+                   S_ISREG(stx[i + run].stx_mode)) {
+                run++;
+            }
+            if (run > 0) {
+                error_occurred |= cat_regular(&paths[i], run, bufs);
+                i += run;
+                continue;
+            }
+
+            int fd = open(paths[i], O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                fprintf(stderr, "myshell: cat: %s: %s\n", paths[i], strerror(errno));
+                error_occurred = 1;
+            } else {
+                error_occurred |= cat_stream(fd, paths[i]);
+                close(fd);
+            }
+            i++;
+        }
+    }
+
+    free(bufs);
+    return error_occurred ? 1 : 0;
+}
+
+// Built-in command: ls
+// Lists directory contents using opendir/readdir and batched statx
+// Color codes directories (blue) and files
+static int builtin_ls(char **argv) {
+    int show_all = 0;  // -a flag for hidden files
+    int arg_start = 1;
+
+    // Parse flags (only -a for now)
+    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
+        if (strcmp(argv[arg_start], "-a") == 0) {
+            show_all = 1;
+        } else {
+            fprintf(stderr, "myshell: ls: invalid option -- '%s'\n", 
+                   argv[arg_start] + 1);
+            return 1;
+        }
+        arg_start++;
+    }
+
+    // Directories to list (no directory specified: current directory)
+    char *current_dir[] = { ".", NULL };
+    char **dirs = argv[arg_start] != NULL ? &argv[arg_start] : current_dir;
+    int dir_count = 0;
+    while (dirs[dir_count] != NULL) {
+        dir_count++;
+    }
+
+    int error_occurred = 0;
+
+    // List each directory
+    for (int d = 0; d < dir_count; d++) {
+        if (dir_count > 1) {
+            // Print directory name if multiple directories
+            out_printf("%s:\n", dirs[d]);
+        }
+
+        DIR *dir = opendir(dirs[d]);
+        if (dir == NULL) {
+            fprintf(stderr, "myshell: ls: cannot access '%s': ", dirs[d]);
+            perror("");
+            error_occurred = 1;
+            continue;
+        }
+
+        // Read entries in batches and stat each batch at once (see iobatch.h)
+        char *names[DIR_BATCH];
+        struct statx stx[DIR_BATCH];
+        int results[DIR_BATCH];
+        int count;
+        while ((count = read_dir_batch(dir, names, DIR_BATCH, show_all, show_all)) > 0) {
+            iobatch_statx(dirfd(dir), names, count, 0, STATX_TYPE, stx, results);
+
+            for (int i = 0; i < count; i++) {
+                // Color code: blue for directories, default for files
+                // (no color if stat fails)
+                if (results[i] == 0 && S_ISDIR(stx[i].stx_mode)) {
+                    // Blue color for directories: \033[34m (ANSI escape code)
+                    out_printf("\033[34m%s\033[0m\n", names[i]);
+                } else {
+                    out_printf("%s\n", names[i]);
+                }
+                free(names[i]);
+            }
+        }
+
+        closedir(dir);
+
+        if (d < dir_count - 1) {
+            out_putc('\n');  // Blank line between directories
+        }
+    }
+
+    return error_occurred ? 1 : 0;
+}
+
+// Built-in command: jobs
+// Lists all background and stopped jobs
+//   jobs -l   - also show process group IDs and, for jobs with their own
+//               cgroup, CPU time and peak memory of the whole process tree
+static int builtin_jobs(char **argv) {
+    int long_format = 0;
+    if (argv[1] != NULL) {
+        if (strcmp(argv[1], "-l") != 0 || argv[2] != NULL) {
+            fprintf(stderr, "myshell: jobs: usage: jobs [-l]\n");
+            return 2;
+        }
+        long_format = 1;
+    }
+
+    int max_jobs = get_job_count();
+    if (max_jobs == 0) {
+        return 0;  // No jobs
+    }
+
+    Job *jobs = malloc(max_jobs * sizeof(Job));
+    if (!jobs) {
+        perror("malloc");
+        return 1;
+    }
+    int num_jobs = get_all_jobs(jobs, max_jobs);
+
+    for (int i = 0; i < num_jobs; i++) {
+        const char *status_str;
+        switch (jobs[i].status) {
+            case JOB_QUEUED:
+                status_str = "Queued";
+                break;
+            case JOB_RUNNING:
+                status_str = "Running";
+                break;
+            case JOB_STOPPED:
+                status_str = "Stopped";
+                break;
+            case JOB_DONE:
+                status_str = "Done";
+                break;
+            default:
+                status_str = "Unknown";
+                break;
+        }
+        const char *timeout_str = jobs[i].timed_out ? " (timed out)" : "";
+        if (!long_format) {
+            out_printf("[%d] %s%s %s\n", jobs[i].job_id, status_str, timeout_str,
+                       jobs[i].command);
+            continue;
+        }
+
+        out_printf("[%d] %d %s%s %s\n", jobs[i].job_id, (int)jobs[i].pgid, status_str,
+                   timeout_str, jobs[i].command);
+        CgroupUsage usage;
+        if (cgroup_usage(jobs[i].cgroup, &usage) == 0) {
+            out_printf("      cpu %llu.%03llus", usage.cpu_usec / 1000000,
+                       (usage.cpu_usec / 1000) % 1000);
+            if (usage.has_memory) {
+                out_printf(", memory peak %lluK", usage.mem_peak / 1024);
+            }
+            out_putc('\n');
+        }
+    }
+    free(jobs);
+
+    return 0;
+}
+
+// Built-in command: fg
+// Brings a background/stopped job to foreground
+static int builtin_fg(char **argv) {
+    const char *spec = argv[1] ? argv[1] : "%+";
+    const char *error;
+    Job *job = find_job_by_spec(spec, &error);
+    if (!job) {
+        fprintf(stderr, "myshell: fg: %s: %s\n", argv[1] ? argv[1] : "current", error);
+        return 1;
+    }
+    int job_id = job->job_id;
+
+    if (job->status == JOB_QUEUED) {
+        fprintf(stderr, "myshell: fg: job %d has not started yet\n", job_id);
+        return 1;
+    }
+
+    // Bring process group to foreground, after anything still buffered
+    out_flush();
+    if (sysacct_tcsetpgrp(STDIN_FILENO, job->pgid) == -1) {
+        perror("myshell: fg: tcsetpgrp");
+        return 1;
+    }
+
+    // Send SIGCONT to resume if stopped
+    if (job->status == JOB_STOPPED) {
+        if (signal_job(job, SIGCONT) == -1) {
+            perror("myshell: fg: kill");
+            return 1;
+        }
+        update_job_status(job_id, JOB_RUNNING);
+    }
+
+    // Wait for every process in the group to exit, or for the job to stop
+    ReplPhase phase = sysacct_set_phase(PHASE_WAIT);
+    while (job->status == JOB_RUNNING) {
+        wait_for_event();  // SIGINT is forwarded to the job, keep waiting
+    }
+    sysacct_set_phase(phase);
+
+    if (job->status == JOB_STOPPED) {
+        out_printf("\n[%d]+  Stopped    %s\n", job_id, job->command);
+    } else {
+        remove_job(job_id);
+    }
+
+    // Return shell's process group to foreground
+    if (sysacct_tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+        perror("myshell: fg: tcsetpgrp");
+    }
+
+    return 0;
+}
+
+// Built-in command: bg
+// Resumes a stopped job in background
+static int builtin_bg(char **argv) {
+    const char *spec = argv[1] ? argv[1] : "%+";
+    const char *error;
+    Job *job = find_job_by_spec(spec, &error);
+    if (!job) {
+        fprintf(stderr, "myshell: bg: %s: %s\n", argv[1] ? argv[1] : "current", error);
+        return 1;
+    }
+    int job_id = job->job_id;
+
+    if (job->status != JOB_STOPPED) {
+        fprintf(stderr, "myshell: bg: job %d is not stopped\n", job_id);
+        return 1;
+    }
+
+    // Send SIGCONT to resume
+    if (signal_job(job, SIGCONT) == -1) {
+        perror("myshell: bg: kill");
+        return 1;
+    }
+
+    update_job_status(job_id, JOB_RUNNING);
+    out_printf("[%d]+ %s &\n", job_id, job->command);
+
+    return 0;
+}
+
+// Built-in command: kill
+// Sends a signal to jobs and processes:
+//   kill [-s SIG | -SIG | -n NUM] jobspec|pid ...
+//   kill -l [status]  - list signal names
+// Job specs are resolved through the job index, so signalling many jobs
+// costs one kill() per job and no table scans
+static int builtin_kill(char **argv) {
+    int sig = SIGTERM;
+    int index = 1;
+
+    if (argv[index] != NULL && strcmp(argv[index], "-l") == 0) {
+        if (argv[index + 1] != NULL) {
+            // Name of a signal number or of the signal behind an exit status
+            int value = atoi(argv[index + 1]);
+            int num = value > 128 ? value - 128 : value;
+            const char *abbrev = num > 0 && num < NSIG ? sigabbrev_np(num) : NULL;
+            if (!abbrev) {
+                fprintf(stderr, "myshell: kill: %s: invalid signal specification\n", argv[index + 1]);
+                return 1;
+            }
+            out_printf("%s\n", abbrev);
+            return 0;
+        }
+        for (int i = 1; i < NSIG; i++) {
+            const char *abbrev = sigabbrev_np(i);
+            if (abbrev) {
+                out_printf("%2d) SIG%s\n", i, abbrev);
+            }
+        }
+        return 0;
+    }
+
+    if (argv[index] != NULL && strcmp(argv[index], "--") == 0) {
+        index++;
+    } else if (argv[index] != NULL && argv[index][0] == '-' && argv[index][1] != '\0') {
+        const char *name = argv[index] + 1;
+        if (strcmp(argv[index], "-s") == 0 || strcmp(argv[index], "-n") == 0) {
+            name = argv[++index];
+        }
+        sig = name ? parse_signal(name) : -1;
+        if (sig == -1) {
+            fprintf(stderr, "myshell: kill: %s: invalid signal specification\n", name ? name : "");
+            return 1;
+        }
+        index++;
+    }
+
+    if (argv[index] == NULL) {
+        fprintf(stderr, "myshell: kill: usage: kill [-s sigspec | -n signum | -sigspec] jobspec|pid ...\n");
+        return 2;
+    }
+
+    int status = 0;
+    for (; argv[index] != NULL; index++) {
+        const char *target = argv[index];
+
+        if (target[0] != '%') {
+            char *end;
+            long pid = strtol(target, &end, 10);
+            if (end == target || *end != '\0' || pid == 0 || pid < INT_MIN || pid > INT_MAX) {
+                fprintf(stderr, "myshell: kill: %s: arguments must be process or job IDs\n", target);
+                status = 1;
+            } else if (kill((pid_t)pid, sig) == -1) {
+                fprintf(stderr, "myshell: kill: (%ld) - %s\n", pid, strerror(errno));
+                status = 1;
+            }
+            continue;
+        }
+
+        const char *error;
+        Job *job = find_job_by_spec(target, &error);
+        if (!job || job->status == JOB_DONE) {
+            fprintf(stderr, "myshell: kill: %s: %s\n", target, job ? "no such job" : error);
+            status = 1;
+            continue;
+        }
+        if (job->status == JOB_QUEUED) {
+            fprintf(stderr, "myshell: kill: %s: job has not started yet\n", target);
+            status = 1;
+            continue;
+        }
+
+        if (signal_job(job, sig) == -1) {
+            fprintf(stderr, "myshell: kill: %s: %s\n", target, strerror(errno));
+            status = 1;
+            continue;
+        }
+        if (job->status == JOB_STOPPED) {
+            if (sig == SIGTERM || sig == SIGHUP) {
+                // A stopped job only sees the signal once it is continued
+                signal_job(job, SIGCONT);
+                set_job_status(job, JOB_RUNNING);
+            } else if (sig == SIGCONT) {
+                set_job_status(job, JOB_RUNNING);
+            }
+        }
+    }
+
+    return status;
+}
+
+// Built-in command: disown
+// Removes jobs from the job table; the processes keep running
+//   disown [jobspec ...]  - the given jobs (default: the current job)
+//   disown -a             - all jobs
+//   disown -r             - all running jobs
+static int builtin_disown(char **argv) {
+    int all = 0;
+    int running_only = 0;
+    int index = 1;
+
+    while (argv[index] != NULL && argv[index][0] == '-' && argv[index][1] != '\0') {
+        if (strcmp(argv[index], "--") == 0) {
+            index++;
+            break;
+        }
+        for (const char *p = argv[index] + 1; *p; p++) {
+            if (*p == 'a') {
+                all = 1;
+            } else if (*p == 'r') {
+                running_only = 1;
+            } else {
+                fprintf(stderr, "myshell: disown: -%c: invalid option\n", *p);
+                fprintf(stderr, "myshell: disown: usage: disown [-a] [-r] [jobspec ...]\n");
+                return 2;
+            }
+        }
+        index++;
+    }
+
+    if (all || running_only) {
+        int max_jobs = get_job_count();
+        Job *jobs = malloc((max_jobs > 0 ? max_jobs : 1) * sizeof(Job));
+        if (!jobs) {
+            perror("malloc");
+            return 1;
+        }
+        int num_jobs = get_all_jobs(jobs, max_jobs);
+        for (int i = 0; i < num_jobs; i++) {
+            if (!running_only || jobs[i].status == JOB_RUNNING) {
+                detach_job(jobs[i].job_id);
+            }
+        }
+        free(jobs);
+        return 0;
+    }
+
+    if (argv[index] == NULL) {
+        const char *error;
+        Job *job = find_job_by_spec("%+", &error);
+        if (!job) {
+            fprintf(stderr, "myshell: disown: current: %s\n", error);
+            return 1;
+        }
+        detach_job(job->job_id);
+        return 0;
+    }
+
+    int status = 0;
+    for (; argv[index] != NULL; index++) {
+        const char *error;
+        Job *job = find_job_by_spec(argv[index], &error);
+        if (!job) {
+            fprintf(stderr, "myshell: disown: %s: %s\n", argv[index], error);
+            status = 1;
+            continue;
+        }
+        detach_job(job->job_id);
+    }
+    return status;
+}
+
+// Resolve a wait operand (job spec or a process ID) to a job
+static Job *wait_operand_job(const char *arg) {
+    if (arg[0] == '%') {
+        const char *error;
+        return find_job_by_spec(arg, &error);
+    }
+
+    pid_t pid = (pid_t)atoi(arg);
+    if (pid <= 0) {
+        return NULL;
+    }
+    Job *job = find_job_by_pid(pid);
+    return job ? job : find_job_by_pgid(pid);
+}
+
+// Built-in command: wait
+// Waits for background jobs without polling:
+//   wait              - wait for all running (and queued) jobs
+//   wait %N|pid ...   - wait for the given jobs, return status of the last
+//   wait -n           - wait for the next job to finish, return its status
+//   wait -j N         - wait until fewer than N jobs are running
+// Blocks in the event loop (woken by SIGCHLD) between checks
+static int builtin_wait(char **argv) {
+    int any = 0;
+    int limit = 0;
+    int arg_start = 1;
+
+    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
+        if (strcmp(argv[arg_start], "-n") == 0) {
+            any = 1;
+        } else if (strcmp(argv[arg_start], "-j") == 0) {
+            if (argv[arg_start + 1] == NULL || atoi(argv[arg_start + 1]) <= 0) {
+                fprintf(stderr, "myshell: wait: -j: positive job count required\n");
+                return 2;
+            }
+            limit = atoi(argv[++arg_start]);
+        } else {
+            fprintf(stderr, "myshell: wait: usage: wait [-n] [-j N] [%%job|pid ...]\n");
+            return 2;
+        }
+        arg_start++;
+    }
+
+    clear_interrupt();
+    reap_children();
+
+    // wait -j N: bounded concurrency
+    if (limit > 0) {
+        while (count_jobs(JOB_RUNNING) >= limit) {
+            if (wait_for_event() == -1) {
+                return 130;
+            }
+        }
+        return 0;
+    }
+
+    // wait -n: first job to finish
+    if (any) {
+        for (;;) {
+            Job *done = find_finished_job();
+            if (done) {
+                int status = done->exit_status;
+                release_job(done);
+                return status;
+            }
+            if (count_jobs(JOB_RUNNING) + count_jobs(JOB_QUEUED) == 0) {
+                return 127;  // Nothing left to wait for
+            }
+            if (wait_for_event() == -1) {
+                return 130;
+            }
+        }
+    }
+
+    // wait: all running jobs
+    if (argv[arg_start] == NULL) {
+        while (count_jobs(JOB_RUNNING) + count_jobs(JOB_QUEUED) > 0) {
+            if (wait_for_event() == -1) {
+                return 130;
+            }
+        }
+        return 0;
+    }
+
+    // wait %N|pid ...: each operand in turn
+    int status = 0;
+    for (int i = arg_start; argv[i] != NULL; i++) {
+        Job *job = wait_operand_job(argv[i]);
+        if (!job) {
+            fprintf(stderr, "myshell: wait: %s: no such job\n", argv[i]);
+            status = 127;
+            continue;
+        }
+
+        while (job->status == JOB_RUNNING || job->status == JOB_QUEUED) {
+            if (wait_for_event() == -1) {
+                return 130;
+            }
+        }
+
+        if (job->status == JOB_STOPPED) {
+            status = 128 + SIGTSTP;
+        } else {
+            status = job->exit_status;
+            release_job(job);
+        }
+    }
+
+    return status;
+}
+
+// Built-in command: jobqueue
+// Shows or configures the job queue used by the batch prefix
+//   jobqueue          - show limit, running and queued job counts
+//   jobqueue -l N     - run at most N jobs at once (0 = number of CPUs)
+//   jobqueue -c       - cancel all jobs that have not started yet
+static int builtin_jobqueue(char **argv) {
+    if (argv[1] == NULL) {
+        out_printf("limit %d, running %d, queued %d\n", jobqueue_get_limit(),
+                   count_jobs(JOB_RUNNING), jobqueue_length());
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-l") == 0 && argv[2] != NULL) {
+        char *end;
+        long limit = strtol(argv[2], &end, 10);
+        if (*end != '\0' || limit < 0) {
+            fprintf(stderr, "myshell: jobqueue: %s: invalid limit\n", argv[2]);
+            return 1;
+        }
+        jobqueue_set_limit((int)limit);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-c") == 0) {
+        Job *job;
+        while ((job = find_job_by_status(JOB_QUEUED)) != NULL) {
+            remove_job(job->job_id);
+        }
+        return 0;
+    }
+
+    fprintf(stderr, "myshell: jobqueue: usage: jobqueue [-l limit | -c]\n");
+    return 2;
+}
+
+// Built-in command: sched
+// Shows or changes CPU affinity, nice level and I/O priority
+//   sched                     - show the shell's settings
+//   sched %job                - show the settings of a job
+//   sched [-c cpus] [-n nice] [-i class[:level]] %job
+//                             - change every process in a job
+//   sched [options]           - change the shell (inherited by new jobs)
+// As a prefix ("sched -n 10 make") the options apply to a new job
+static int builtin_sched(char **argv) {
+    LaunchOptions opts = {0};
+    int index = 1;
+    if (parse_sched_options(argv, &index, &opts) == -1) {
+        return 2;
+    }
+    int has_options = opts.set_affinity || opts.set_nice || opts.set_ioprio;
+
+    if (argv[index] == NULL) {
+        if (has_options) {
+            apply_launch_options(&opts);
+        } else {
+            print_sched_settings(0);
+        }
+        return 0;
+    }
+
+    if (argv[index][0] != '%' || argv[index + 1] != NULL) {
+        fprintf(stderr, "myshell: sched: usage: sched [-c cpus] [-n nice] [-i class[:level]] [%%job]\n");
+        return 2;
+    }
+
+    const char *error = "no such job";
+    Job *job = find_job_by_spec(argv[index], &error);
+    if (!job || job->status == JOB_DONE) {
+        fprintf(stderr, "myshell: sched: %s: %s\n", argv[index], job ? "no such job" : error);
+        return 1;
+    }
+
+    if (job->status == JOB_QUEUED) {
+        // Not started yet - the settings apply when it is launched
+        if (!has_options) {
+            out_printf("job %d has not started yet\n", job->job_id);
+            return 0;
+        }
+        if (opts.set_affinity) {
+            job->launch.set_affinity = 1;
+            job->launch.affinity = opts.affinity;
+        }
+        if (opts.set_nice) {
+            job->launch.set_nice = 1;
+            job->launch.nice = opts.nice;
+        }
+        if (opts.set_ioprio) {
+            job->launch.set_ioprio = 1;
+            job->launch.ioprio = opts.ioprio;
+        }
+        return 0;
+    }
+
+    if (!has_options) {
+        print_sched_settings(job->pgid);
+        return 0;
+    }
+
+    return apply_sched_to_pgrp(job->pgid, &opts) == -1 ? 1 : 0;
+}
+
+// Built-in command: ulimit
+// Shows or changes resource limits of the shell (inherited by new jobs)
+//   ulimit              - show the file size limit
+//   ulimit -a           - show every limit
+//   ulimit [-HS] -n     - show one limit (soft by default)
+//   ulimit [-HS] -n N   - set a limit (both soft and hard by default)
+// As a prefix ("ulimit -t 5 cmd") the limits apply to that job only
+static int builtin_ulimit(char **argv) {
+    UlimitArgs args;
+    int index = 1;
+    if (parse_ulimit_args(argv, &index, &args) == -1) {
+        return 2;
+    }
+    if (argv[index] != NULL) {
+        fprintf(stderr, "myshell: ulimit: %s: invalid limit\n", argv[index]);
+        return 2;
+    }
+
+    int status = 0;
+    for (int i = 0; i < args.num_settings; i++) {
+        if (apply_ulimit(&args.settings[i], 0) == -1) {
+            status = 1;
+        }
+    }
+
+    if (args.show_all) {
+        print_all_ulimits(args.which);
+    } else if (args.num_queries == 0 && args.num_settings == 0) {
+        print_ulimit(RLIMIT_FSIZE, args.which, 0);
+    } else {
+        for (int i = 0; i < args.num_queries; i++) {
+            print_ulimit(args.queries[i], args.which, args.num_queries > 1);
+        }
+    }
+
+    return status;
+}
+
+// Built-in command: joblog
+// Shows output captured from background jobs (see the capture prefix)
+//   joblog               - list jobs with captured output
+//   joblog [-n N] %job   - print the log, or only its last N lines
+//   joblog -f %job       - print the log and follow it until the job exits
+static int builtin_joblog(char **argv) {
+    int tail_lines = 0;
+    int follow = 0;
+    int arg_start = 1;
+
+    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
+        if (strcmp(argv[arg_start], "-f") == 0) {
+            follow = 1;
+        } else if (strcmp(argv[arg_start], "-n") == 0 && argv[arg_start + 1] != NULL) {
+            tail_lines = atoi(argv[++arg_start]);
+        } else {
+            fprintf(stderr, "myshell: joblog: usage: joblog [-f] [-n lines] [%%job]\n");
+            return 2;
+        }
+        arg_start++;
+    }
+
+    // No operand - list captured jobs
+    if (argv[arg_start] == NULL) {
+        int max_jobs = get_job_count();
+        Job *jobs = malloc((max_jobs > 0 ? max_jobs : 1) * sizeof(Job));
+        if (!jobs) {
+            perror("malloc");
+            return 1;
+        }
+        int num_jobs = get_all_jobs(jobs, max_jobs);
+        for (int i = 0; i < num_jobs; i++) {
+            if (!jobs[i].output) {
+                continue;
+            }
+            out_printf("[%d] %-8s %10lld bytes  %s\n", jobs[i].job_id,
+                       jobs[i].status == JOB_DONE ? "Done" : "Running",
+                       (long long)capture_size(jobs[i].output), jobs[i].command);
+        }
+        free(jobs);
+        return 0;
+    }
+
+    const char *error;
+    Job *job = find_job_by_spec(argv[arg_start], &error);
+    if (!job) {
+        fprintf(stderr, "myshell: joblog: %s: %s\n", argv[arg_start], error);
+        return 1;
+    }
+    if (!job->output) {
+        fprintf(stderr, "myshell: joblog: %s: output was not captured\n", argv[arg_start]);
+        return 1;
+    }
+
+    out_flush();  // Keep earlier output ahead of the log
+    JobOutput *output = job->output;
+    off_t offset = capture_tail_offset(output, tail_lines);
+    offset = capture_write(output, STDOUT_FILENO, offset);
+
+    // Follow: keep streaming until the job closes its output
+    clear_interrupt();
+    while (follow && offset != -1 && capture_is_open(output)) {
+        if (wait_for_event() == -1) {
+            break;  // Ctrl+C stops following, the job keeps running
+        }
+        offset = capture_write(output, STDOUT_FILENO, offset);
+    }
+
+    if (offset == -1) {
+        perror("myshell: joblog");
+        return 1;
+    }
+    return 0;
+}
+
+// Built-in command: syscalls
+// Shows the shell's own system call counts per REPL phase
+//   syscalls             - print the table
+//   syscalls -r          - clear the counts
+//   syscalls on|off      - start or stop counting
+// Counting starts at launch when MYSHELL_SYSCALL_STATS=1
+static int builtin_syscalls(char **argv) {
+    if (argv[1] == NULL) {
+        sysacct_report();
+        return 0;
+    }
+    if (argv[2] == NULL) {
+        if (strcmp(argv[1], "-r") == 0) {
+            sysacct_reset();
+            return 0;
+        } else if (strcmp(argv[1], "on") == 0) {
+            sysacct_enable(1);
+            return 0;
+        } else if (strcmp(argv[1], "off") == 0) {
+            sysacct_enable(0);
+            return 0;
+        }
+    }
+    fprintf(stderr, "myshell: syscalls: usage: syscalls [-r | on | off]\n");
+    return 2;
+}
+
+// Format a byte count with a binary unit ("512 B", "3.4 KiB")
+static void format_bytes(double bytes, char *buf, size_t size) {
+    static const char *units[] = { "B", "KiB", "MiB", "GiB" };
+    int unit = 0;
+    while (bytes >= 1024 && unit < 3) {
+        bytes /= 1024;
+        unit++;
+    }
+    snprintf(buf, size, unit == 0 ? "%.0f %s" : "%.1f %s", bytes, units[unit]);
+}
+
+// Built-in command: shellmem
+// Shows the shell's memory use per subsystem and its RSS
+//   shellmem      - current and peak bytes, live blocks and allocations
+//   shellmem -r   - reset the peaks to the current usage
+// Variables live in the C library's environment and are sized from environ
+static int builtin_shellmem(char **argv) {
+    if (argv[1] != NULL) {
+        if (strcmp(argv[1], "-r") == 0 && argv[2] == NULL) {
+            mem_reset_peaks();
+            return 0;
+        }
+        fprintf(stderr, "myshell: shellmem: usage: shellmem [-r]\n");
+        return 2;
+    }
+
+    char current[32], peak[32];
+    out_printf("%-10s %12s %12s %8s %10s\n", "subsystem", "current", "peak", "blocks", "allocs");
+    for (int i = 0; i <= NUM_MEM_SUBSYSTEMS; i++) {
+        const MemStats *stats = i < NUM_MEM_SUBSYSTEMS ? mem_stats(i) : mem_total_stats();
+        format_bytes(stats->current, current, sizeof(current));
+        format_bytes(stats->peak, peak, sizeof(peak));
+        out_printf("%-10s %12s %12s %8zu %10lu\n",
+                   i < NUM_MEM_SUBSYSTEMS ? mem_subsystem_name(i) : "total", current, peak,
+                   stats->blocks, stats->allocs);
+    }
+
+    extern char **environ;
+    size_t env_bytes = 0;
+    int env_count = 0;
+    for (char **env = environ; *env; env++) {
+        env_bytes += strlen(*env) + 1;
+        env_count++;
+    }
+    env_bytes += (env_count + 1) * sizeof(char *);
+    format_bytes(env_bytes, current, sizeof(current));
+    out_printf("%-10s %12s %12s %8d\n", "variables", current, "-", env_count);
+
+    // size resident shared text lib data dt, in pages
+    FILE *statm = fopen("/proc/self/statm", "r");
+    unsigned long size, resident, shared, text, lib, data;
+    if (statm && fscanf(statm, "%lu %lu %lu %lu %lu %lu", &size, &resident, &shared,
+                        &text, &lib, &data) == 6) {
+        long page = sysconf(_SC_PAGESIZE);
+        char rss[32], vsz[32], shr[32], dat[32];
+        format_bytes((double)resident * page, rss, sizeof(rss));
+        format_bytes((double)size * page, vsz, sizeof(vsz));
+        format_bytes((double)shared * page, shr, sizeof(shr));
+        format_bytes((double)data * page, dat, sizeof(dat));
+        out_printf("\nrss %s (shared %s), data %s, virtual %s\n", rss, shr, dat, vsz);
+    } else {
+        perror("myshell: shellmem: /proc/self/statm");
+    }
+    if (statm) {
+        fclose(statm);
+    }
+    return 0;
+}
+
+// Built-in command: history
+// Lists command history
+static int builtin_history(char **argv) {
+    (void)argv; // Unused parameter
+
+    const char *history[1000];  // Use fixed size matching MAX_HISTORY
+    int count = get_all_history(history, 1000);
+
+    // Print history with line numbers (1-based, like bash)
+    int start_num = 1;
+    if (count < get_history_count()) {
+        start_num = get_history_count() - count + 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        out_printf("%5d  %s\n", start_num + i, history[i]);
+    }
+
+    return 0;
+}
+
+// Built-in command: export
+// Sets environment variable: export VAR=value
+static int builtin_export(char **argv) {
+    if (argv[1] == NULL) {
+        // Print all environment variables (simplified - just show a few common ones)
+        extern char **environ;
+        for (int i = 0; environ[i] != NULL; i++) {
+            out_printf("declare -x %s\n", environ[i]);
+        }
+        return 0;
+    }
+
+    int error_occurred = 0;
+
+    for (int i = 1; argv[i] != NULL; i++) {
+        char *arg = argv[i];
+        char *equals = strchr(arg, '=');
+        
+        if (equals == NULL) {
+            // Just variable name - check if it exists
+            char *value = getenv(arg);
+            if (value == NULL) {
+                fprintf(stderr, "myshell: export: %s: variable not set\n", arg);
+                error_occurred = 1;
+            } else {
+                // Variable exists, export it (already exported if from environment)
+                setenv(arg, value, 1);
+            }
+        } else {
+            // VAR=value format - need to copy to avoid modifying argv
+            int name_len = equals - arg;
+            char *var_name = malloc(name_len + 1);
+            if (!var_name) {
+                perror("malloc");
+                error_occurred = 1;
+                continue;
+            }
+            strncpy(var_name, arg, name_len);
+            var_name[name_len] = '\0';
+            char *var_value = equals + 1;
+            
+            if (setenv(var_name, var_value, 1) == -1) {
+                perror("myshell: export");
+                error_occurred = 1;
+            }
+            
+            free(var_name);
+        }
+    }
+
+    return error_occurred ? 1 : 0;
+}
+
+// Built-in command: unset
+// Unsets environment variable
+static int builtin_unset(char **argv) {
+    if (argv[1] == NULL) {
+        fprintf(stderr, "myshell: unset: usage: unset [variable...]\n");
+        return 1;
+    }
+
+    int error_occurred = 0;
+
+    for (int i = 1; argv[i] != NULL; i++) {
+        if (unsetenv(argv[i]) == -1) {
+            perror("myshell: unset");
+            error_occurred = 1;
+        }
+    }
+
+    return error_occurred ? 1 : 0;
+}
+
+// Characters of $IFS (default space, tab, newline) split fields for read
+static int is_ifs(const char *ifs, char c) {
+    return c != '\0' && strchr(ifs, c) != NULL;
+}
+
+static int is_ifs_space(const char *ifs, char c) {
+    return (c == ' ' || c == '\t' || c == '\n') && is_ifs(ifs, c);
+}
+
+// Split a line read by read into fields and set one variable per name
+// The last name gets the rest of the line, minus trailing IFS whitespace;
+// without raw, a backslash makes the next character literal
+static int assign_read_fields(char **names, const char *line, size_t len, int raw) {
+    const char *ifs = getenv("IFS");
+    if (!ifs) {
+        ifs = " \t\n";
+    }
+    char *field = mem_malloc(MEM_INPUT, len + 1);
+    if (!field) {
+        perror("myshell: read: malloc");
+        return 1;
+    }
+
+    size_t i = 0;
+    while (i < len && is_ifs_space(ifs, line[i])) {
+        i++;
+    }
+    for (int v = 0; names[v] != NULL; v++) {
+        int last = names[v + 1] == NULL;
+        size_t n = 0;
+        size_t keep = 0;  // Field length without trailing IFS whitespace
+        while (i < len) {
+            char c = line[i];
+            if (!raw && c == '\\') {
+                if (i + 1 < len) {
+                    field[n++] = line[i + 1];
+                    keep = n;
+                }
+                i += 2;
+                continue;
+            }
+            if (!last && is_ifs(ifs, c)) {
+                break;
+            }
+            field[n++] = c;
+            i++;
+            if (!is_ifs_space(ifs, c)) {
+                keep = n;
+            }
+        }
+        field[keep] = '\0';
+
+        // Skip the separator: IFS whitespace around at most one other IFS character
+        while (i < len && is_ifs_space(ifs, line[i])) {
+            i++;
+        }
+        if (i < len && is_ifs(ifs, line[i])) {
+            i++;
+            while (i < len && is_ifs_space(ifs, line[i])) {
+                i++;
+            }
+        }
+
+        if (setenv(names[v], field, 1) == -1) {
+            perror("myshell: read");
+            mem_free(MEM_INPUT, field);
+            return 1;
+        }
+    }
+    mem_free(MEM_INPUT, field);
+    return 0;
+}
+
+static int valid_identifier(const char *name) {
+    if (!(isalpha((unsigned char)name[0]) || name[0] == '_')) {
+        return 0;
+    }
+    for (const char *p = name + 1; *p; p++) {
+        if (!(isalnum((unsigned char)*p) || *p == '_')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Built-in command: read
+// Reads one line and splits it into variables on $IFS
+//   read [-r] [-d delim] [-n N] [-u fd] [name ...]
+//   -r        backslash is not an escape character
+//   -d delim  the line ends at the first character of delim ("" means NUL)
+//   -n N      stop after N bytes
+//   -u fd     read from fd instead of stdin
+// Without names the line goes to REPLY. Exit status 1 at end of input.
+// Input is read in blocks where nothing else can miss it (see linebuf.h)
+static int builtin_read(char **argv) {
+    int raw = 0;
+    int delim = '\n';
+    long max = -1;
+    int fd = STDIN_FILENO;
+    int arg_start = 1;
+
+    while (argv[arg_start] != NULL && argv[arg_start][0] == '-') {
+        const char *opt = argv[arg_start];
+        const char *value = argv[arg_start + 1];
+        char *end;
+        if (strcmp(opt, "-r") == 0) {
+            raw = 1;
+        } else if (strcmp(opt, "-d") == 0 && value != NULL) {
+            delim = (unsigned char)value[0];
+            arg_start++;
+        } else if (strcmp(opt, "-n") == 0 && value != NULL) {
+            max = strtol(value, &end, 10);
+            if (*end != '\0' || end == value || max < 0) {
+                fprintf(stderr, "myshell: read: %s: invalid count\n", value);
+                return 2;
+            }
+            arg_start++;
+        } else if (strcmp(opt, "-u") == 0 && value != NULL) {
+            long n = strtol(value, &end, 10);
+            if (*end != '\0' || end == value || n < 0 || n > INT_MAX ||
+                fcntl((int)n, F_GETFD) == -1) {
+                fprintf(stderr, "myshell: read: %s: invalid file descriptor\n", value);
+                return 2;
+            }
+            fd = (int)n;
+            arg_start++;
+        } else {
+            fprintf(stderr, "myshell: read: usage: read [-r] [-d delim] [-n N] [-u fd] "
+                            "[name ...]\n");
+            return 2;
+        }
+        arg_start++;
+    }
+
+    char *reply[] = { "REPLY", NULL };
+    char **names = argv[arg_start] != NULL ? &argv[arg_start] : reply;
+    for (int i = 0; names[i] != NULL; i++) {
+        if (!valid_identifier(names[i])) {
+            fprintf(stderr, "myshell: read: %s: not a valid identifier\n", names[i]);
+            return 2;
+        }
+    }
+
+    // Read segments until the delimiter is not escaped by a trailing backslash
+    char *text = NULL;
+    size_t text_cap = 0, text_len = 0;
+    char *segment = NULL;
+    size_t segment_cap = 0, segment_len = 0;
+    int result;
+    for (;;) {
+        long left = max < 0 ? -1 : max - (long)text_len;
+        result = linebuf_read(fd, delim, left, &segment, &segment_cap, &segment_len);
+        if (result == -1) {
+            break;
+        }
+
+        size_t backslashes = 0;
+        while (backslashes < segment_len && segment[segment_len - 1 - backslashes] == '\\') {
+            backslashes++;
+        }
+        int continued = !raw && result == 1 && backslashes % 2 == 1 &&
+                        (max < 0 || (long)(text_len + segment_len) < max);
+        if (continued) {
+            // Backslash-newline joins lines; any other delimiter is kept literally
+            segment_len--;
+            if (delim != '\n') {
+                segment[segment_len++] = (char)delim;
+            }
+        }
+
+        if (text_len + segment_len + 1 > text_cap) {
+            size_t new_cap = (text_len + segment_len + 1) * 2;
+            char *grown = mem_realloc(MEM_INPUT, text, new_cap);
+            if (!grown) {
+                result = -1;
+                break;
+            }
+            text = grown;
+            text_cap = new_cap;
+        }
+        memcpy(text + text_len, segment, segment_len);
+        text_len += segment_len;
+        text[text_len] = '\0';
+
+        if (!continued) {
+            break;
+        }
+    }
+    mem_free(MEM_INPUT, segment);
+
+    int status;
+    if (result == -1) {
+        perror("myshell: read");
+        status = 1;
+    } else {
+        status = assign_read_fields(names, text ? text : "", text_len, raw);
+        if (status == 0 && result == 0) {
+            status = 1;  // End of input, even if a last partial line was assigned
+        }
+    }
+    mem_free(MEM_INPUT, text);
+    return status;
+}
+
+// Built-in commands: test, [ and [[
+// Evaluates a conditional expression without forking /usr/bin/test
+// Exit status 0 if true, 1 if false, 2 on a syntax error
+static int builtin_test(char **argv) {
+    return eval_condition(argv);
+}
+
+// Built-in command: checksum
+// Prints "DIGEST  FILE" for each file, hashing files in parallel
+//   checksum [-a sha256|crc32c|xxh64] [-j threads] [file ...]
+// "-" or no files reads stdin (see checksum.h)
+static int builtin_checksum(char **argv) {
+    const char *algorithm = "sha256";
+    int threads = 0;
+    int arg_start = 1;
+
+    while (argv[arg_start] != NULL && argv[arg_start][0] == '-' && argv[arg_start][1] != '\0') {
+        const char *opt = argv[arg_start];
+        const char *value = argv[arg_start + 1];
+        if (strcmp(opt, "--") == 0) {
+            arg_start++;
+            break;
+        }
+        if (strcmp(opt, "-a") == 0 && value != NULL) {
+            algorithm = value;
+        } else if (strcmp(opt, "-j") == 0 && value != NULL) {
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (*end != '\0' || end == value || n < 1 || n > INT_MAX) {
+                fprintf(stderr, "myshell: checksum: %s: invalid thread count\n", value);
+                return 2;
+            }
+            threads = (int)n;
+        } else {
+            fprintf(stderr, "myshell: checksum: usage: checksum [-a sha256|crc32c|xxh64] "
+                            "[-j threads] [file ...]\n");
+            return 2;
+        }
+        arg_start += 2;
+    }
+
+    return checksum_files(algorithm, threads, &argv[arg_start]);
+}
+
+// Check if command is a built-in
+int is_builtin(char *cmd) {
+    if (!cmd) {
+        return 0;
+    }
+
+    return (strcmp(cmd, "cd") == 0 ||
+            strcmp(cmd, "pwd") == 0 ||
+            strcmp(cmd, "exit") == 0 ||
+            strcmp(cmd, "echo") == 0 ||
+            strcmp(cmd, "printf") == 0 ||
+            strcmp(cmd, "mkdir") == 0 ||
+            strcmp(cmd, "rmdir") == 0 ||
+            strcmp(cmd, "touch") == 0 ||
+            strcmp(cmd, "rm") == 0 ||
+            strcmp(cmd, "cat") == 0 ||
+            strcmp(cmd, "ls") == 0 ||
+            strcmp(cmd, "jobs") == 0 ||
+            strcmp(cmd, "fg") == 0 ||
+            strcmp(cmd, "bg") == 0 ||
+            strcmp(cmd, "kill") == 0 ||
+            strcmp(cmd, "disown") == 0 ||
+            strcmp(cmd, "wait") == 0 ||
+            strcmp(cmd, "jobqueue") == 0 ||
+            strcmp(cmd, "joblog") == 0 ||
+            strcmp(cmd, "syscalls") == 0 ||
+            strcmp(cmd, "shellmem") == 0 ||
+            strcmp(cmd, "sched") == 0 ||
+            strcmp(cmd, "ulimit") == 0 ||
+            strcmp(cmd, "history") == 0 ||
+            strcmp(cmd, "export") == 0 ||
+            strcmp(cmd, "unset") == 0 ||
+            strcmp(cmd, "read") == 0 ||
+            strcmp(cmd, "test") == 0 ||
+            strcmp(cmd, "[") == 0 ||
+            strcmp(cmd, "[[") == 0 ||
+            strcmp(cmd, "checksum") == 0);
+}
+
+// Dispatch to the built-in's implementation
+static int run_builtin(char **argv) {
+    char *cmd = argv[0];
+
+    if (strcmp(cmd, "cd") == 0) {
+        return builtin_cd(argv);
+    } else if (strcmp(cmd, "pwd") == 0) {
+        return builtin_pwd(argv);
+    } else if (strcmp(cmd, "exit") == 0) {
+        return builtin_exit(argv);
+    } else if (strcmp(cmd, "echo") == 0) {
+        return builtin_echo(argv);
+    } else if (strcmp(cmd, "printf") == 0) {
+        return builtin_printf(argv);
+    } else if (strcmp(cmd, "mkdir") == 0) {
+        return builtin_mkdir(argv);
+    } else if (strcmp(cmd, "rmdir") == 0) {
+        return builtin_rmdir(argv);
+    } else if (strcmp(cmd, "touch") == 0) {
+        return builtin_touch(argv);
+    } else if (strcmp(cmd, "rm") == 0) {
+        return builtin_rm(argv);
+    } else if (strcmp(cmd, "cat") == 0) {
+        return builtin_cat(argv);
+    } else if (strcmp(cmd, "ls") == 0) {
+        return builtin_ls(argv);
+    } else if (strcmp(cmd, "jobs") == 0) {
+        return builtin_jobs(argv);
+    } else if (strcmp(cmd, "fg") == 0) {
+        return builtin_fg(argv);
+    } else if (strcmp(cmd, "bg") == 0) {
+        return builtin_bg(argv);
+    } else if (strcmp(cmd, "kill") == 0) {
+        return builtin_kill(argv);
+    } else if (strcmp(cmd, "disown") == 0) {
+        return builtin_disown(argv);
+    } else if (strcmp(cmd, "wait") == 0) {
+        return builtin_wait(argv);
+    } else if (strcmp(cmd, "jobqueue") == 0) {
+        return builtin_jobqueue(argv);
+    } else if (strcmp(cmd, "joblog") == 0) {
+        return builtin_joblog(argv);
+    } else if (strcmp(cmd, "syscalls") == 0) {
+        return builtin_syscalls(argv);
+    } else if (strcmp(cmd, "shellmem") == 0) {
+        return builtin_shellmem(argv);
+    } else if (strcmp(cmd, "sched") == 0) {
+        return builtin_sched(argv);
+    } else if (strcmp(cmd, "ulimit") == 0) {
+        return builtin_ulimit(argv);
+    } else if (strcmp(cmd, "history") == 0) {
+        return builtin_history(argv);
+    } else if (strcmp(cmd, "export") == 0) {
+        return builtin_export(argv);
+    } else if (strcmp(cmd, "unset") == 0) {
+        return builtin_unset(argv);
+    } else if (strcmp(cmd, "read") == 0) {
+        return builtin_read(argv);
+    } else if (strcmp(cmd, "test") == 0 || strcmp(cmd, "[") == 0 ||
+               strcmp(cmd, "[[") == 0) {
+        return builtin_test(argv);
+    } else if (strcmp(cmd, "checksum") == 0) {
+        return builtin_checksum(argv);
+    }
+
+    return -1;
+}
+
+// Execute built-in command
+int execute_builtin(char **argv) {
+    if (!argv || !argv[0]) {
+        return -1;
+    }
+
+    trace_begin("builtin", argv[0]);
+    int status = run_builtin(argv);
+    if (out_flush() == -1) {
+        fprintf(stderr, "myshell: %s: write error: %s\n", argv[0], strerror(errno));
+        status = 1;
+    }
+    trace_end("builtin");
+    return status;
+}
+
@@ -0,0 +1,361 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "capture.h"
+#include "memacct.h"
+#include "eventloop.h"
+#include "utils.h"
+#include <fcntl.h>
+
+struct JobOutput {
+    int read_fd;           // Pipe read end, -1 once EOF was seen
+    char *ring;            // Ring storage (grown on demand up to ring_limit)
+    size_t ring_size;      // Allocated ring bytes
+    size_t ring_limit;     // Maximum bytes kept in memory
+    size_t head;           // Index of the oldest byte in the ring
+    size_t len;            // Bytes currently in the ring
+    int spill_fd;          // Unlinked spill file, -1 until first needed
+    off_t spilled;         // Bytes pushed out of the ring (logical start of ring)
+    int was_read;          // Log has been shown by joblog
+    int detached;          // Job was disowned: discard output, free at EOF
+};
+
+// Write all bytes, handling partial writes
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Ring size limit, overridable with MYSHELL_CAPTURE_RING (bytes)
+static size_t ring_limit_from_env(void) {
+    const char *value = getenv("MYSHELL_CAPTURE_RING");
+    if (value) {
+        long limit = atol(value);
+        if (limit >= 1024) {
+            return (size_t)limit;
+        }
+    }
+    return CAPTURE_RING_SIZE;
+}
+
+// Append bytes that fell out of the ring to the spill file
+static void spill(JobOutput *out, const char *data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+
+    if (out->spill_fd == -1) {
+        const char *tmpdir = getenv("TMPDIR");
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/myshell-joblog-XXXXXX",
+                 tmpdir ? tmpdir : "/tmp");
+        out->spill_fd = mkostemp(path, O_CLOEXEC);
+        if (out->spill_fd == -1) {
+            perror("myshell: capture: spill file");
+            out->spill_fd = -2;  // Don't retry; spilled bytes are lost
+        } else {
+            unlink(path);  // Lives only as long as the descriptor
+        }
+    }
+
+    if (out->spill_fd >= 0 && write_all(out->spill_fd, data, len) == -1) {
+        perror("myshell: capture: spill write");
+    }
+    out->spilled += len;
+}
+
+// Spill the oldest n bytes of the ring
+static void spill_ring(JobOutput *out, size_t n) {
+    size_t first = out->ring_size - out->head;
+    if (first > n) {
+        first = n;
+    }
+    spill(out, out->ring + out->head, first);
+    spill(out, out->ring, n - first);
+    out->head = (out->head + n) % out->ring_size;
+    out->len -= n;
+}
+
+// Grow the ring (up to its limit) so that `need` bytes fit
+static void grow_ring(JobOutput *out, size_t need) {
+    if (need <= out->ring_size || out->ring_size >= out->ring_limit) {
+        return;
+    }
+
+    size_t new_size = out->ring_size ? out->ring_size * 2 : 4096;
+    if (new_size < need) {
+        new_size = need;
+    }
+    if (new_size > out->ring_limit) {
+        new_size = out->ring_limit;
+    }
+
+    char *ring = mem_malloc(MEM_CAPTURE, new_size);
+    if (!ring) {
+        return;  // Keep the smaller ring; more output spills instead
+    }
+
+    // Linearize existing contents
+    for (size_t i = 0; i < out->len; i++) {
+        ring[i] = out->ring[(out->head + i) % out->ring_size];
+    }
+    mem_free(MEM_CAPTURE, out->ring);
+    out->ring = ring;
+    out->ring_size = new_size;
+    out->head = 0;
+}
+
+// Append new output to the ring, spilling what no longer fits
+static void ring_append(JobOutput *out, const char *data, size_t n) {
+    grow_ring(out, out->len + n);
+    if (out->ring_size == 0) {
+        spill(out, data, n);
+        return;
+    }
+
+    if (n >= out->ring_size) {
+        // New data alone fills the ring
+        spill_ring(out, out->len);
+        spill(out, data, n - out->ring_size);
+        memcpy(out->ring, data + n - out->ring_size, out->ring_size);
+        out->head = 0;
+        out->len = out->ring_size;
+        return;
+    }
+
+    if (out->len + n > out->ring_size) {
+        spill_ring(out, out->len + n - out->ring_size);
+    }
+
+    size_t tail = (out->head + out->len) % out->ring_size;
+    size_t first = out->ring_size - tail;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(out->ring + tail, data, first);
+    memcpy(out->ring, data + first, n - first);
+    out->len += n;
+}
+
+// Event loop callback: drain the pipe without blocking
+static void capture_readable(int fd, void *data) {
+    JobOutput *out = data;
+    char buf[16384];
+
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            if (!out->detached) {
+                ring_append(out, buf, (size_t)n);
+            }
+            continue;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;  // Drained for now
+        }
+        // EOF (or error) - every writer in the job is gone
+        event_remove_fd(fd);
+        close(fd);
+        out->read_fd = -1;
+        if (out->detached) {
+            capture_free(out);
+        }
+        return;
+    }
+}
+
+// Start capturing
+JobOutput *capture_start(int *write_fd) {
+    JobOutput *out = mem_calloc(MEM_CAPTURE, 1, sizeof(JobOutput));
+    if (!out) {
+        perror("calloc");
+        return NULL;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        perror("myshell: pipe2");
+        mem_free(MEM_CAPTURE, out);
+        return NULL;
+    }
+    // Only the shell's end is non-blocking; the job sees a normal pipe
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    out->read_fd = fds[0];
+    out->ring_limit = ring_limit_from_env();
+    out->spill_fd = -1;
+
+    if (event_add_fd(fds[0], capture_readable, out) == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        mem_free(MEM_CAPTURE, out);
+        return NULL;
+    }
+
+    *write_fd = fds[1];
+    return out;
+}
+
+// Free a capture
+void capture_free(JobOutput *out) {
+    if (!out) {
+        return;
+    }
+    if (out->read_fd != -1) {
+        event_remove_fd(out->read_fd);
+        close(out->read_fd);
+    }
+    if (out->spill_fd >= 0) {
+        close(out->spill_fd);
+    }
+    mem_free(MEM_CAPTURE, out->ring);
+    mem_free(MEM_CAPTURE, out);
+}
+
+// Let go of a disowned job's capture
+void capture_detach(JobOutput *out) {
+    if (!out) {
+        return;
+    }
+    if (out->read_fd == -1) {
+        capture_free(out);  // Already at EOF - nothing left to drain
+        return;
+    }
+    if (out->spill_fd >= 0) {
+        close(out->spill_fd);
+        out->spill_fd = -1;
+    }
+    mem_free(MEM_CAPTURE, out->ring);
+    out->ring = NULL;
+    out->ring_size = 0;
+    out->len = 0;
+    out->detached = 1;
+}
+
+// Returns 1 while the job may still produce output
+int capture_is_open(const JobOutput *out) {
+    return out && out->read_fd != -1;
+}
+
+// Total number of bytes captured so far
+off_t capture_size(const JobOutput *out) {
+    return out ? out->spilled + (off_t)out->len : 0;
+}
+
+// Returns 1 once the log has been shown by joblog
+int capture_was_read(const JobOutput *out) {
+    return out && out->was_read;
+}
+
+// Byte at a logical offset inside the ring
+static char ring_byte(const JobOutput *out, off_t offset) {
+    return out->ring[(out->head + (size_t)(offset - out->spilled)) % out->ring_size];
+}
+
+// Logical offset where the last `lines` lines of the log start
+off_t capture_tail_offset(const JobOutput *out, int lines) {
+    off_t size = capture_size(out);
+    if (lines <= 0 || size == 0) {
+        return 0;  // Whole log
+    }
+
+    // A trailing newline terminates the last line rather than starting a new one
+    off_t pos = size;
+    char last;
+    if (pos > out->spilled) {
+        last = ring_byte(out, pos - 1);
+    } else if (out->spill_fd < 0 || pread(out->spill_fd, &last, 1, pos - 1) != 1) {
+        return 0;
+    }
+    if (last == '\n') {
+        pos--;
+    }
+
+    int count = 0;
+
+    // Scan the ring backwards
+    while (pos > out->spilled) {
+        pos--;
+        if (ring_byte(out, pos) == '\n' && ++count == lines) {
+            return pos + 1;
+        }
+    }
+
+    // Then the spill file, a chunk at a time
+    char buf[4096];
+    while (pos > 0 && out->spill_fd >= 0) {
+        off_t chunk = pos < (off_t)sizeof(buf) ? pos : (off_t)sizeof(buf);
+        if (pread(out->spill_fd, buf, chunk, pos - chunk) != chunk) {
+            break;
+        }
+        for (off_t i = chunk - 1; i >= 0; i--) {
+            if (buf[i] == '\n' && ++count == lines) {
+                return pos - chunk + i + 1;
+            }
+        }
+        pos -= chunk;
+    }
+
+    return 0;
+}
+
+// Write the log from logical offset `start` to the end into fd
+off_t capture_write(JobOutput *out, int fd, off_t start) {
+    if (!out) {
+        return -1;
+    }
+    out->was_read = 1;
+
+    // Spilled part
+    char buf[16384];
+    while (start < out->spilled) {
+        if (out->spill_fd < 0) {
+            start = out->spilled;  // Lost - skip to what is still in memory
+            break;
+        }
+        off_t want = out->spilled - start;
+        if (want > (off_t)sizeof(buf)) {
+            want = sizeof(buf);
+        }
+        ssize_t n = pread(out->spill_fd, buf, want, start);
+        if (n <= 0) {
+            return -1;
+        }
+        if (write_all(fd, buf, n) == -1) {
+            return -1;
+        }
+        start += n;
+    }
+
+    // In-memory part (at most two contiguous segments)
+    size_t skip = (size_t)(start - out->spilled);
+    if (skip < out->len) {
+        size_t begin = (out->head + skip) % out->ring_size;
+        size_t remaining = out->len - skip;
+        size_t first = out->ring_size - begin;
+        if (first > remaining) {
+            first = remaining;
+        }
+        if (write_all(fd, out->ring + begin, first) == -1 ||
+            write_all(fd, out->ring, remaining - first) == -1) {
+            return -1;
+        }
+        start += remaining;
+    }
+
+    return start;
+}
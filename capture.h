@@ -0,0 +1,43 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <sys/types.h>
+
+// Default in-memory ring size per job; older output spills to a file
+#define CAPTURE_RING_SIZE (64 * 1024)
+
+// Captured output of a background job
+// The most recent bytes live in a bounded ring buffer; anything that
+// falls out of the ring is appended to an unlinked spill file
+typedef struct JobOutput JobOutput;
+
+// Start capturing: creates a pipe whose read end is drained by the event loop
+// *write_fd receives the end to hand to the job (close-on-exec in the shell)
+// Returns the capture, or NULL on error
+JobOutput *capture_start(int *write_fd);
+
+// Free a capture (closes its pipe and spill file)
+void capture_free(JobOutput *out);
+
+// Let go of a capture whose job was disowned: the log is dropped, but the
+// event loop keeps draining the pipe (so the job doesn't get SIGPIPE) and
+// frees the capture at EOF
+void capture_detach(JobOutput *out);
+
+// Returns 1 while the job may still produce output (pipe not at EOF)
+int capture_is_open(const JobOutput *out);
+
+// Total number of bytes captured so far
+off_t capture_size(const JobOutput *out);
+
+// Returns 1 once the log has been shown by joblog
+int capture_was_read(const JobOutput *out);
+
+// Logical offset where the last `lines` lines of the log start (0 = whole log)
+off_t capture_tail_offset(const JobOutput *out, int lines);
+
+// Write the log from logical offset `start` to the end into fd
+// Returns the offset reached, or -1 on error
+off_t capture_write(JobOutput *out, int fd, off_t start);
+
+#endif // CAPTURE_H
@@ -0,0 +1,345 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "cgroup.h"
+#include "outbuf.h"
+#include "utils.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <mntent.h>
+#include <sys/stat.h>
+
+struct JobCgroup {
+    char *path;            // Directory of the job's cgroup
+};
+
+// Shell-wide state, set up on first use
+static char *base_path = NULL;     // Cgroup the shell started in
+static char *root_path = NULL;     // <base>/myshell-<pid>
+static int setup_failed = 0;
+static unsigned long next_cgroup = 1;
+static pid_t root_pid;             // Process that set up the subtree
+
+// Write a string to a cgroup control file
+// Returns 0 on success, -1 on error (errno set)
+static int write_control(const char *dir, const char *file, const char *value) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t n = write(fd, value, strlen(value));
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return n == -1 ? -1 : 0;
+}
+
+// Read a cgroup control file into buf (NUL-terminated)
+// Returns 0 on success, -1 on error
+static int read_control(const char *dir, const char *file, char *buf, size_t size) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+// Find the cgroup v2 directory the shell belongs to
+// Returns a malloc'd path, or NULL if there is no cgroup v2 hierarchy
+static char *find_shell_cgroup(void) {
+    char mount_dir[PATH_MAX] = "";
+    FILE *mounts = setmntent("/proc/self/mounts", "r");
+    if (mounts) {
+        struct mntent *ent;
+        while ((ent = getmntent(mounts)) != NULL) {
+            if (strcmp(ent->mnt_type, "cgroup2") == 0) {
+                snprintf(mount_dir, sizeof(mount_dir), "%s", ent->mnt_dir);
+                break;
+            }
+        }
+        endmntent(mounts);
+    }
+    if (mount_dir[0] == '\0') {
+        return NULL;
+    }
+
+    // The unified hierarchy is the "0::<path>" line
+    FILE *fp = fopen("/proc/self/cgroup", "re");
+    if (!fp) {
+        return NULL;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    char *result = NULL;
+    while (getline(&line, &cap, fp) != -1) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            const char *rel = line + 3;
+            if (strcmp(rel, "/") == 0) {
+                rel = "";
+            }
+            if (asprintf(&result, "%s%s", mount_dir, rel) == -1) {
+                result = NULL;
+            }
+            break;
+        }
+    }
+    free(line);
+    fclose(fp);
+    return result;
+}
+
+// Enable the cpu, memory and pids controllers (where offered) for children
+static void enable_controllers(const char *dir) {
+    char controllers[256];
+    if (read_control(dir, "cgroup.controllers", controllers, sizeof(controllers)) == -1) {
+        return;
+    }
+
+    static const char *wanted[] = { "cpu", "memory", "pids" };
+    for (size_t i = 0; i < sizeof(wanted) / sizeof(wanted[0]); i++) {
+        // Match whole words in the space-separated list
+        size_t len = strlen(wanted[i]);
+        for (char *p = strstr(controllers, wanted[i]); p; p = strstr(p + 1, wanted[i])) {
+            if ((p == controllers || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\n' || p[len] == '\0')) {
+                char value[16];
+                snprintf(value, sizeof(value), "+%s", wanted[i]);
+                write_control(dir, "cgroup.subtree_control", value);  // Best effort
+                break;
+            }
+        }
+    }
+}
+
+// Create <base>/myshell-<pid> and move the shell into its "shell" leaf
+// Processes may only live in leaves once controllers are enabled, so the
+// shell cannot stay in the cgroup that parents its jobs
+// Returns 0 on success, -1 on error
+static int setup_cgroup_root(void) {
+    if (root_path) {
+        return 0;
+    }
+    if (setup_failed) {
+        return -1;
+    }
+    setup_failed = 1;  // Cleared on success
+
+    base_path = find_shell_cgroup();
+    if (!base_path) {
+        fprintf(stderr, "myshell: cgroup: no cgroup v2 hierarchy found\n");
+        return -1;
+    }
+
+    if (asprintf(&root_path, "%s/myshell-%d", base_path, (int)getpid()) == -1) {
+        root_path = NULL;
+        return -1;
+    }
+
+    char shell_path[PATH_MAX];
+    snprintf(shell_path, sizeof(shell_path), "%s/shell", root_path);
+    if ((mkdir(root_path, 0755) == -1 && errno != EEXIST) ||
+        (mkdir(shell_path, 0755) == -1 && errno != EEXIST)) {
+        fprintf(stderr, "myshell: cgroup: %s: %s\n", root_path, strerror(errno));
+        rmdir(root_path);
+        free(root_path);
+        root_path = NULL;
+        return -1;
+    }
+    if (write_control(shell_path, "cgroup.procs", "0") == -1) {
+        fprintf(stderr, "myshell: cgroup: cannot move shell: %s\n", strerror(errno));
+        rmdir(shell_path);
+        rmdir(root_path);
+        free(root_path);
+        root_path = NULL;
+        return -1;
+    }
+
+    // May fail if other processes share the base cgroup - limits then
+    // only work for controllers the base already delegates
+    enable_controllers(base_path);
+    enable_controllers(root_path);
+
+    root_pid = getpid();
+    atexit(cleanup_cgroups);
+    setup_failed = 0;
+    return 0;
+}
+
+// Write one limit file (empty value = no limit)
+// Returns 0 on success, -1 on error (message already printed)
+static int apply_limit(JobCgroup *cg, const char *file, const char *value) {
+    if (value[0] == '\0' || write_control(cg->path, file, value) == 0) {
+        return 0;
+    }
+    fprintf(stderr, "myshell: cgroup: %s: %s\n", file,
+            errno == ENOENT ? "controller not available" : strerror(errno));
+    return -1;
+}
+
+// Create a cgroup for a job and apply its limits
+JobCgroup *cgroup_create(const LaunchOptions *opts) {
+    if (setup_cgroup_root() == -1) {
+        return NULL;
+    }
+
+    JobCgroup *cg = malloc(sizeof(JobCgroup));
+    if (!cg) {
+        perror("malloc");
+        return NULL;
+    }
+    if (asprintf(&cg->path, "%s/job-%lu", root_path, next_cgroup++) == -1) {
+        free(cg);
+        return NULL;
+    }
+    if (mkdir(cg->path, 0755) == -1) {
+        fprintf(stderr, "myshell: cgroup: %s: %s\n", cg->path, strerror(errno));
+        free(cg->path);
+        free(cg);
+        return NULL;
+    }
+
+    // Apply limits - a limit that cannot be set is an error, not ignored
+    if (apply_limit(cg, "memory.max", opts->memory_max) == -1 ||
+        apply_limit(cg, "cpu.max", opts->cpu_max) == -1 ||
+        apply_limit(cg, "pids.max", opts->pids_max) == -1) {
+        cgroup_free(cg);
+        return NULL;
+    }
+
+    return cg;
+}
+
+// Fork a child and move it into the cgroup
+// Always glibc's fork(): the metrics and trace threads may hold malloc or
+// stdio locks, and only fork() resets them for the child (a raw clone3
+// with CLONE_INTO_CGROUP would not)
+pid_t cgroup_fork(JobCgroup *cg) {
+    out_flush();  // The child must not inherit unwritten builtin output
+
+    pid_t pid = fork();
+    if (pid == 0 && cg) {
+        // Join before exec so nothing the job runs escapes accounting
+        // Running outside the cgroup would drop its limits, so a failed
+        // join is fatal like any other limit that cannot be applied
+        if (write_control(cg->path, "cgroup.procs", "0") == -1) {
+            fprintf(stderr, "myshell: cgroup: %s/cgroup.procs: %s\n", cg->path,
+                    strerror(errno));
+            _exit(126);
+        }
+    }
+    return pid;
+}
+
+// Kill every process in the cgroup
+int cgroup_kill(JobCgroup *cg) {
+    if (!cg) {
+        return -1;
+    }
+    return write_control(cg->path, "cgroup.kill", "1");
+}
+
+// Parse "key value" from a flat-keyed file such as cpu.stat
+static int parse_keyed(const char *buf, const char *key, unsigned long long *value) {
+    size_t len = strlen(key);
+    const char *p = buf;
+    while (p) {
+        if (strncmp(p, key, len) == 0 && p[len] == ' ') {
+            *value = strtoull(p + len + 1, NULL, 10);
+            return 0;
+        }
+        p = strchr(p, '\n');
+        if (p) {
+            p++;
+        }
+    }
+    return -1;
+}
+
+// Read CPU and memory accounting
+int cgroup_usage(JobCgroup *cg, CgroupUsage *usage) {
+    if (!cg) {
+        return -1;
+    }
+
+    char buf[1024];
+    usage->cpu_usec = 0;
+    if (read_control(cg->path, "cpu.stat", buf, sizeof(buf)) == -1 ||
+        parse_keyed(buf, "usage_usec", &usage->cpu_usec) == -1) {
+        return -1;
+    }
+
+    // memory.peak needs Linux 5.19; fall back to the current usage
+    usage->has_memory = 0;
+    if (read_control(cg->path, "memory.peak", buf, sizeof(buf)) == 0 ||
+        read_control(cg->path, "memory.current", buf, sizeof(buf)) == 0) {
+        usage->mem_peak = strtoull(buf, NULL, 10);
+        usage->has_memory = 1;
+    }
+    return 0;
+}
+
+// Free a job cgroup
+void cgroup_free(JobCgroup *cg) {
+    if (!cg) {
+        return;
+    }
+    rmdir(cg->path);  // Fails (and is left behind) while strays are alive
+    free(cg->path);
+    free(cg);
+}
+
+// Forget a disowned job's cgroup, leaving the directory
+void cgroup_detach(JobCgroup *cg) {
+    if (!cg) {
+        return;
+    }
+    free(cg->path);
+    free(cg);
+}
+
+// Move the shell back and remove the subtree
+void cleanup_cgroups(void) {
+    if (!root_path || getpid() != root_pid) {
+        return;  // Forked children that exit() must leave the subtree alone
+    }
+
+    write_control(base_path, "cgroup.procs", "0");
+
+    char shell_path[PATH_MAX];
+    snprintf(shell_path, sizeof(shell_path), "%s/shell", root_path);
+    rmdir(shell_path);
+
+    // Cgroups of disowned jobs that have finished by now
+    DIR *dir = opendir(root_path);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "job-", 4) == 0) {
+                char job_path[PATH_MAX];
+                snprintf(job_path, sizeof(job_path), "%s/%s", root_path, entry->d_name);
+                rmdir(job_path);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(root_path);  // Only succeeds once every job cgroup is gone
+
+    free(root_path);
+    root_path = NULL;
+    free(base_path);
+    base_path = NULL;
+}
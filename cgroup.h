@@ -0,0 +1,53 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <sys/types.h>
+#include "launch.h"
+
+// Per-job cgroup v2 directory
+// Jobs get a child of the shell's own cgroup:
+//   <shell cgroup>/myshell-<pid>/shell    - the shell itself (leaf)
+//   <shell cgroup>/myshell-<pid>/job-<n>  - one per job
+// so limits and accounting cover every process the job spawns
+typedef struct JobCgroup JobCgroup;
+
+// Resource usage read from a job's cgroup
+typedef struct {
+    unsigned long long cpu_usec;   // cpu.stat usage_usec (whole tree)
+    unsigned long long mem_peak;   // memory.peak (or memory.current), bytes
+    int has_memory;                // Memory accounting available
+} CgroupUsage;
+
+// Create a cgroup for a job and apply the limits in opts
+// Sets up the shell's cgroup subtree on first use
+// Returns the cgroup, or NULL on error (message already printed)
+JobCgroup *cgroup_create(const LaunchOptions *opts);
+
+// Fork a child that joins the cgroup (a write to cgroup.procs) before
+// it does anything else; a child that cannot join prints the error and
+// exits with status 126
+// cg may be NULL for a plain fork
+// Returns like fork()
+pid_t cgroup_fork(JobCgroup *cg);
+
+// Kill every process in the cgroup, including strays that left the
+// job's process group
+// Returns 0 on success, -1 if cgroup.kill is not supported
+int cgroup_kill(JobCgroup *cg);
+
+// Read CPU and memory accounting
+// Returns 0 on success, -1 on error
+int cgroup_usage(JobCgroup *cg, CgroupUsage *usage);
+
+// Free a job cgroup (removes the directory once it is empty)
+void cgroup_free(JobCgroup *cg);
+
+// Forget a disowned job's cgroup but leave the directory (and its limits)
+// in place; cleanup_cgroups() removes it at exit if it is empty by then
+void cgroup_detach(JobCgroup *cg);
+
+// Move the shell back to its original cgroup and remove the subtree
+// Registered with atexit() when the subtree is created
+void cleanup_cgroups(void);
+
+#endif // CGROUP_H
@@ -0,0 +1,844 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "checksum.h"
+#include "outbuf.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define HAVE_X86_INTRINSICS 1
+#endif
+
+#define MAX_THREADS 64
+#define CHUNK_SIZE (8 << 20)       // Parallel unit for chunkable algorithms
+#define READ_SIZE (64 << 10)       // read() size for small files, pipes and the like
+#define MMAP_MIN (256 << 10)       // Smaller files are read: mmap setup costs more
+#define MAX_DIGEST 32
+
+// ---- CRC-32C ----
+
+#define CRC32C_POLY 0x82F63B78u    // Castagnoli, reflected
+
+static uint32_t crc32c_table[8][256];  // Slicing-by-8
+static int crc32c_hw = 0;
+
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = crc32c_table[t - 1][i];
+            crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+        }
+    }
+}
+
+static uint32_t crc32c_soft(uint32_t crc, const unsigned char *p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        word ^= crc;
+        crc = crc32c_table[7][word & 0xff] ^ crc32c_table[6][(word >> 8) & 0xff] ^
+              crc32c_table[5][(word >> 16) & 0xff] ^ crc32c_table[4][(word >> 24) & 0xff] ^
+              crc32c_table[3][(word >> 32) & 0xff] ^ crc32c_table[2][(word >> 40) & 0xff] ^
+              crc32c_table[1][(word >> 48) & 0xff] ^ crc32c_table[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef HAVE_X86_INTRINSICS
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+        len--;
+    }
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (len-- > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+// Raw (not pre/post-inverted) CRC update
+static uint32_t crc32c_update(uint32_t crc, const unsigned char *p, size_t len) {
+#ifdef HAVE_X86_INTRINSICS
+    if (crc32c_hw) {
+        return crc32c_sse42(crc, p, len);
+    }
+#endif
+    return crc32c_soft(crc, p, len);
+}
+
+// Multiply a vector by a 32x32 matrix over GF(2)
+static uint32_t gf2_times(const uint32_t *matrix, uint32_t vec) {
+    uint32_t sum = 0;
+    for (; vec; vec >>= 1, matrix++) {
+        if (vec & 1) {
+            sum ^= *matrix;
+        }
+    }
+    return sum;
+}
+
+static void gf2_square(uint32_t *square, const uint32_t *matrix) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = gf2_times(matrix, matrix[n]);
+    }
+}
+
+// CRC of A followed by B, from crc(A), crc(B) and the length of B
+// Applies len2 zero bytes to crc1 by repeated squaring (as zlib does)
+static uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+    uint32_t even[32];
+    uint32_t odd[32];
+    if (len2 == 0) {
+        return crc1;
+    }
+
+    odd[0] = CRC32C_POLY;          // Operator for one zero bit
+    for (int n = 1; n < 32; n++) {
+        odd[n] = 1u << (n - 1);
+    }
+    gf2_square(even, odd);         // Two zero bits
+    gf2_square(odd, even);         // Four zero bits
+
+    // First square gives one zero byte, then two, four, ...
+    while (len2 != 0) {
+        gf2_square(even, odd);
+        if (len2 & 1) {
+            crc1 = gf2_times(even, crc1);
+        }
+        len2 >>= 1;
+        if (len2 == 0) {
+            break;
+        }
+        gf2_square(odd, even);
+        if (len2 & 1) {
+            crc1 = gf2_times(odd, crc1);
+        }
+        len2 >>= 1;
+    }
+    return crc1 ^ crc2;
+}
+
+// ---- XXH64 ----
+
+#define XXH_PRIME1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3 0x165667B19E3779F9ULL
+#define XXH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5 0x27D4EB2F165667C5ULL
+
+typedef struct {
+    uint64_t v[4];
+    uint64_t total;
+    unsigned char buf[32];
+    size_t buf_len;
+} Xxh64State;
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;  // XXH64 is defined on little-endian words, as on x86
+}
+
+static uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME1;
+}
+
+static uint64_t xxh64_merge(uint64_t acc, uint64_t v) {
+    acc ^= xxh64_round(0, v);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+static void xxh64_init(Xxh64State *s) {
+    memset(s, 0, sizeof(*s));
+    s->v[0] = XXH_PRIME1 + XXH_PRIME2;
+    s->v[1] = XXH_PRIME2;
+    s->v[2] = 0;
+    s->v[3] = 0 - XXH_PRIME1;
+}
+
+// Consume whole 32-byte stripes
+static const unsigned char *xxh64_stripes(Xxh64State *s, const unsigned char *p, size_t len) {
+    uint64_t v0 = s->v[0], v1 = s->v[1], v2 = s->v[2], v3 = s->v[3];
+    for (; len >= 32; p += 32, len -= 32) {
+        v0 = xxh64_round(v0, read64(p));
+        v1 = xxh64_round(v1, read64(p + 8));
+        v2 = xxh64_round(v2, read64(p + 16));
+        v3 = xxh64_round(v3, read64(p + 24));
+    }
+    s->v[0] = v0;
+    s->v[1] = v1;
+    s->v[2] = v2;
+    s->v[3] = v3;
+    return p;
+}
+
+static void xxh64_update(Xxh64State *s, const unsigned char *p, size_t len) {
+    s->total += len;
+    if (s->buf_len > 0) {
+        size_t take = 32 - s->buf_len < len ? 32 - s->buf_len : len;
+        memcpy(s->buf + s->buf_len, p, take);
+        s->buf_len += take;
+        p += take;
+        len -= take;
+        if (s->buf_len < 32) {
+            return;
+        }
+        xxh64_stripes(s, s->buf, 32);
+        s->buf_len = 0;
+    }
+    const unsigned char *rest = xxh64_stripes(s, p, len);
+    s->buf_len = len - (size_t)(rest - p);
+    memcpy(s->buf, rest, s->buf_len);
+}
+
+static uint64_t xxh64_final(const Xxh64State *s) {
+    uint64_t h;
+    if (s->total >= 32) {
+        h = rotl64(s->v[0], 1) + rotl64(s->v[1], 7) + rotl64(s->v[2], 12) + rotl64(s->v[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = xxh64_merge(h, s->v[i]);
+        }
+    } else {
+        h = s->v[2] + XXH_PRIME5;  // v[2] holds the seed
+    }
+    h += s->total;
+
+    const unsigned char *p = s->buf;
+    size_t len = s->buf_len;
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)read32(p) * XXH_PRIME1;
+        h = rotl64(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; p++, len--) {
+        h ^= *p * XXH_PRIME5;
+        h = rotl64(h, 11) * XXH_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ---- SHA-256 ----
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t total;
+    unsigned char buf[64];
+    size_t buf_len;
+} Sha256State;
+
+static int sha256_hw = 0;
+
+static uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+static void sha256_blocks_soft(uint32_t *state, const unsigned char *p, size_t blocks) {
+    for (; blocks > 0; blocks--, p += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+                   (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) +
+                          ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) +
+                          ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef HAVE_X86_INTRINSICS
+// SHA extensions: each sha256rnds2 does two rounds on the state kept as
+// ABEF / CDGH; the message schedule is four registers of four words
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani(uint32_t *state, const unsigned char *p, size_t blocks) {
+    const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);         // CDGH
+
+    for (; blocks > 0; blocks--, p += 64) {
+        __m128i abef_save = state0;
+        __m128i cdgh_save = state1;
+        __m128i msg[4];
+
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; g++) {
+            if (g < 4) {
+                msg[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16 * g)),
+                                          byteswap);
+            }
+            __m128i m = _mm_add_epi32(msg[g % 4],
+                                      _mm_loadu_si128((const __m128i *)&sha256_k[4 * g]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+            if (g >= 3 && g <= 14) {
+                // Finish the schedule words for group g + 1
+                __m128i next = _mm_add_epi32(msg[(g + 1) % 4],
+                                             _mm_alignr_epi8(msg[g % 4], msg[(g + 3) % 4], 4));
+                msg[(g + 1) % 4] = _mm_sha256msg2_epu32(next, msg[g % 4]);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(m, 0x0E));
+            if (g >= 1 && g <= 12) {
+                msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], msg[g % 4]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);               // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);            // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);         // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);            // HGFE
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#endif
+
+static void sha256_blocks(uint32_t *state, const unsigned char *p, size_t blocks) {
+#ifdef HAVE_X86_INTRINSICS
+    if (sha256_hw) {
+        sha256_blocks_shani(state, p, blocks);
+        return;
+    }
+#endif
+    sha256_blocks_soft(state, p, blocks);
+}
+
+static void sha256_init(Sha256State *s) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(s->h, initial, sizeof(initial));
+    s->total = 0;
+    s->buf_len = 0;
+}
+
+static void sha256_update(Sha256State *s, const unsigned char *p, size_t len) {
+    s->total += len;
+    if (s->buf_len > 0) {
+        size_t take = 64 - s->buf_len < len ? 64 - s->buf_len : len;
+        memcpy(s->buf + s->buf_len, p, take);
+        s->buf_len += take;
+        p += take;
+        len -= take;
+        if (s->buf_len < 64) {
+            return;
+        }
+        sha256_blocks(s->h, s->buf, 1);
+        s->buf_len = 0;
+    }
+    sha256_blocks(s->h, p, len / 64);
+    s->buf_len = len % 64;
+    memcpy(s->buf, p + len - s->buf_len, s->buf_len);
+}
+
+static void sha256_final(Sha256State *s, unsigned char *digest) {
+    uint64_t bits = s->total * 8;
+    unsigned char pad[72] = { 0x80 };
+    size_t pad_len = (s->buf_len < 56 ? 56 : 120) - s->buf_len;
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha256_update(s, pad, pad_len + 8);
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (unsigned char)(s->h[i] >> 24);
+        digest[4 * i + 1] = (unsigned char)(s->h[i] >> 16);
+        digest[4 * i + 2] = (unsigned char)(s->h[i] >> 8);
+        digest[4 * i + 3] = (unsigned char)s->h[i];
+    }
+}
+
+// ---- Algorithm table ----
+
+typedef union {
+    uint32_t crc;
+    Xxh64State xxh;
+    Sha256State sha;
+} HashState;
+
+typedef struct {
+    const char *name;
+    size_t digest_len;
+    int chunkable;                 // Chunk digests can be combined
+    void (*init)(HashState *);
+    void (*update)(HashState *, const unsigned char *, size_t);
+    void (*final)(HashState *, unsigned char *);
+} Algorithm;
+
+static void crc_init(HashState *s) {
+    s->crc = 0xFFFFFFFFu;
+}
+
+static void crc_update(HashState *s, const unsigned char *p, size_t len) {
+    s->crc = crc32c_update(s->crc, p, len);
+}
+
+static void crc_final(HashState *s, unsigned char *digest) {
+    uint32_t crc = ~s->crc;
+    for (int i = 0; i < 4; i++) {
+        digest[i] = (unsigned char)(crc >> (24 - 8 * i));
+    }
+}
+
+static void xxh_init(HashState *s) {
+    xxh64_init(&s->xxh);
+}
+
+static void xxh_update(HashState *s, const unsigned char *p, size_t len) {
+    xxh64_update(&s->xxh, p, len);
+}
+
+static void xxh_final(HashState *s, unsigned char *digest) {
+    uint64_t h = xxh64_final(&s->xxh);
+    for (int i = 0; i < 8; i++) {
+        digest[i] = (unsigned char)(h >> (56 - 8 * i));
+    }
+}
+
+static void sha_init(HashState *s) {
+    sha256_init(&s->sha);
+}
+
+static void sha_update(HashState *s, const unsigned char *p, size_t len) {
+    sha256_update(&s->sha, p, len);
+}
+
+static void sha_final(HashState *s, unsigned char *digest) {
+    sha256_final(&s->sha, digest);
+}
+
+static const Algorithm algorithms[] = {
+    { "sha256", 32, 0, sha_init, sha_update, sha_final },
+    { "crc32c", 4,  1, crc_init, crc_update, crc_final },
+    { "xxh64",  8,  0, xxh_init, xxh_update, xxh_final },
+};
+#define NUM_ALGORITHMS (sizeof(algorithms) / sizeof(algorithms[0]))
+
+// Pick the hardware paths once
+static void detect_cpu(void) {
+    crc32c_init_table();
+#ifdef HAVE_X86_INTRINSICS
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        crc32c_hw = (ecx & bit_SSE4_2) != 0;
+        int sse41 = (ecx & bit_SSE4_1) != 0;
+        int ssse3 = (ecx & bit_SSSE3) != 0;
+        if (sse41 && ssse3 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            sha256_hw = (ebx & bit_SHA) != 0;
+        }
+    }
+#endif
+}
+
+// ---- Work distribution ----
+
+typedef struct {
+    const char *path;              // "-" for stdin
+    off_t size;
+    int regular;
+    int num_chunks;
+    int chunks_left;               // Guarded by the pool lock
+    int error;                     // errno of the first failure
+    unsigned char (*chunk_digest)[MAX_DIGEST];
+} FileJob;
+
+typedef struct {
+    FileJob *file;
+    int chunk;
+} Task;
+
+typedef struct {
+    const Algorithm *alg;
+    Task *tasks;
+    int num_tasks;
+    atomic_int next_task;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+} Pool;
+
+// Hash len bytes of fd from offset through a private mapping
+static int hash_mapped(const Algorithm *alg, int fd, off_t offset, size_t len,
+                       unsigned char *digest) {
+    HashState state;
+    alg->init(&state);
+    if (len > 0) {
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, offset);
+        if (map == MAP_FAILED) {
+            return -1;
+        }
+        madvise(map, len, MADV_SEQUENTIAL);
+        alg->update(&state, map, len);
+        munmap(map, len);
+    }
+    alg->final(&state, digest);
+    return 0;
+}
+
+// Hash whatever fd yields until end of input
+static int hash_stream(const Algorithm *alg, int fd, unsigned char *digest) {
+    unsigned char buf[READ_SIZE];
+    HashState state;
+    alg->init(&state);
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        alg->update(&state, buf, n);
+    }
+    alg->final(&state, digest);
+    return 0;
+}
+
+// Hash one chunk (or the whole of a file)
+// Returns 0 or an errno value
+static int run_task(const Algorithm *alg, const Task *task) {
+    FileJob *file = task->file;
+    unsigned char *digest = file->chunk_digest[task->chunk];
+    int result;
+
+    if (strcmp(file->path, "-") == 0) {
+        result = hash_stream(alg, STDIN_FILENO, digest);
+        return result == -1 ? errno : 0;
+    }
+
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return errno;
+    }
+    if (file->regular && file->size >= MMAP_MIN) {
+        off_t offset = (off_t)task->chunk * CHUNK_SIZE;
+        off_t len = file->size - offset;
+        if (file->num_chunks > 1 && len > CHUNK_SIZE) {
+            len = CHUNK_SIZE;
+        }
+        result = hash_mapped(alg, fd, offset, (size_t)len, digest);
+        if (result == -1 && file->num_chunks == 1 && (errno == ENODEV || errno == EINVAL)) {
+            result = hash_stream(alg, fd, digest);  // Not mappable: read it instead
+        }
+    } else {
+        result = hash_stream(alg, fd, digest);  // Small files, pipes, devices, /proc
+    }
+    int error = result == -1 ? errno : 0;
+    close(fd);
+    return error;
+}
+
+// Claim and run the next task
+// Returns 0 if none were left
+static int run_next_task(Pool *pool) {
+    int index = atomic_fetch_add(&pool->next_task, 1);
+    if (index >= pool->num_tasks) {
+        return 0;
+    }
+    const Task *task = &pool->tasks[index];
+    int error = run_task(pool->alg, task);
+
+    pthread_mutex_lock(&pool->lock);
+    if (error && !task->file->error) {
+        task->file->error = error;
+    }
+    task->file->chunks_left--;
+    pthread_cond_broadcast(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+static void *worker(void *arg) {
+    Pool *pool = arg;
+    while (run_next_task(pool)) {
+    }
+    return NULL;
+}
+
+// Print one file's line, combining chunk CRCs first
+static int print_result(const Algorithm *alg, const FileJob *file) {
+    if (file->error) {
+        fprintf(stderr, "myshell: checksum: %s: %s\n", file->path, strerror(file->error));
+        return 1;
+    }
+
+    unsigned char digest[MAX_DIGEST];
+    memcpy(digest, file->chunk_digest[0], alg->digest_len);
+    if (file->num_chunks > 1) {
+        uint32_t crc = (uint32_t)digest[0] << 24 | digest[1] << 16 | digest[2] << 8 | digest[3];
+        for (int i = 1; i < file->num_chunks; i++) {
+            const unsigned char *d = file->chunk_digest[i];
+            uint32_t next = (uint32_t)d[0] << 24 | d[1] << 16 | d[2] << 8 | d[3];
+            off_t len = i == file->num_chunks - 1 ? file->size - (off_t)i * CHUNK_SIZE
+                                                   : CHUNK_SIZE;
+            crc = crc32c_combine(crc, next, (uint64_t)len);
+        }
+        for (int i = 0; i < 4; i++) {
+            digest[i] = (unsigned char)(crc >> (24 - 8 * i));
+        }
+    }
+
+    char hex[2 * MAX_DIGEST + 1];
+    for (size_t i = 0; i < alg->digest_len; i++) {
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    }
+    out_printf("%s  %s\n", hex, file->path);
+    return 0;
+}
+
+// Look up each file and split it into tasks
+// Returns the number of tasks, or -1 if out of memory
+static int plan_tasks(const Algorithm *alg, char **files, int num_files, FileJob *jobs,
+                      Task **tasks_out) {
+    int num_tasks = 0;
+    for (int f = 0; f < num_files; f++) {
+        FileJob *job = &jobs[f];
+        job->path = files[f];
+        job->num_chunks = 1;
+        struct stat st;
+        if (strcmp(files[f], "-") != 0) {
+            if (stat(files[f], &st) == -1) {
+                job->error = errno;
+            } else if (S_ISDIR(st.st_mode)) {
+                job->error = EISDIR;
+            } else if (S_ISREG(st.st_mode)) {
+                job->regular = 1;
+                job->size = st.st_size;
+                if (alg->chunkable && st.st_size > CHUNK_SIZE) {
+                    job->num_chunks = (int)((st.st_size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+                }
+            }
+        }
+        if (!job->error) {
+            job->chunks_left = job->num_chunks;
+            num_tasks += job->num_chunks;
+        }
+    }
+
+    Task *tasks = malloc((num_tasks > 0 ? num_tasks : 1) * sizeof(Task));
+    if (!tasks) {
+        return -1;
+    }
+    int t = 0;
+    for (int f = 0; f < num_files; f++) {
+        if (jobs[f].error) {
+            continue;
+        }
+        jobs[f].chunk_digest = malloc(jobs[f].num_chunks * sizeof(*jobs[f].chunk_digest));
+        if (!jobs[f].chunk_digest) {
+            free(tasks);
+            return -1;
+        }
+        for (int c = 0; c < jobs[f].num_chunks; c++) {
+            tasks[t].file = &jobs[f];
+            tasks[t].chunk = c;
+            t++;
+        }
+    }
+    *tasks_out = tasks;
+    return num_tasks;
+}
+
+// Start up to count workers with every signal blocked (the shell's
+// handlers stay on the main thread)
+// Returns the number started
+static int start_workers(Pool *pool, pthread_t *threads, int count) {
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int started = 0;
+    while (started < count && pthread_create(&threads[started], NULL, worker, pool) == 0) {
+        started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return started;
+}
+
+// Hash and print files (see checksum.h)
+int checksum_files(const char *algorithm, int threads, char **files) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, detect_cpu);
+
+    const Algorithm *alg = NULL;
+    for (size_t i = 0; i < NUM_ALGORITHMS; i++) {
+        if (strcmp(algorithms[i].name, algorithm) == 0) {
+            alg = &algorithms[i];
+        }
+    }
+    if (!alg) {
+        fprintf(stderr, "myshell: checksum: %s: unknown algorithm (sha256, crc32c, xxh64)\n",
+                algorithm);
+        return 2;
+    }
+
+    static char *stdin_only[] = { "-", NULL };
+    if (files[0] == NULL) {
+        files = stdin_only;
+    }
+    int num_files = 0;
+    while (files[num_files] != NULL) {
+        num_files++;
+    }
+
+    FileJob *jobs = calloc(num_files, sizeof(FileJob));
+    Task *tasks = NULL;
+    int num_tasks = jobs ? plan_tasks(alg, files, num_files, jobs, &tasks) : -1;
+    if (num_tasks == -1) {
+        perror("myshell: checksum");
+        for (int f = 0; jobs && f < num_files; f++) {
+            free(jobs[f].chunk_digest);
+        }
+        free(jobs);
+        return 1;
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    threads = threads < num_tasks ? threads : num_tasks;
+    threads = threads < MAX_THREADS ? threads : MAX_THREADS;
+
+    Pool pool = { .alg = alg, .tasks = tasks, .num_tasks = num_tasks };
+    atomic_init(&pool.next_task, 0);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.done, NULL);
+
+    // The calling thread is one of the workers; it prints each file once
+    // it and all before it are done, and otherwise helps with the hashing
+    pthread_t workers[MAX_THREADS];
+    int num_workers = threads > 1 ? start_workers(&pool, workers, threads - 1) : 0;
+
+    int status = 0;
+    for (int f = 0; f < num_files; f++) {
+        for (;;) {
+            pthread_mutex_lock(&pool.lock);
+            int left = jobs[f].chunks_left;
+            pthread_mutex_unlock(&pool.lock);
+            if (left == 0 || !run_next_task(&pool)) {
+                break;
+            }
+        }
+        out_flush();  // Show finished lines while waiting for the rest
+        pthread_mutex_lock(&pool.lock);
+        while (jobs[f].chunks_left > 0) {
+            pthread_cond_wait(&pool.done, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+        status |= print_result(alg, &jobs[f]);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_cond_destroy(&pool.done);
+    pthread_mutex_destroy(&pool.lock);
+    for (int f = 0; f < num_files; f++) {
+        free(jobs[f].chunk_digest);
+    }
+    free(jobs);
+    free(tasks);
+    return status;
+}
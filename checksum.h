@@ -0,0 +1,22 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+// File checksums for the checksum builtin
+// Files are hashed concurrently on a small thread pool (the calling thread
+// takes part) and printed as "DIGEST  FILE" in argument order, each line
+// as soon as it and every file before it are done. Regular files are
+// mmap'd; anything else (pipes, "-" for stdin) is read in blocks.
+//
+// Algorithms:
+//   sha256  FIPS 180-4, using the SHA extensions when the CPU has them
+//   crc32c  CRC-32C (Castagnoli), using the SSE4.2 crc32 instruction when
+//           available; large files are hashed in chunks in parallel and the
+//           chunk CRCs combined, giving the same value as a single pass
+//   xxh64   XXH64 with seed 0 (same digest as xxhsum -H64)
+
+// Hash and print files (NULL-terminated; none means stdin)
+// threads: worker count, 0 for one per online CPU
+// Returns 0 on success, 1 if a file could not be read, 2 for an unknown algorithm
+int checksum_files(const char *algorithm, int threads, char **files);
+
+#endif // CHECKSUM_H
@@ -0,0 +1,381 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "cond.h"
+#include "utils.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include <sys/stat.h>
+
+#define STAT_CACHE 8       // Distinct paths whose statx() results are kept
+
+// statx() result for one path, kept for the rest of the expression
+typedef struct {
+    const char *path;      // Points into argv
+    int follow;            // 0 for -L/-h, which look at the link itself
+    int result;            // 0 or -errno
+    struct statx stx;
+} StatEntry;
+
+// State of one expression being evaluated
+typedef struct {
+    char **args;
+    int pos;               // Next argument
+    int end;               // One past the last argument (before ] or ]])
+    int extended;          // [[ ]] syntax
+    const char *name;      // Builtin name for messages
+    int error;             // Set on the first syntax error
+    StatEntry cache[STAT_CACHE];
+    int cached;            // Entries filled so far
+} Cond;
+
+// Unary operators that take a path, and the string/fd ones
+static const char *const file_ops[] = {
+    "-e", "-a", "-f", "-d", "-s", "-L", "-h", "-p", "-S", "-b", "-c",
+    "-u", "-g", "-k", "-O", "-G", "-r", "-w", "-x", NULL,
+};
+
+static const char *const binary_ops[] = {
+    "=", "==", "!=", "<", ">", "=~", "-eq", "-ne", "-lt", "-le", "-gt", "-ge",
+    "-nt", "-ot", "-ef", NULL,
+};
+
+static int in_list(const char *const *list, const char *word) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(list[i], word) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int is_unary(const Cond *c, const char *word) {
+    // In test and [, -a is "and" between expressions, never a predicate
+    if (!c->extended && strcmp(word, "-a") == 0) {
+        return 0;
+    }
+    return in_list(file_ops, word) || strcmp(word, "-z") == 0 || strcmp(word, "-n") == 0 ||
+           strcmp(word, "-t") == 0;
+}
+
+static int is_binary(const Cond *c, const char *word) {
+    // < and > would be redirections outside [[ ]]; =~ is [[-only
+    if (!c->extended && strcmp(word, "=~") == 0) {
+        return 0;
+    }
+    return in_list(binary_ops, word);
+}
+
+static void syntax_error(Cond *c, const char *fmt, const char *arg) {
+    if (!c->error) {
+        fprintf(stderr, "myshell: %s: ", c->name);
+        fprintf(stderr, fmt, arg);
+        fprintf(stderr, "\n");
+        c->error = 1;
+    }
+}
+
+// statx() path once per expression; later predicates reuse the result
+static const StatEntry *stat_path(Cond *c, const char *path, int follow) {
+    int filled = c->cached < STAT_CACHE ? c->cached : STAT_CACHE;
+    for (int i = 0; i < filled; i++) {
+        StatEntry *e = &c->cache[i];
+        if (e->follow == follow && strcmp(e->path, path) == 0) {
+            return e;
+        }
+    }
+
+    StatEntry *e = &c->cache[c->cached++ % STAT_CACHE];
+    e->path = path;
+    e->follow = follow;
+    e->result = statx(AT_FDCWD, path, follow ? 0 : AT_SYMLINK_NOFOLLOW,
+                      STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_UID | STATX_GID |
+                      STATX_MTIME | STATX_INO, &e->stx) == -1 ? -errno : 0;
+    return e;
+}
+
+// Parse an integer operand; flags a syntax error if it is not one
+static long long integer(Cond *c, const char *arg) {
+    char *end;
+    errno = 0;
+    long long value = strtoll(arg, &end, 10);
+    while (isspace((unsigned char)*end)) {
+        end++;
+    }
+    if (end == arg || *end != '\0' || errno == ERANGE) {
+        syntax_error(c, "%s: integer expression expected", arg);
+        return 0;
+    }
+    return value;
+}
+
+static int file_test(Cond *c, const char *op, const char *path) {
+    switch (op[1]) {
+        case 'r':
+            return faccessat(AT_FDCWD, path, R_OK, AT_EACCESS) == 0;
+        case 'w':
+            return faccessat(AT_FDCWD, path, W_OK, AT_EACCESS) == 0;
+        case 'x':
+            return faccessat(AT_FDCWD, path, X_OK, AT_EACCESS) == 0;
+    }
+
+    int link_test = op[1] == 'L' || op[1] == 'h';
+    const StatEntry *e = stat_path(c, path, !link_test);
+    if (e->result != 0) {
+        return 0;
+    }
+    mode_t mode = e->stx.stx_mode;
+    switch (op[1]) {
+        case 'e':
+        case 'a':
+            return 1;
+        case 'f':
+            return S_ISREG(mode);
+        case 'd':
+            return S_ISDIR(mode);
+        case 's':
+            return e->stx.stx_size > 0;
+        case 'L':
+        case 'h':
+            return S_ISLNK(mode);
+        case 'p':
+            return S_ISFIFO(mode);
+        case 'S':
+            return S_ISSOCK(mode);
+        case 'b':
+            return S_ISBLK(mode);
+        case 'c':
+            return S_ISCHR(mode);
+        case 'u':
+            return (mode & S_ISUID) != 0;
+        case 'g':
+            return (mode & S_ISGID) != 0;
+        case 'k':
+            return (mode & S_ISVTX) != 0;
+        case 'O':
+            return e->stx.stx_uid == geteuid();
+        case 'G':
+            return e->stx.stx_gid == getegid();
+    }
+    return 0;
+}
+
+static int unary_test(Cond *c, const char *op, const char *arg) {
+    if (strcmp(op, "-z") == 0) {
+        return arg[0] == '\0';
+    }
+    if (strcmp(op, "-n") == 0) {
+        return arg[0] != '\0';
+    }
+    if (strcmp(op, "-t") == 0) {
+        return isatty((int)integer(c, arg));
+    }
+    return file_test(c, op, arg);
+}
+
+// Compare modification times: 1 if a is newer than b
+// A file that exists is newer than one that does not
+static int newer(Cond *c, const char *a, const char *b) {
+    // Copies: the second lookup may reuse the first one's cache slot
+    StatEntry ea = *stat_path(c, a, 1);
+    StatEntry eb = *stat_path(c, b, 1);
+    if (ea.result != 0) {
+        return 0;
+    }
+    if (eb.result != 0) {
+        return 1;
+    }
+    const struct statx_timestamp *ta = &ea.stx.stx_mtime, *tb = &eb.stx.stx_mtime;
+    return ta->tv_sec > tb->tv_sec || (ta->tv_sec == tb->tv_sec && ta->tv_nsec > tb->tv_nsec);
+}
+
+static int regex_match(Cond *c, const char *str, const char *pattern) {
+    regex_t re;
+    int err = regcomp(&re, pattern, REG_EXTENDED | REG_NOSUB);
+    if (err != 0) {
+        char msg[256];
+        regerror(err, &re, msg, sizeof(msg));
+        syntax_error(c, "=~: %s", msg);
+        return 0;
+    }
+    int matched = regexec(&re, str, 0, NULL, 0) == 0;
+    regfree(&re);
+    return matched;
+}
+
+static int binary_test(Cond *c, const char *left, const char *op, const char *right) {
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) {
+        return c->extended ? fnmatch(right, left, 0) == 0 : strcmp(left, right) == 0;
+    }
+    if (strcmp(op, "!=") == 0) {
+        return c->extended ? fnmatch(right, left, 0) != 0 : strcmp(left, right) != 0;
+    }
+    if (strcmp(op, "<") == 0) {
+        return strcmp(left, right) < 0;
+    }
+    if (strcmp(op, ">") == 0) {
+        return strcmp(left, right) > 0;
+    }
+    if (strcmp(op, "=~") == 0) {
+        return regex_match(c, left, right);
+    }
+    if (strcmp(op, "-nt") == 0) {
+        return newer(c, left, right);
+    }
+    if (strcmp(op, "-ot") == 0) {
+        return newer(c, right, left);
+    }
+    if (strcmp(op, "-ef") == 0) {
+        StatEntry a = *stat_path(c, left, 1);
+        StatEntry b = *stat_path(c, right, 1);
+        return a.result == 0 && b.result == 0 && a.stx.stx_ino == b.stx.stx_ino &&
+               a.stx.stx_dev_major == b.stx.stx_dev_major &&
+               a.stx.stx_dev_minor == b.stx.stx_dev_minor;
+    }
+
+    long long l = integer(c, left);
+    long long r = integer(c, right);
+    switch (op[1] * 256 + op[2]) {
+        case 'e' * 256 + 'q':
+            return l == r;
+        case 'n' * 256 + 'e':
+            return l != r;
+        case 'l' * 256 + 't':
+            return l < r;
+        case 'l' * 256 + 'e':
+            return l <= r;
+        case 'g' * 256 + 't':
+            return l > r;
+        case 'g' * 256 + 'e':
+            return l >= r;
+    }
+    return 0;
+}
+
+// Recursive descent over the arguments:
+//   or      := and { (-o | ||) and }
+//   and     := not { (-a | &&) not }
+//   not     := ! not | primary
+//   primary := ( or ) | unary-op word | word binary-op word | word
+// With eval == 0 the expression is only parsed (short-circuited side),
+// so no statx() or access() calls are made for it.
+static int parse_or(Cond *c, int eval);
+
+static int parse_primary(Cond *c, int eval) {
+    if (c->pos >= c->end) {
+        syntax_error(c, "%s", "argument expected");
+        return 0;
+    }
+    char **a = c->args;
+    int p = c->pos;
+
+    // A binary operator in second place wins, so "[ -f = -f ]" compares strings
+    if (p + 2 < c->end && is_binary(c, a[p + 1])) {
+        c->pos += 3;
+        return eval ? binary_test(c, a[p], a[p + 1], a[p + 2]) : 0;
+    }
+    if (strcmp(a[p], "(") == 0 && p + 1 < c->end) {
+        c->pos++;
+        int value = parse_or(c, eval);
+        if (c->pos >= c->end || strcmp(a[c->pos], ")") != 0) {
+            syntax_error(c, "%s", "missing ')'");
+            return 0;
+        }
+        c->pos++;
+        return value;
+    }
+    if (is_unary(c, a[p]) && p + 1 < c->end) {
+        c->pos += 2;
+        return eval ? unary_test(c, a[p], a[p + 1]) : 0;
+    }
+
+    // A lone word is true if it is not empty
+    c->pos++;
+    return a[p][0] != '\0';
+}
+
+static int parse_not(Cond *c, int eval) {
+    int p = c->pos;
+    // "!" alone is a non-empty string, and "! = x" compares it
+    if (p + 1 < c->end && strcmp(c->args[p], "!") == 0 &&
+        !(p + 2 < c->end && is_binary(c, c->args[p + 1]))) {
+        c->pos++;
+        return !parse_not(c, eval);
+    }
+    return parse_primary(c, eval);
+}
+
+static int is_and(const Cond *c, const char *word) {
+    return strcmp(word, c->extended ? "&&" : "-a") == 0;
+}
+
+static int is_or(const Cond *c, const char *word) {
+    return strcmp(word, c->extended ? "||" : "-o") == 0;
+}
+
+static int parse_and(Cond *c, int eval) {
+    int value = parse_not(c, eval);
+    while (!c->error && c->pos < c->end && is_and(c, c->args[c->pos])) {
+        c->pos++;
+        int right = parse_not(c, eval && value);
+        value = value && right;
+    }
+    return value;
+}
+
+static int parse_or(Cond *c, int eval) {
+    int value = parse_and(c, eval);
+    while (!c->error && c->pos < c->end && is_or(c, c->args[c->pos])) {
+        c->pos++;
+        int right = parse_and(c, eval && !value);
+        value = value || right;
+    }
+    return value;
+}
+
+// Evaluate a test, [ or [[ command line
+int eval_condition(char **argv) {
+    Cond c;
+    memset(&c, 0, sizeof(c));
+    c.name = argv[0];
+    c.args = argv + 1;
+
+    int argc = 0;
+    while (argv[argc]) {
+        argc++;
+    }
+    c.end = argc - 1;
+
+    // [ and [[ must be closed
+    const char *close = NULL;
+    if (strcmp(argv[0], "[") == 0) {
+        close = "]";
+    } else if (strcmp(argv[0], "[[") == 0) {
+        close = "]]";
+        c.extended = 1;
+    }
+    if (close) {
+        if (c.end < 1 || strcmp(argv[argc - 1], close) != 0) {
+            fprintf(stderr, "myshell: %s: missing '%s'\n", argv[0], close);
+            return 2;
+        }
+        c.end--;
+    }
+
+    // No expression is false
+    if (c.end == 0) {
+        return 1;
+    }
+
+    int value = parse_or(&c, 1);
+    if (!c.error && c.pos < c.end) {
+        syntax_error(&c, "%s: unexpected argument", c.args[c.pos]);
+    }
+    if (c.error) {
+        return 2;
+    }
+    return value ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+#ifndef COND_H
+#define COND_H
+
+// Conditional expressions for the test, [ and [[ builtins
+// argv[0] selects the syntax:
+//   test EXPR      POSIX test; -a and -o join expressions
+//   [ EXPR ]       the same, with a closing ]
+//   [[ EXPR ]]     && and || join expressions, < and > compare strings,
+//                  == and != match glob patterns, =~ matches an ERE
+// File predicates on the same path share one statx() call per expression.
+// Returns 0 if EXPR is true, 1 if false, 2 on a syntax error
+int eval_condition(char **argv);
+
+#endif // COND_H
@@ -0,0 +1,163 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "eventloop.h"
+#include "utils.h"
+#include <poll.h>
+
+// Registered watcher
+typedef struct {
+    int fd;
+    EventCallback callback;
+    void *data;
+    int removed;           // Removed during dispatch, compacted afterwards
+} Watcher;
+
+static Watcher *watchers = NULL;
+static int num_watchers = 0;
+static int watcher_capacity = 0;
+static struct pollfd *poll_fds = NULL;
+static int dispatching = 0;
+
+// Initialize the event loop
+void init_event_loop(void) {
+    free(watchers);
+    free(poll_fds);
+    watchers = NULL;
+    poll_fds = NULL;
+    num_watchers = 0;
+    watcher_capacity = 0;
+    dispatching = 0;
+}
+
+// Drop watchers that were removed while callbacks were running
+static void compact_watchers(void) {
+    int j = 0;
+    for (int i = 0; i < num_watchers; i++) {
+        if (!watchers[i].removed) {
+            watchers[j++] = watchers[i];
+        }
+    }
+    num_watchers = j;
+}
+
+// Watch fd for readability
+int event_add_fd(int fd, EventCallback callback, void *data) {
+    if (fd < 0 || !callback) {
+        return -1;
+    }
+
+    if (num_watchers == watcher_capacity) {
+        int new_capacity = watcher_capacity ? watcher_capacity * 2 : 16;
+        Watcher *new_watchers = realloc(watchers, new_capacity * sizeof(Watcher));
+        if (!new_watchers) {
+            perror("realloc");
+            return -1;
+        }
+        watchers = new_watchers;
+
+        struct pollfd *new_poll_fds = realloc(poll_fds, (new_capacity + 1) * sizeof(struct pollfd));
+        if (!new_poll_fds) {
+            perror("realloc");
+            return -1;
+        }
+        poll_fds = new_poll_fds;
+        watcher_capacity = new_capacity;
+    }
+
+    watchers[num_watchers].fd = fd;
+    watchers[num_watchers].callback = callback;
+    watchers[num_watchers].data = data;
+    watchers[num_watchers].removed = 0;
+    num_watchers++;
+
+    return 0;
+}
+
+// Stop watching fd
+void event_remove_fd(int fd) {
+    for (int i = 0; i < num_watchers; i++) {
+        if (watchers[i].fd == fd && !watchers[i].removed) {
+            watchers[i].removed = 1;
+        }
+    }
+    if (!dispatching) {
+        compact_watchers();
+    }
+}
+
+// Poll all watchers plus an optional extra fd
+// Returns 1 if extra_fd is readable, 0 otherwise, -1 if interrupted
+static int poll_and_dispatch(int extra_fd, int timeout_ms, int *dispatched) {
+    // Make sure there is room for the extra slot even with no watchers
+    if (!poll_fds) {
+        poll_fds = malloc(sizeof(struct pollfd));
+        if (!poll_fds) {
+            perror("malloc");
+            return -1;
+        }
+    }
+
+    int n = num_watchers;
+    for (int i = 0; i < n; i++) {
+        poll_fds[i].fd = watchers[i].fd;
+        poll_fds[i].events = POLLIN;
+        poll_fds[i].revents = 0;
+    }
+    int nfds = n;
+    if (extra_fd >= 0) {
+        poll_fds[nfds].fd = extra_fd;
+        poll_fds[nfds].events = POLLIN;
+        poll_fds[nfds].revents = 0;
+        nfds++;
+    }
+
+    int ready = poll(poll_fds, nfds, timeout_ms);
+    if (ready == -1) {
+        if (errno != EINTR) {
+            perror("myshell: poll");
+        }
+        return -1;
+    }
+
+    // Callbacks may add or remove watchers; only the first n are dispatched
+    dispatching = 1;
+    for (int i = 0; i < n && ready > 0; i++) {
+        if (poll_fds[i].revents == 0) {
+            continue;
+        }
+        ready--;
+        if (!watchers[i].removed) {
+            watchers[i].callback(watchers[i].fd, watchers[i].data);
+            (*dispatched)++;
+        }
+    }
+    dispatching = 0;
+    compact_watchers();
+
+    return (extra_fd >= 0 && poll_fds[n].revents != 0) ? 1 : 0;
+}
+
+// Wait for at most timeout_ms and dispatch ready callbacks
+int event_run_once(int timeout_ms) {
+    int dispatched = 0;
+    if (poll_and_dispatch(-1, timeout_ms, &dispatched) == -1) {
+        return -1;
+    }
+    return dispatched;
+}
+
+// Run the event loop until fd is readable
+void event_wait_fd(int fd) {
+    for (;;) {
+        int dispatched = 0;
+        int ret = poll_and_dispatch(fd, -1, &dispatched);
+        if (ret == 1) {
+            return;
+        }
+        if (ret == -1 && errno != EINTR) {
+            return;  // Let the caller's read() report the problem
+        }
+    }
+}
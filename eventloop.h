@@ -0,0 +1,26 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+// Callback invoked when a watched file descriptor becomes readable
+// (or hits EOF/error - the callback's read() will tell)
+typedef void (*EventCallback)(int fd, void *data);
+
+// Initialize the event loop
+void init_event_loop(void);
+
+// Watch fd for readability
+// Returns 0 on success, -1 on error
+int event_add_fd(int fd, EventCallback callback, void *data);
+
+// Stop watching fd (safe to call from inside a callback)
+void event_remove_fd(int fd);
+
+// Wait for at most timeout_ms (-1 = forever) and dispatch ready callbacks
+// Returns number of callbacks run, or -1 if interrupted by a signal
+int event_run_once(int timeout_ms);
+
+// Run the event loop until fd is readable (fd itself is not dispatched)
+// Used to keep background work going while waiting at the prompt
+void event_wait_fd(int fd);
+
+#endif // EVENTLOOP_H
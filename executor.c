@@ -5,49 +5,144 @@
 #include "executor.h"
 #include "builtins.h"
 #include "jobs.h"
+#include "launch.h"
+#include "capture.h"
+#include "cgroup.h"
+#include "timeout.h"
+#include "perfstat.h"
+#include "sysacct.h"
+#include "metrics.h"
+#include "memacct.h"
+#include "signals.h"
+#include "jobqueue.h"
+#include "trace.h"
+#include "linebuf.h"
 #include "utils.h"
+#include <dirent.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <termios.h>
 
-// Execute a command with redirections
-// cmd: Command structure with argv and redirection info
-// Returns exit status of command, or -1 on error
-int execute_command(Command *cmd) {
-    if (!cmd || !cmd->argv || !cmd->argv[0]) {
-        return -1;
+// Build the command string shown in the job table ("cmd args | cmd args")
+// Long commands are truncated to fit the buffer
+static void build_job_command(Pipeline *pipeline, char *buf, size_t size) {
+    size_t pos = 0;
+    buf[0] = '\0';
+
+    for (int i = 0; i < pipeline->num_commands && pos < size; i++) {
+        if (i > 0) {
+            pos += snprintf(buf + pos, size - pos, " | ");
+        }
+        for (int j = 0; pipeline->commands[i].argv[j] != NULL && pos < size; j++) {
+            pos += snprintf(buf + pos, size - pos, "%s%s", j > 0 ? " " : "",
+                            pipeline->commands[i].argv[j]);
+        }
     }
+}
 
-    // Save original file descriptors
-    int stdin_fd = dup(STDIN_FILENO);
-    int stdout_fd = dup(STDOUT_FILENO);
-    if (stdin_fd == -1 || stdout_fd == -1) {
-        perror("myshell: dup");
-        return -1;
+// Extra stdio wiring for a job's pipeline (-1 = leave as is)
+// stdin_fd feeds the first stage, stdout_fd takes the last stage's output
+// and stderr_fd every stage's errors
+typedef struct {
+    int stdin_fd;
+    int stdout_fd;
+    int stderr_fd;
+} JobIo;
+
+// Close every close-on-exec fd, as exec would
+// Builtins run in a forked child never exec, so without this they would
+// keep shell-side fds (coprocess pipes, capture pipes, timers) open
+static void close_cloexec_fds(void) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int fd = atoi(entry->d_name);
+        // The trace file stays open so the builtin's events are recorded
+        if (fd > STDERR_FILENO && fd != dirfd(dir) && fd != trace_fileno()) {
+            int flags = fcntl(fd, F_GETFD);
+            if (flags != -1 && (flags & FD_CLOEXEC)) {
+                close(fd);
+            }
+        }
     }
+    closedir(dir);
+}
 
-    // Handle input redirection
+// Child side of one pipeline stage: join the process group, wire up
+// stdin/stdout, apply redirections and exec (or run the builtin)
+// If sync_fd is not -1, waits for EOF on it before running the command
+// (the shell attaches perf counters in the meantime)
+// Never returns
+static void exec_stage(Pipeline *pipeline, int i, int (*pipe_fds)[2], int num_pipes,
+                       pid_t pipeline_pgid, const LaunchOptions *opts, const JobIo *io,
+                       int sync_fd) {
+    Command *cmd = &pipeline->commands[i];
+    int last = (i == pipeline->num_commands - 1);
+
+    trace_after_fork();
+
+    // The parent does the same via setpgid(pid, pipeline_pgid);
+    // doing it on both sides avoids a race with early exits
+    if (i == 0) {
+        // First process - create new process group
+        setpgid(0, 0);
+    } else {
+        setpgid(0, pipeline_pgid);
+    }
+
+    // If foreground, set as foreground process group (only first process)
+    if (!pipeline->background && i == 0) {
+        if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+            // Ignore error if not a terminal
+        }
+    }
+
+    reset_child_signals();
+    if (apply_launch_options(opts) == -1) {
+        exit(1);
+    }
+
+    // Set up stdin
+    if (i > 0) {
+        // Not first command - read from previous pipe
+        dup2(pipe_fds[i - 1][0], STDIN_FILENO);
+    } else if (io->stdin_fd != -1) {
+        dup2(io->stdin_fd, STDIN_FILENO);
+    } else if (pipeline->background && cmd->input_file == NULL) {
+        // Background process - redirect stdin to /dev/null
+        // This prevents background processes from reading from terminal
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd != -1) {
+            dup2(fd, STDIN_FILENO);
+            close(fd);
+        }
+    }
+
+    // Set up stdout and stderr (captured output, coprocess pipe)
+    if (!last) {
+        // Not last command - write to next pipe
+        dup2(pipe_fds[i][1], STDOUT_FILENO);
+    } else if (io->stdout_fd != -1) {
+        dup2(io->stdout_fd, STDOUT_FILENO);
+    }
+    if (io->stderr_fd != -1) {
+        dup2(io->stderr_fd, STDERR_FILENO);
+    }
+
+    // Explicit redirections take precedence over pipes
     if (cmd->input_file != NULL) {
         int fd = open(cmd->input_file, O_RDONLY);
         if (fd == -1) {
             fprintf(stderr, "myshell: %s: ", cmd->input_file);
             perror("");
-            close(stdin_fd);
-            close(stdout_fd);
-            return 1;
-        }
-        // Redirect stdin to file
-        if (dup2(fd, STDIN_FILENO) == -1) {
-            perror("myshell: dup2");
-            close(fd);
-            close(stdin_fd);
-            close(stdout_fd);
-            return -1;
+            exit(1);
         }
+        dup2(fd, STDIN_FILENO);
         close(fd);
     }
-
-    // Handle output redirection
     if (cmd->output_file != NULL) {
         int flags = O_WRONLY | O_CREAT;
         if (cmd->append_mode) {
@@ -59,452 +154,617 @@ int execute_command(Command *cmd) {
         if (fd == -1) {
             fprintf(stderr, "myshell: %s: ", cmd->output_file);
             perror("");
-            // Restore original file descriptors
-            dup2(stdin_fd, STDIN_FILENO);
-            dup2(stdout_fd, STDOUT_FILENO);
-            close(stdin_fd);
-            close(stdout_fd);
-            return 1;
-        }
-        // Redirect stdout to file
-        if (dup2(fd, STDOUT_FILENO) == -1) {
-            perror("myshell: dup2");
-            close(fd);
-            // Restore original file descriptors
-            dup2(stdin_fd, STDIN_FILENO);
-            dup2(stdout_fd, STDOUT_FILENO);
-            close(stdin_fd);
-            close(stdout_fd);
-            return -1;
+            exit(1);
         }
+        dup2(fd, STDOUT_FILENO);
         close(fd);
     }
 
-    // Execute command
-    int status = -1;
+    // Close ALL pipe file descriptors in child
+    // CRITICAL: After dup2, the pipe is accessible via stdin/stdout
+    // Closing the original pipe fds is necessary so that:
+    // 1. When a process exits, EOF is properly sent
+    // 2. No file descriptor leaks occur
+    // 3. The pipe works correctly
+    for (int j = 0; j < num_pipes; j++) {
+        close(pipe_fds[j][0]);
+        close(pipe_fds[j][1]);
+    }
 
-    // Check if it's a built-in command
-    if (is_builtin(cmd->argv[0])) {
-        status = execute_builtin(cmd->argv);
-    } else {
-        // External command - use fork + exec
-        pid_t pid = fork();
+    // Set stdout to unbuffered if it's not the terminal
+    // This ensures data is written immediately, not buffered
+    if (!last || cmd->output_file != NULL || io->stdout_fd != -1) {
+        setvbuf(stdout, NULL, _IONBF, 0);
+    }
 
-        if (pid == -1) {
-            perror("myshell: fork");
-            status = -1;
-        } else if (pid == 0) {
-            // Child process
-            // Create new process group
-            setpgid(0, 0);
-            
-            // If foreground, set as foreground process group
-            if (!cmd->background) {
-                if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-                    // Ignore error if not a terminal
-                }
-            } else {
-                // Background process - redirect stdin to /dev/null
-                // This prevents background processes from reading from terminal
-                int fd = open("/dev/null", O_RDONLY);
-                if (fd != -1) {
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
-                }
-            }
-            
-            // Execute the command
-            if (execvp(cmd->argv[0], cmd->argv) == -1) {
-                fprintf(stderr, "myshell: %s: command not found\n", cmd->argv[0]);
-                exit(1);
-            }
-            // execvp never returns on success, but compiler needs a return
-            exit(1);  // Should never reach here
-        } else {
-            // Parent process
-            // Create process group (setpgid in parent before child execs)
-            setpgid(pid, pid);
-            
-            // Get the actual process group ID (might be different if child already set it)
-            pid_t pgid = getpgid(pid);
-            if (pgid == -1) {
-                pgid = pid;  // Fallback to pid if getpgid fails
-            }
-            
-            if (cmd->background) {
-                // Background process - don't wait
-                // Build command string for job table
-                char cmd_str[MAX_INPUT_SIZE] = {0};
-                for (int i = 0; cmd->argv[i] != NULL; i++) {
-                    if (i > 0) strcat(cmd_str, " ");
-                    strcat(cmd_str, cmd->argv[i]);
-                }
-                
-                int job_id = add_job(pgid, cmd_str, JOB_RUNNING);
-                if (job_id > 0) {
-                    printf("[%d] %d\n", job_id, (int)pgid);
-                    fflush(stdout);
-                }
-                
-                // Ensure shell's process group is foreground for getline() to work
-                if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-                    // Ignore error if not a terminal
-                }
-                
-                status = 0;  // Return success immediately
-            } else {
-                // Foreground process - set as foreground process group and wait
-                if (tcsetpgrp(STDIN_FILENO, pid) == -1) {
-                    // Ignore error if not a terminal
-                }
-                
-                int child_status;
-                if (waitpid(pid, &child_status, WUNTRACED) == -1) {
-                    perror("myshell: waitpid");
-                    status = -1;
-                } else {
-                    // Return shell's process group to foreground
-                    if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-                        // Ignore error if not a terminal
-                    }
-                    
-                    // Return exit status of child
-                    if (WIFEXITED(child_status)) {
-                        status = WEXITSTATUS(child_status);
-                    } else if (WIFSIGNALED(child_status)) {
-                        status = 128 + WTERMSIG(child_status);
-                    } else if (WIFSTOPPED(child_status)) {
-                        // Process was stopped - add to job table
-                        char cmd_str[MAX_INPUT_SIZE] = {0};
-                        for (int i = 0; cmd->argv[i] != NULL; i++) {
-                            if (i > 0) strcat(cmd_str, " ");
-                            strcat(cmd_str, cmd->argv[i]);
-                        }
-                        int job_id = add_job(pid, cmd_str, JOB_STOPPED);
-                        if (job_id > 0) {
-                            printf("\n[%d]+  Stopped    %s\n", job_id, cmd_str);
-                        }
-                        status = 0;
-                    } else {
-                        status = -1;
-                    }
-                }
-            }
+    if (sync_fd != -1) {
+        char c;
+        while (read(sync_fd, &c, 1) == -1 && errno == EINTR) {
+            // Retry
         }
+        close(sync_fd);
     }
 
-    // Restore original file descriptors
-    if (dup2(stdin_fd, STDIN_FILENO) == -1) {
-        perror("myshell: dup2 restore stdin");
-    }
-    if (dup2(stdout_fd, STDOUT_FILENO) == -1) {
-        perror("myshell: dup2 restore stdout");
+    // Execute the command
+    if (is_builtin(cmd->argv[0])) {
+        close_cloexec_fds();
+        int status = execute_builtin(cmd->argv);
+        exit(status);
     }
-    close(stdin_fd);
-    close(stdout_fd);
 
-    return status;
+    trace_instant("exec", cmd->argv[0]);
+    execvp(cmd->argv[0], cmd->argv);
+    fprintf(stderr, "myshell: %s: command not found\n", cmd->argv[0]);
+    exit(1);
 }
 
-// Execute a pipeline of commands
-// pipeline: Pipeline structure with multiple commands
-// Returns exit status of last command, or -1 on error
-int execute_pipeline(Pipeline *pipeline) {
-    if (!pipeline || pipeline->num_commands == 0) {
-        return -1;
-    }
-
-    // Single command - no pipes needed
-    if (pipeline->num_commands == 1) {
-        return execute_command(&pipeline->commands[0]);
-    }
-
-    // Multiple commands - need pipes
+// Fork every stage of a pipeline into a new process group
+// Fills pids (one per command) and *pgid_out
+// With perf, counters are attached to each stage before it runs its command
+// Returns 0 on success, -1 on error (already-forked stages are killed)
+static int launch_pipeline(Pipeline *pipeline, pid_t *pids, pid_t *pgid_out,
+                           const LaunchOptions *opts, JobCgroup *cgroup, const JobIo *io,
+                           PerfStat *perf) {
     int num_pipes = pipeline->num_commands - 1;
-    int (*pipe_fds)[2] = malloc(num_pipes * sizeof(int[2]));
-    if (!pipe_fds) {
-        perror("malloc");
-        return -1;
+    int (*pipe_fds)[2] = NULL;
+
+    if (num_pipes > 0) {
+        pipe_fds = malloc(num_pipes * sizeof(int[2]));
+        if (!pipe_fds) {
+            perror("malloc");
+            return -1;
+        }
     }
 
     // Create all pipes
     for (int i = 0; i < num_pipes; i++) {
-        if (pipe(pipe_fds[i]) == -1) {
+        if (sysacct_pipe(pipe_fds[i]) == -1) {
             perror("myshell: pipe");
             // Close already created pipes
             for (int j = 0; j < i; j++) {
-                close(pipe_fds[j][0]);
-                close(pipe_fds[j][1]);
+                sysacct_close(pipe_fds[j][0]);
+                sysacct_close(pipe_fds[j][1]);
             }
             free(pipe_fds);
             return -1;
         }
     }
 
-    // Save original stdin/stdout for restoration
-    int stdin_fd = dup(STDIN_FILENO);
-    int stdout_fd = dup(STDOUT_FILENO);
-    if (stdin_fd == -1 || stdout_fd == -1) {
-        perror("myshell: dup");
-        // Close all pipes
-        for (int i = 0; i < num_pipes; i++) {
-            close(pipe_fds[i][0]);
-            close(pipe_fds[i][1]);
-        }
-        free(pipe_fds);
-        return -1;
-    }
-
-    pid_t *pids = malloc(pipeline->num_commands * sizeof(pid_t));
-    if (!pids) {
-        perror("malloc");
-        // Close all pipes
-        for (int i = 0; i < num_pipes; i++) {
-            close(pipe_fds[i][0]);
-            close(pipe_fds[i][1]);
-        }
-        free(pipe_fds);
-        close(stdin_fd);
-        close(stdout_fd);
-        return -1;
-    }
-
     // Fork and execute each command
     pid_t pipeline_pgid = 0;  // Process group ID for entire pipeline
-    
+    int result = 0;
+    uint64_t launch_start = metrics_clock();
+
     for (int i = 0; i < pipeline->num_commands; i++) {
-        pid_t pid = fork();
+        // The stage waits on this pipe until its counters are attached
+        int sync_pipe[2] = { -1, -1 };
+        if (perf && sysacct_pipe2(sync_pipe, O_CLOEXEC) == -1) {
+            perror("myshell: perfstat: pipe");
+            sync_pipe[0] = sync_pipe[1] = -1;
+        }
+
+        trace_begin("fork", pipeline->commands[i].argv[0]);
+        uint64_t fork_start = sysacct_start();
+        pid_t pid = cgroup_fork(cgroup);
+        sysacct_record(ACCT_FORK, fork_start, pid == -1);
         if (pid == -1) {
+            trace_end("fork");
+            if (sync_pipe[0] != -1) {
+                sysacct_close(sync_pipe[0]);
+                sysacct_close(sync_pipe[1]);
+            }
             perror("myshell: fork");
             // Kill already forked processes
             for (int j = 0; j < i; j++) {
                 kill(pids[j], SIGTERM);
             }
-            // Close all pipes
-            for (int j = 0; j < num_pipes; j++) {
-                close(pipe_fds[j][0]);
-                close(pipe_fds[j][1]);
-            }
-            free(pipe_fds);
-            free(pids);
-            close(stdin_fd);
-            close(stdout_fd);
-            return -1;
+            result = -1;
+            break;
         }
 
         if (pid == 0) {
-            // Child process
-            // Create/join process group (first process creates, others join)
-            if (i == 0) {
-                // First process - create new process group
-                setpgid(0, 0);
-            }
-            // For other processes, the parent will set the process group for us
-            // via setpgid(pid, pipeline_pgid) call below
-            
-            // If foreground, set as foreground process group (only first process)
-            if (!pipeline->background && i == 0) {
-                if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-                    // Ignore error if not a terminal
-                }
-            }
-
-            // Set up stdin
-            if (i == 0) {
-                // First command - check for input redirection
-                if (pipeline->commands[i].input_file != NULL) {
-                    int fd = open(pipeline->commands[i].input_file, O_RDONLY);
-                    if (fd == -1) {
-                        fprintf(stderr, "myshell: %s: ", pipeline->commands[i].input_file);
-                        perror("");
-                        exit(1);
-                    }
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
-                } else if (pipeline->background) {
-                    // Background process - redirect stdin to /dev/null
-                    int fd = open("/dev/null", O_RDONLY);
-                    if (fd != -1) {
-                        dup2(fd, STDIN_FILENO);
-                        close(fd);
-                    }
-                }
-                // If foreground and no input redirection, stdin stays as is (from terminal)
-            } else {
-                // Not first command - read from previous pipe
-                dup2(pipe_fds[i - 1][0], STDIN_FILENO);
-            }
-
-            // Set up stdout
-            if (i == pipeline->num_commands - 1) {
-                // Last command - check for output redirection
-                if (pipeline->commands[i].output_file != NULL) {
-                    int flags = O_WRONLY | O_CREAT;
-                    if (pipeline->commands[i].append_mode) {
-                        flags |= O_APPEND;
-                    } else {
-                        flags |= O_TRUNC;
-                    }
-                    int fd = open(pipeline->commands[i].output_file, flags, 0644);
-                    if (fd == -1) {
-                        fprintf(stderr, "myshell: %s: ", pipeline->commands[i].output_file);
-                        perror("");
-                        exit(1);
-                    }
-                    dup2(fd, STDOUT_FILENO);
-                    close(fd);
-                }
-                // If no output redirection, stdout stays as is (to terminal)
-            } else {
-                // Not last command - write to next pipe
-                dup2(pipe_fds[i][1], STDOUT_FILENO);
+            if (sync_pipe[1] != -1) {
+                close(sync_pipe[1]);
             }
+            exec_stage(pipeline, i, pipe_fds, num_pipes, pipeline_pgid, opts, io, sync_pipe[0]);
+        }
 
-            // Close ALL pipe file descriptors in child
-            // CRITICAL: After dup2, the pipe is accessible via stdin/stdout
-            // Closing the original pipe fds is necessary so that:
-            // 1. When a process exits, EOF is properly sent
-            // 2. No file descriptor leaks occur
-            // 3. The pipe works correctly
-            for (int j = 0; j < num_pipes; j++) {
-                close(pipe_fds[j][0]);
-                close(pipe_fds[j][1]);
-            }
+        // Parent process - save pid
+        trace_end("fork");
+        trace_async_begin("process", pid, pipeline->commands[i].argv[0]);
+        pids[i] = pid;
 
-            // Set stdout to unbuffered if it's a pipe (not last command or has output redirection)
-            // This ensures data is written immediately, not buffered
-            if (i < pipeline->num_commands - 1 || pipeline->commands[i].output_file != NULL) {
-                setvbuf(stdout, NULL, _IONBF, 0);
-            }
+        if (sync_pipe[0] != -1) {
+            // Builtins never exec, so their counters start right away
+            perfstat_attach(perf, pid, !is_builtin(pipeline->commands[i].argv[0]));
+            sysacct_close(sync_pipe[0]);
+            sysacct_close(sync_pipe[1]);  // Releases the stage
+        }
 
-            // Execute the command
-            if (is_builtin(pipeline->commands[i].argv[0])) {
-                int status = execute_builtin(pipeline->commands[i].argv);
-                exit(status);
-            } else {
-                if (execvp(pipeline->commands[i].argv[0], pipeline->commands[i].argv) == -1) {
-                    fprintf(stderr, "myshell: %s: command not found\n", 
-                           pipeline->commands[i].argv[0]);
-                    exit(1);
-                }
-                // execvp never returns on success
-                exit(1);
-            }
+        // Set process group (first process creates, others join)
+        if (i == 0) {
+            pipeline_pgid = pid;
+            sysacct_setpgid(pid, pid);
         } else {
-            // Parent process - save pid
-            pids[i] = pid;
-            
-            // Set process group (first process creates, others join)
-            if (i == 0) {
-                pipeline_pgid = pid;
-                setpgid(pid, pid);
-            } else {
-                setpgid(pid, pipeline_pgid);
-            }
+            sysacct_setpgid(pid, pipeline_pgid);
         }
     }
 
     // Parent process - close all pipe file descriptors
     for (int i = 0; i < num_pipes; i++) {
-        close(pipe_fds[i][0]);
-        close(pipe_fds[i][1]);
+        sysacct_close(pipe_fds[i][0]);
+        sysacct_close(pipe_fds[i][1]);
     }
     free(pipe_fds);
 
-    if (pipeline->background) {
-        // Background pipeline - don't wait
-        // Build command string for job table
-        char cmd_str[MAX_INPUT_SIZE] = {0};
+    if (result == 0 && metrics_enabled()) {
+        metrics_launch(launch_start, pipeline->num_commands);
         for (int i = 0; i < pipeline->num_commands; i++) {
-            if (i > 0) strcat(cmd_str, " | ");
-            for (int j = 0; pipeline->commands[i].argv[j] != NULL; j++) {
-                if (j > 0) strcat(cmd_str, " ");
-                strcat(cmd_str, pipeline->commands[i].argv[j]);
-            }
+            metrics_command(is_builtin(pipeline->commands[i].argv[0]));
         }
-        
-        int job_id = add_job(pipeline_pgid, cmd_str, JOB_RUNNING);
-        if (job_id > 0) {
-            printf("[%d] %d\n", job_id, (int)pipeline_pgid);
-            fflush(stdout);
+    }
+
+    *pgid_out = pipeline_pgid;
+    return result;
+}
+
+// Wait for a foreground job to finish or stop
+// Runs the event loop meanwhile so background work (e.g. output capture)
+// keeps making progress
+static void wait_foreground(Job *job) {
+    trace_begin("wait", NULL);
+    ReplPhase phase = sysacct_set_phase(PHASE_WAIT);
+    set_foreground_job(job);
+    while (job->status == JOB_RUNNING) {
+        wait_for_event();  // SIGINT is forwarded to the job, keep waiting
+    }
+    set_foreground_job(NULL);
+    sysacct_set_phase(phase);
+    trace_end("wait");
+}
+
+// Launch a job's pipeline in the background and record its processes
+// io may be NULL; output capture only applies to jobs without io wiring
+// Returns 0 on success, -1 on error
+static int start_background_job(Job *job, Pipeline *pipeline, const JobIo *io) {
+    pid_t *pids = malloc(pipeline->num_commands * sizeof(pid_t));
+    if (!pids) {
+        perror("malloc");
+        return -1;
+    }
+
+    // Give the job its own cgroup if requested
+    if (job->launch.use_cgroup && !job->cgroup) {
+        job->cgroup = cgroup_create(&job->launch);
+        if (!job->cgroup) {
+            free(pids);
+            return -1;
+        }
+    }
+
+    if (job->launch.perfstat && !job->perf) {
+        job->perf = perfstat_create();
+    }
+
+    // Capture the job's output if requested
+    JobOutput *output = NULL;
+    int capture_fd = -1;
+    JobIo job_io = { -1, -1, -1 };
+    if (io) {
+        job_io = *io;
+    } else if (job->launch.capture) {
+        output = capture_start(&capture_fd);
+        job_io.stdout_fd = capture_fd;
+        job_io.stderr_fd = capture_fd;
+    }
+
+    pid_t pgid;
+    int launched = launch_pipeline(pipeline, pids, &pgid, &job->launch, job->cgroup, &job_io,
+                                   job->perf);
+
+    // Only the job holds the write end now
+    if (capture_fd != -1) {
+        sysacct_close(capture_fd);
+    }
+
+    if (launched == -1) {
+        capture_free(output);
+        free(pids);
+        return -1;
+    }
+
+    set_job_pgid(job, pgid);
+    set_job_status(job, JOB_RUNNING);
+    job->output = output;
+    for (int i = 0; i < pipeline->num_commands; i++) {
+        add_job_process(job->job_id, pids[i]);
+    }
+    job_timeout_start(job);
+
+    free(pids);
+    return 0;
+}
+
+// Start a job that was waiting in the job queue
+int start_queued_job(Job *job) {
+    // Queued jobs always run in the background
+    job->pending->background = 1;
+
+    int result = start_background_job(job, job->pending, NULL);
+    if (result == -1) {
+        set_job_status(job, JOB_DONE);
+        job->exit_status = 126;
+    }
+
+    free_pipeline(job->pending);
+    mem_free(MEM_JOBS, job->pending);
+    job->pending = NULL;
+
+    return result;
+}
+
+// Put a pipeline in the job queue ("batch" prefix)
+// Returns 0 on success, -1 on error
+static int queue_job(Pipeline *pipeline, LaunchOptions *opts, const char *cmd_str) {
+    Pipeline *pending = mem_malloc(MEM_JOBS, sizeof(Pipeline));
+    if (!pending) {
+        perror("malloc");
+        return -1;
+    }
+    if (copy_pipeline(pipeline, pending) == -1) {
+        mem_free(MEM_JOBS, pending);
+        return -1;
+    }
+
+    int job_id = add_job(0, cmd_str, JOB_QUEUED);
+    if (job_id <= 0) {
+        fprintf(stderr, "myshell: batch: job table full\n");
+        free_pipeline(pending);
+        mem_free(MEM_JOBS, pending);
+        return -1;
+    }
+
+    Job *job = find_job(job_id);
+    job->pending = pending;
+    job->launch = *opts;
+
+    if (jobqueue_push(job_id, opts->priority) == -1) {
+        remove_job(job_id);
+        return -1;
+    }
+
+    printf("[%d] queued\n", job_id);
+    fflush(stdout);
+
+    // Starts right away if the limit allows
+    jobqueue_dispatch();
+    return 0;
+}
+
+// Start a pipeline as a coprocess ("coproc NAME cmd")
+// The shell keeps one end of a pipe to its stdin and one from its stdout,
+// exported as NAME_IN and NAME_OUT (fd numbers, close-on-exec: use them
+// through /dev/fd/N) along with NAME_PID
+// Returns 0 on success, -1 on error
+static int run_coproc(Pipeline *pipeline, LaunchOptions *opts, const char *cmd_str) {
+    const char *name = opts->coproc_name;
+    if (find_coproc(name)) {
+        fprintf(stderr, "myshell: coproc: %s: already running\n", name);
+        return -1;
+    }
+
+    int to_coproc[2];
+    int from_coproc[2];
+    if (sysacct_pipe2(to_coproc, O_CLOEXEC) == -1) {
+        perror("myshell: coproc: pipe");
+        return -1;
+    }
+    if (sysacct_pipe2(from_coproc, O_CLOEXEC) == -1) {
+        perror("myshell: coproc: pipe");
+        sysacct_close(to_coproc[0]);
+        sysacct_close(to_coproc[1]);
+        return -1;
+    }
+
+    char job_str[MAX_INPUT_SIZE];
+    snprintf(job_str, sizeof(job_str), "coproc %s %s", name, cmd_str);
+    int job_id = add_job(0, job_str, JOB_RUNNING);
+    Job *job = job_id > 0 ? find_job(job_id) : NULL;
+    if (job) {
+        job->launch = *opts;
+        job->coproc_name = mem_strdup(MEM_JOBS, name);
+    }
+
+    // Coprocesses always run in the background
+    pipeline->background = 1;
+    JobIo io = { to_coproc[0], from_coproc[1], -1 };
+    if (!job || !job->coproc_name || start_background_job(job, pipeline, &io) == -1) {
+        if (!job) {
+            fprintf(stderr, "myshell: job table full\n");
+        } else {
+            remove_job(job_id);
         }
-        
+        sysacct_close(to_coproc[0]);
+        sysacct_close(to_coproc[1]);
+        sysacct_close(from_coproc[0]);
+        sysacct_close(from_coproc[1]);
+        return -1;
+    }
+
+    // The child ends belong to the coprocess now
+    sysacct_close(to_coproc[0]);
+    sysacct_close(from_coproc[1]);
+    job->coproc_in = to_coproc[1];
+    job->coproc_out = from_coproc[0];
+    linebuf_own(job->coproc_out);  // Only the shell reads it: read may read ahead
+
+    char var[96];
+    char value[32];
+    snprintf(var, sizeof(var), "%s_IN", name);
+    snprintf(value, sizeof(value), "%d", job->coproc_in);
+    setenv(var, value, 1);
+    snprintf(var, sizeof(var), "%s_OUT", name);
+    snprintf(value, sizeof(value), "%d", job->coproc_out);
+    setenv(var, value, 1);
+    snprintf(var, sizeof(var), "%s_PID", name);
+    snprintf(value, sizeof(value), "%d", (int)job->pids[job->num_procs - 1]);
+    setenv(var, value, 1);
+
+    printf("[%d] %d\n", job_id, (int)job->pgid);
+    fflush(stdout);
+    return 0;
+}
+
+// Launch a pipeline as a job and wait for it unless it runs in background
+// Returns exit status of last command, or -1 on error
+static int run_job(Pipeline *pipeline, LaunchOptions *opts) {
+    char cmd_str[MAX_INPUT_SIZE];
+    build_job_command(pipeline, cmd_str, sizeof(cmd_str));
+
+    if (opts->coproc_name[0] != '\0') {
+        return run_coproc(pipeline, opts, cmd_str) == -1 ? 1 : 0;
+    }
+    if (opts->queued) {
+        return queue_job(pipeline, opts, cmd_str) == -1 ? 1 : 0;
+    }
+
+    if (pipeline->background) {
+        // Background job - don't wait
+        int job_id = add_job(0, cmd_str, JOB_RUNNING);
+        if (job_id <= 0) {
+            fprintf(stderr, "myshell: job table full\n");
+            return -1;
+        }
+
+        Job *job = find_job(job_id);
+        job->launch = *opts;
+        if (start_background_job(job, pipeline, NULL) == -1) {
+            remove_job(job_id);
+            return -1;
+        }
+        printf("[%d] %d\n", job_id, (int)job->pgid);
+        fflush(stdout);
+
         // Ensure shell's process group is foreground for getline() to work
-        if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+        if (sysacct_tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
             // Ignore error if not a terminal
         }
-        
-        free(pids);
-        close(stdin_fd);
-        close(stdout_fd);
+
         return 0;  // Return success immediately
     }
 
-    // Foreground pipeline - set as foreground process group and wait
-    if (tcsetpgrp(STDIN_FILENO, pipeline_pgid) == -1) {
-        // Ignore error if not a terminal
+    pid_t *pids = malloc(pipeline->num_commands * sizeof(pid_t));
+    if (!pids) {
+        perror("malloc");
+        return -1;
     }
 
-    // Wait for all child processes in the pipeline
-    // Wait for the last process first (it's the one that produces final output)
-    // Then wait for others to clean up
-    int last_status = 0;
-    
-    // First, wait for the last process (which produces the final output)
-    if (pipeline->num_commands > 0) {
-        int status;
-        pid_t last_pid = pids[pipeline->num_commands - 1];
-        pid_t waited_pid = waitpid(last_pid, &status, WUNTRACED);
-        
-        if (waited_pid == last_pid) {
-            if (WIFEXITED(status)) {
-                last_status = WEXITSTATUS(status);
-            } else if (WIFSIGNALED(status)) {
-                last_status = 128 + WTERMSIG(status);
-            } else if (WIFSTOPPED(status)) {
-                // Pipeline was stopped - add to job table
-                char cmd_str[MAX_INPUT_SIZE] = {0};
-                for (int j = 0; j < pipeline->num_commands; j++) {
-                    if (j > 0) strcat(cmd_str, " | ");
-                    for (int k = 0; pipeline->commands[j].argv[k] != NULL; k++) {
-                        if (k > 0) strcat(cmd_str, " ");
-                        strcat(cmd_str, pipeline->commands[j].argv[k]);
-                    }
-                }
-                int job_id = add_job(pipeline_pgid, cmd_str, JOB_STOPPED);
-                if (job_id > 0) {
-                    printf("\n[%d]+  Stopped    %s\n", job_id, cmd_str);
-                    fflush(stdout);
-                }
-                last_status = 0;
-            }
-        } else if (waited_pid == -1 && errno == ECHILD) {
-            // Already reaped - that's fine
+    JobCgroup *cgroup = NULL;
+    if (opts->use_cgroup) {
+        cgroup = cgroup_create(opts);
+        if (!cgroup) {
+            free(pids);
+            return -1;
         }
     }
-    
-    // Now wait for any remaining processes (non-blocking to avoid hanging)
-    for (int i = 0; i < pipeline->num_commands - 1; i++) {
-        int status;
-        pid_t waited_pid = waitpid(pids[i], &status, WNOHANG | WUNTRACED);
-        
-        // Don't care about status of intermediate processes - just reap them
-        (void)waited_pid;
-        (void)status;
-    }
-    
+
+    PerfStat *perf = opts->perfstat ? perfstat_create() : NULL;
+
+    pid_t pgid;
+    JobIo no_io = { -1, -1, -1 };
+    if (launch_pipeline(pipeline, pids, &pgid, opts, cgroup, &no_io, perf) == -1) {
+        perfstat_free(perf);
+        cgroup_free(cgroup);
+        free(pids);
+        return -1;
+    }
+
+    // Foreground job - set as foreground process group and wait
+    if (sysacct_tcsetpgrp(STDIN_FILENO, pgid) == -1) {
+        // Ignore error if not a terminal
+    }
+
+    Job fg = {0};
+    fg.pgid = pgid;
+    fg.status = JOB_RUNNING;
+    fg.pids = pids;
+    fg.num_procs = pipeline->num_commands;
+    fg.live_procs = pipeline->num_commands;
+    fg.launch = *opts;
+    job_timeout_start(&fg);
+    wait_foreground(&fg);
+
     // Return shell's process group to foreground
-    if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+    if (sysacct_tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
         // Ignore error if not a terminal
     }
 
+    int status = fg.exit_status;
+    if (fg.status == JOB_STOPPED) {
+        // Job was stopped (Ctrl+Z) - add to job table
+        int job_id = add_job(pgid, cmd_str, JOB_STOPPED);
+        if (job_id > 0) {
+            for (int i = 0; i < fg.num_procs; i++) {
+                add_job_process(job_id, pids[i]);
+            }
+            // Carry over which stages have already exited
+            Job *job = find_job(job_id);
+            job->live_procs = fg.live_procs;
+            job->exit_status = fg.exit_status;
+            job->launch = *opts;
+            job->cgroup = cgroup;
+            cgroup = NULL;
+            job->perf = perf;
+            perf = NULL;
+            job_timeout_move(&fg, job);
+            printf("\n[%d]+  Stopped    %s\n", job_id, cmd_str);
+            fflush(stdout);
+        }
+        status = 0;
+    }
+
+    if (perf && fg.status == JOB_DONE) {
+        perfstat_report(perf, cmd_str);
+    }
+    perfstat_free(perf);
+    job_timeout_stop(&fg);
+    cgroup_free(cgroup);
     free(pids);
+    return status;
+}
+
+// Whether a builtin has to run as a job in a forked child instead of in
+// the shell: queued, counted and coprocess commands, and prefixes whose
+// settings only make sense for a child process (as in a pipeline, a
+// builtin run this way cannot change the shell's own state)
+// MYSHELL_CGROUPS alone does not count: it keeps builtins in the shell
+static int builtin_needs_job(const LaunchOptions *opts) {
+    return opts->queued || opts->coproc_name[0] != '\0' || opts->perfstat ||
+           opts->set_affinity || opts->set_nice || opts->set_ioprio || opts->cgroup_prefix ||
+           opts->num_rlimits > 0 || opts->timeout_ms > 0;
+}
+
+// Execute a command with redirections
+// cmd: Command structure with argv and redirection info
+// Returns exit status of command, or -1 on error
+int execute_command(Command *cmd) {
+    if (!cmd || !cmd->argv || !cmd->argv[0]) {
+        return -1;
+    }
+
+    LaunchOptions opts;
+    init_launch_options(&opts);
+    if (parse_launch_prefixes(cmd, &opts) == -1) {
+        return 1;
+    }
+
+    // External command (or a builtin that needs a child) - redirections are
+    // applied in the child
+    if (!is_builtin(cmd->argv[0]) || builtin_needs_job(&opts)) {
+        Pipeline single = { cmd, 1, cmd->background };
+        return run_job(&single, &opts);
+    }
+
+    // Built-in command - runs in the shell, so redirect the shell's own
+    // descriptors and restore them afterwards
+    metrics_command(1);
+
+    // Save original file descriptors
+    int stdin_fd = sysacct_dup(STDIN_FILENO);
+    int stdout_fd = sysacct_dup(STDOUT_FILENO);
+    if (stdin_fd == -1 || stdout_fd == -1) {
+        perror("myshell: dup");
+        return -1;
+    }
+
+    // Handle input redirection
+    if (cmd->input_file != NULL) {
+        int fd = sysacct_open(cmd->input_file, O_RDONLY, 0);
+        if (fd == -1) {
+            fprintf(stderr, "myshell: %s: ", cmd->input_file);
+            perror("");
+            sysacct_close(stdin_fd);
+            sysacct_close(stdout_fd);
+            return 1;
+        }
+        // Redirect stdin to file
+        if (sysacct_dup2(fd, STDIN_FILENO) == -1) {
+            perror("myshell: dup2");
+            sysacct_close(fd);
+            sysacct_close(stdin_fd);
+            sysacct_close(stdout_fd);
+            return -1;
+        }
+        sysacct_close(fd);
+    }
+
+    // Handle output redirection
+    if (cmd->output_file != NULL) {
+        int flags = O_WRONLY | O_CREAT;
+        if (cmd->append_mode) {
+            flags |= O_APPEND;
+        } else {
+            flags |= O_TRUNC;
+        }
+        int fd = sysacct_open(cmd->output_file, flags, 0644);
+        if (fd == -1) {
+            fprintf(stderr, "myshell: %s: ", cmd->output_file);
+            perror("");
+            // Restore original file descriptors
+            sysacct_dup2(stdin_fd, STDIN_FILENO);
+            sysacct_dup2(stdout_fd, STDOUT_FILENO);
+            sysacct_close(stdin_fd);
+            sysacct_close(stdout_fd);
+            return 1;
+        }
+        // Redirect stdout to file
+        if (sysacct_dup2(fd, STDOUT_FILENO) == -1) {
+            perror("myshell: dup2");
+            sysacct_close(fd);
+            // Restore original file descriptors
+            sysacct_dup2(stdin_fd, STDIN_FILENO);
+            sysacct_dup2(stdout_fd, STDOUT_FILENO);
+            sysacct_close(stdin_fd);
+            sysacct_close(stdout_fd);
+            return -1;
+        }
+        sysacct_close(fd);
+    }
+
+    int status = execute_builtin(cmd->argv);
+
+    // Restore original file descriptors
+    if (sysacct_dup2(stdin_fd, STDIN_FILENO) == -1) {
+        perror("myshell: dup2 restore stdin");
+    }
+    if (sysacct_dup2(stdout_fd, STDOUT_FILENO) == -1) {
+        perror("myshell: dup2 restore stdout");
+    }
+    sysacct_close(stdin_fd);
+    sysacct_close(stdout_fd);
+
+    return status;
+}
+
+// Execute a pipeline of commands
+// pipeline: Pipeline structure with multiple commands
+// Returns exit status of last command, or -1 on error
+int execute_pipeline(Pipeline *pipeline) {
+    if (!pipeline || pipeline->num_commands == 0) {
+        return -1;
+    }
+
+    // Single command - no pipes needed
+    if (pipeline->num_commands == 1) {
+        return execute_command(&pipeline->commands[0]);
+    }
 
-    // Restore original stdin/stdout
-    dup2(stdin_fd, STDIN_FILENO);
-    dup2(stdout_fd, STDOUT_FILENO);
-    close(stdin_fd);
-    close(stdout_fd);
+    // Launch prefixes on the first command apply to the whole pipeline
+    LaunchOptions opts;
+    init_launch_options(&opts);
+    if (parse_launch_prefixes(&pipeline->commands[0], &opts) == -1) {
+        return 1;
+    }
 
-    return last_status;
+    return run_job(pipeline, &opts);
 }
@@ -1,16 +1,21 @@
-#ifndef EXECUTOR_H
-#define EXECUTOR_H
-
-#include "parser.h"
-
-// Execute a command with redirections
-// cmd: Command structure with argv and redirection info
-// Returns exit status of command, or -1 on error
-int execute_command(Command *cmd);
-
-// Execute a pipeline of commands
-// pipeline: Pipeline structure with multiple commands
-// Returns exit status of last command, or -1 on error
-int execute_pipeline(Pipeline *pipeline);
-
-#endif // EXECUTOR_H
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "parser.h"
+#include "jobs.h"
+
+// Execute a command with redirections
+// cmd: Command structure with argv and redirection info
+// Returns exit status of command, or -1 on error
+int execute_command(Command *cmd);
+
+// Execute a pipeline of commands
+// pipeline: Pipeline structure with multiple commands
+// Returns exit status of last command, or -1 on error
+int execute_pipeline(Pipeline *pipeline);
+
+// Start a job that was waiting in the job queue (in the background)
+// Returns 0 on success, -1 on error (the job is then marked done)
+int start_queued_job(Job *job);
+
+#endif // EXECUTOR_H
@@ -0,0 +1,334 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+// Fuzz harness for tokenize() + parse_pipeline() / parse_command()
+// Each input is one command line, run through the same steps as the REPL.
+// Besides crashes and sanitizer reports, the harness aborts when a result
+// breaks an invariant the executor relies on (see check_* below).
+//
+// Built three ways (see the fuzz targets in the Makefile):
+//   -DFUZZ_LIBFUZZER  libFuzzer provides main()
+//   afl-cc            main() reads stdin, persistent mode via __AFL_LOOP
+//   plain cc          main() runs files given on the command line, or
+//                     mutates them with -m N (a quick check without clang)
+
+#include "parser.h"
+#include "utils.h"
+#include <stdint.h>
+
+// Variables the inputs can expand, so ${...} paths see real values
+static void set_fuzz_environment(void) {
+    setenv("HOME", "/home/fuzz", 1);
+    setenv("X", "x", 1);
+    setenv("EMPTY", "", 1);
+    setenv("SPACES", "a b  c", 1);
+    setenv("PIPE", "|", 1);
+    setenv("_", "underscore", 1);
+}
+
+static const char *current_input;  // For failure reports
+
+// Reports go straight to fd 2: the stderr stream may be muted
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            dprintf(STDERR_FILENO,                                           \
+                    "fuzz_parser: invariant failed: %s (%s:%d)\ninput: %s\n", \
+                    #cond, __FILE__, __LINE__, current_input);               \
+            abort();                                                         \
+        }                                                                    \
+    } while (0)
+
+// tokenize() output: count matches the NULL-terminated array and no token is
+// longer than an input line (a line that expands to nothing, like "$UNSET",
+// gives 0 and an empty array; "\0" in double quotes ends a token early, so
+// tokens can be empty strings)
+static void check_tokens(char **tokens, int count) {
+    CHECK(count >= 0);
+    if (count == 0) {
+        CHECK(tokens == NULL || tokens[0] == NULL);
+        return;
+    }
+    CHECK(tokens != NULL);
+    for (int i = 0; i < count; i++) {
+        CHECK(tokens[i] != NULL);
+        size_t len = strlen(tokens[i]);
+        CHECK(len < MAX_INPUT_SIZE);
+    }
+    CHECK(tokens[count] == NULL);
+}
+
+// parse_command() output: argv is NULL-terminated
+static void check_command(const Command *cmd) {
+    CHECK(cmd->argv != NULL);
+    int argc = 0;
+    while (cmd->argv[argc] != NULL) {
+        argc++;
+    }
+    CHECK(cmd->append_mode == 0 || cmd->output_file != NULL);
+}
+
+static int commands_equal(const Command *a, const Command *b) {
+    for (int i = 0;; i++) {
+        if (!a->argv[i] || !b->argv[i]) {
+            if (a->argv[i] != b->argv[i]) {
+                return 0;
+            }
+            break;
+        }
+        if (strcmp(a->argv[i], b->argv[i]) != 0) {
+            return 0;
+        }
+    }
+    if (!a->input_file != !b->input_file || !a->output_file != !b->output_file) {
+        return 0;
+    }
+    return (!a->input_file || strcmp(a->input_file, b->input_file) == 0) &&
+           (!a->output_file || strcmp(a->output_file, b->output_file) == 0) &&
+           a->append_mode == b->append_mode && a->background == b->background;
+}
+
+// parse_pipeline() output: one command per | and copy_pipeline() (used
+// by the job queue) gives an identical deep copy
+static void check_pipeline(const Pipeline *pipeline, char **tokens) {
+    int pipes = 0;
+    for (int i = 0; tokens[i] != NULL; i++) {
+        pipes += strcmp(tokens[i], "|") == 0;
+    }
+    CHECK(pipeline->num_commands == pipes + 1);
+    for (int i = 0; i < pipeline->num_commands; i++) {
+        check_command(&pipeline->commands[i]);
+    }
+
+    Pipeline copy;
+    if (copy_pipeline(pipeline, &copy) == 0) {
+        CHECK(copy.num_commands == pipeline->num_commands);
+        CHECK(copy.background == pipeline->background);
+        for (int i = 0; i < copy.num_commands; i++) {
+            CHECK(commands_equal(&copy.commands[i], &pipeline->commands[i]));
+        }
+        free_pipeline(&copy);
+    }
+}
+
+// Run one command line through the parser the way shell.c does
+static void fuzz_one_line(const uint8_t *data, size_t size) {
+    // The REPL never sees lines longer than its read buffer, a newline
+    // or an embedded NUL (getline input is cut at the first one)
+    if (size >= MAX_INPUT_SIZE) {
+        size = MAX_INPUT_SIZE - 1;
+    }
+    char *input = malloc(size + 1);
+    if (!input) {
+        return;
+    }
+    memcpy(input, data, size);
+    input[size] = '\0';
+    char *newline = strchr(input, '\n');
+    if (newline) {
+        *newline = '\0';
+    }
+    char *saved = strdup(input);
+    current_input = saved;
+
+    char **tokens = NULL;
+    int count = tokenize(input, &tokens);
+    if (saved) {
+        CHECK(strcmp(input, saved) == 0);  // tokenize() must not modify its input
+    }
+    if (count < 0) {
+        CHECK(tokens == NULL);
+    }
+    check_tokens(tokens, count < 0 ? 0 : count);
+    if (count <= 0) {
+        free_tokens(tokens, 0);
+        free(saved);
+        free(input);
+        return;
+    }
+
+    int has_pipe = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(tokens[i], "|") == 0) {
+            has_pipe = 1;
+            break;
+        }
+    }
+
+    if (has_pipe) {
+        Pipeline pipeline;
+        if (parse_pipeline(tokens, &pipeline) == 0) {
+            check_pipeline(&pipeline, tokens);
+            free_pipeline(&pipeline);
+        }
+    } else {
+        Command cmd;
+        if (parse_command(tokens, &cmd) == 0) {
+            check_command(&cmd);
+            free_command(&cmd);
+        }
+    }
+
+    free_tokens(tokens, count);
+    free(saved);
+    free(input);
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+    (void)argc;
+    (void)argv;
+    set_fuzz_environment();
+    // Syntax errors are expected; keep the parser's messages out of the
+    // output, but leave fd 2 to the sanitizers
+    if (getenv("FUZZ_VERBOSE") == NULL) {
+        FILE *null_stream = fopen("/dev/null", "w");
+        if (null_stream) {
+            stderr = null_stream;
+        }
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    fuzz_one_line(data, size);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+#ifndef __AFL_LOOP
+#define __AFL_LOOP(n) (first_iteration ? (first_iteration = 0, 1) : 0)
+#endif
+
+// Read a whole file (or stdin for NULL)
+// Returns the buffer (size in *size), or NULL on error
+static uint8_t *read_input(const char *path, size_t *size) {
+    FILE *file = path ? fopen(path, "rb") : stdin;
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+    size_t capacity = 4096;
+    uint8_t *data = malloc(capacity);
+    *size = 0;
+    size_t n;
+    while (data && (n = fread(data + *size, 1, capacity - *size, file)) > 0) {
+        *size += n;
+        if (*size == capacity) {
+            uint8_t *grown = realloc(data, capacity * 2);
+            if (!grown) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+    if (path) {
+        fclose(file);
+    }
+    return data;
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15u;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Bytes worth splicing in: the characters the tokenizer treats specially
+static const char interesting[] = "|&<>$'\"\\{} \t_a0";
+
+// Apply a few random edits (flip, insert, delete, splice a special byte)
+static size_t mutate(uint8_t *data, size_t size, size_t capacity) {
+    int edits = 1 + next_random() % 4;
+    for (int e = 0; e < edits; e++) {
+        size_t pos = size ? next_random() % size : 0;
+        switch (next_random() % 4) {
+            case 0:
+                if (size) {
+                    data[pos] ^= 1u << (next_random() % 8);
+                }
+                break;
+            case 1:
+                if (size < capacity) {
+                    memmove(data + pos + 1, data + pos, size - pos);
+                    data[pos] = interesting[next_random() % (sizeof(interesting) - 1)];
+                    size++;
+                }
+                break;
+            case 2:
+                if (size) {
+                    memmove(data + pos, data + pos + 1, size - pos - 1);
+                    size--;
+                }
+                break;
+            default:
+                if (size) {
+                    data[pos] = interesting[next_random() % (sizeof(interesting) - 1)];
+                }
+                break;
+        }
+    }
+    return size;
+}
+
+// Usage: fuzz_parser [-m iterations] [file ...]
+// With no files, one input is read from stdin (AFL)
+int main(int argc, char **argv) {
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    long mutations = 0;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-m") == 0) {
+        mutations = atol(argv[2]);
+        arg = 3;
+    }
+
+    if (arg == argc) {
+        int first_iteration = 1;
+        (void)first_iteration;
+        while (__AFL_LOOP(10000)) {
+            size_t size;
+            uint8_t *data = read_input(NULL, &size);
+            if (data) {
+                fuzz_one_line(data, size);
+                free(data);
+            }
+        }
+        return 0;
+    }
+
+    for (int i = arg; i < argc; i++) {
+        size_t size;
+        uint8_t *data = read_input(argv[i], &size);
+        if (!data) {
+            return 1;
+        }
+        fuzz_one_line(data, size);
+
+        if (mutations > 0) {
+            size_t capacity = MAX_INPUT_SIZE;
+            uint8_t *work = malloc(capacity);
+            for (long m = 0; work && m < mutations; m++) {
+                size_t len = size < capacity ? size : capacity;
+                memcpy(work, data, len);
+                for (int round = 0; round < 4; round++) {
+                    len = mutate(work, len, capacity);
+                    fuzz_one_line(work, len);
+                }
+            }
+            free(work);
+        }
+        free(data);
+    }
+    printf("fuzz_parser: %d inputs ok (%ld mutations each)\n", argc - arg, mutations * 4);
+    return 0;
+}
+
+#endif // FUZZ_LIBFUZZER
@@ -0,0 +1,301 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+// Corpus replay benchmark for the parser
+// Runs every line of the corpus files through tokenize() and
+// parse_pipeline() / parse_command() (as shell.c does) and reports time per
+// byte and line, and the allocations the parser makes per line. Linked with
+// -Wl,--wrap for the allocation functions, so only the parser's own calls
+// are counted; a line whose allocations are not all freed is a leak.
+//
+// Usage: replay [-n rounds] [-t ms] file|dir ...
+
+#include "parser.h"
+#include "utils.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static unsigned long alloc_calls;
+static unsigned long free_calls;
+static size_t alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *s);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+    alloc_calls++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    alloc_calls++;
+    alloc_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    alloc_calls += ptr == NULL;
+    alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *s) {
+    alloc_calls++;
+    alloc_bytes += strlen(s) + 1;
+    return __real_strdup(s);
+}
+
+void __wrap_free(void *ptr) {
+    free_calls += ptr != NULL;
+    __real_free(ptr);
+}
+
+typedef struct {
+    char **lines;
+    int count;
+    int capacity;
+    size_t bytes;
+} Corpus;
+
+// Add each line of a file to the corpus
+static int load_file(Corpus *corpus, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &size, file)) != -1) {
+        if (len > 0 && line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        if (len == 0 || len >= MAX_INPUT_SIZE) {
+            continue;  // The REPL skips these before tokenizing
+        }
+        if (corpus->count == corpus->capacity) {
+            int capacity = corpus->capacity ? corpus->capacity * 2 : 256;
+            char **lines = realloc(corpus->lines, capacity * sizeof(char *));
+            if (!lines) {
+                perror("realloc");
+                break;
+            }
+            corpus->lines = lines;
+            corpus->capacity = capacity;
+        }
+        corpus->lines[corpus->count++] = strndup(line, len);
+        corpus->bytes += len + 1;
+    }
+    free(line);
+    fclose(file);
+    return 0;
+}
+
+// Load a file, or every regular file in a directory
+static int load_path(Corpus *corpus, const char *path) {
+    struct stat st;
+    if (stat(path, &st) == -1) {
+        perror(path);
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return load_file(corpus, path);
+    }
+
+    struct dirent **entries;
+    int n = scandir(path, &entries, NULL, alphasort);  // Sorted: same order every run
+    if (n == -1) {
+        perror(path);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (entries[i]->d_name[0] != '.') {
+            char file[PATH_MAX];
+            snprintf(file, sizeof(file), "%s/%s", path, entries[i]->d_name);
+            load_file(corpus, file);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return 0;
+}
+
+// Parse one line the way shell.c does
+// Returns 0 if it parsed, -1 on a tokenize or syntax error
+static int parse_line(const char *line) {
+    char input[MAX_INPUT_SIZE];
+    strcpy(input, line);
+
+    char **tokens = NULL;
+    int count = tokenize(input, &tokens);
+    if (count <= 0) {
+        return count == 0 ? 0 : -1;
+    }
+
+    int has_pipe = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(tokens[i], "|") == 0) {
+            has_pipe = 1;
+            break;
+        }
+    }
+
+    int result;
+    if (has_pipe) {
+        Pipeline pipeline;
+        result = parse_pipeline(tokens, &pipeline);
+        if (result == 0) {
+            free_pipeline(&pipeline);
+        }
+    } else {
+        Command cmd;
+        result = parse_command(tokens, &cmd);
+        if (result == 0) {
+            free_command(&cmd);
+        }
+    }
+    free_tokens(tokens, count);
+    return result;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    int rounds = 20;
+    double min_round_ns = 20e6;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+        switch (opt) {
+            case 'n':
+                rounds = atoi(optarg);
+                break;
+            case 't':
+                min_round_ns = atof(optarg) * 1e6;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n rounds] [-t ms] file|dir ...\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind == argc || rounds < 1) {
+        fprintf(stderr, "Usage: %s [-n rounds] [-t ms] file|dir ...\n", argv[0]);
+        return 2;
+    }
+
+    Corpus corpus = {0};
+    for (int i = optind; i < argc; i++) {
+        load_path(&corpus, argv[i]);
+    }
+    if (corpus.count == 0) {
+        fprintf(stderr, "replay: no input lines\n");
+        return 1;
+    }
+
+    // Syntax errors are part of the corpus; their messages are not output
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd != -1) {
+        dup2(null_fd, STDERR_FILENO);
+        close(null_fd);
+    }
+
+    // One counted pass: allocations and errors per line
+    int errors = 0;
+    unsigned long max_allocs = 0;
+    int leaking_lines = 0;
+    const char *first_leak = NULL;
+    alloc_calls = free_calls = 0;
+    alloc_bytes = 0;
+    for (int i = 0; i < corpus.count; i++) {
+        unsigned long allocs_before = alloc_calls, frees_before = free_calls;
+        errors += parse_line(corpus.lines[i]) == -1;
+        unsigned long allocs = alloc_calls - allocs_before;
+        if (allocs > max_allocs) {
+            max_allocs = allocs;
+        }
+        if (allocs != free_calls - frees_before) {
+            if (leaking_lines++ == 0) {
+                first_leak = corpus.lines[i];
+            }
+        }
+    }
+    unsigned long total_allocs = alloc_calls;
+    size_t total_alloc_bytes = alloc_bytes;
+
+    // Timed rounds over the whole corpus, repeated to at least min_round_ns
+    long passes = 1;
+    for (;;) {
+        double start = now_ns();
+        for (long p = 0; p < passes; p++) {
+            for (int i = 0; i < corpus.count; i++) {
+                parse_line(corpus.lines[i]);
+            }
+        }
+        if (now_ns() - start >= min_round_ns || passes > (1L << 24)) {
+            break;
+        }
+        passes *= 2;
+    }
+    double *samples = malloc(rounds * sizeof(double));
+    if (!samples) {
+        perror("malloc");
+        return 1;
+    }
+    for (int r = 0; r < rounds; r++) {
+        double start = now_ns();
+        for (long p = 0; p < passes; p++) {
+            for (int i = 0; i < corpus.count; i++) {
+                parse_line(corpus.lines[i]);
+            }
+        }
+        samples[r] = (now_ns() - start) / passes;
+    }
+    qsort(samples, rounds, sizeof(double), compare_doubles);
+
+    if (saved_stderr != -1) {
+        dup2(saved_stderr, STDERR_FILENO);
+        close(saved_stderr);
+    }
+
+    double median = samples[rounds / 2];
+    printf("corpus:        %d lines, %zu bytes, %d rejected\n", corpus.count, corpus.bytes,
+           errors);
+    printf("time:          %.0f ns/pass (min %.0f, max %.0f, %d rounds x %ld passes)\n",
+           median, samples[0], samples[rounds - 1], rounds, passes);
+    printf("throughput:    %.2f ns/byte, %.1f ns/line, %.2f MB/s\n",
+           median / corpus.bytes, median / corpus.count, corpus.bytes / median * 1e3);
+    printf("allocations:   %.2f allocs/line (max %lu), %.0f bytes/line\n",
+           (double)total_allocs / corpus.count, max_allocs,
+           (double)total_alloc_bytes / corpus.count);
+    if (leaking_lines > 0) {
+        printf("leaks:         %d lines leak, first: %.60s\n", leaking_lines, first_leak);
+    } else {
+        printf("leaks:         none\n");
+    }
+
+    free(samples);
+    for (int i = 0; i < corpus.count; i++) {
+        free(corpus.lines[i]);
+    }
+    free(corpus.lines);
+    return leaking_lines > 0 ? 1 : 0;
+}
@@ -0,0 +1,406 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "iobatch.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// Operations submitted per io_uring_enter() call
+#define URING_ENTRIES 64
+#define NOT_RUN INT_MIN  // Result of an operation the ring never started
+
+// Minimal io_uring: one submission ring and one completion ring, mapped
+// once per process. Set up lazily and rebuilt after fork(), since a child
+// (e.g. a builtin in a pipeline) must not share the parent's ring.
+typedef struct {
+    int fd;
+    pid_t owner;               // Process that created the ring
+    unsigned int entries;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+} Uring;
+
+static Uring ring = { .fd = -1 };
+static int backend_chosen = 0;
+static IoBackend backend = IO_BACKEND_SYNC;
+
+// Prepare the SQE for operation i of a batch
+typedef void (*PrepFn)(struct io_uring_sqe *sqe, int i, void *ctx);
+
+static void uring_teardown(void) {
+    if (ring.sq_ptr && ring.sq_ptr != MAP_FAILED) {
+        munmap(ring.sq_ptr, ring.sq_len);
+    }
+    if (ring.cq_ptr && ring.cq_ptr != MAP_FAILED && ring.cq_ptr != ring.sq_ptr) {
+        munmap(ring.cq_ptr, ring.cq_len);
+    }
+    if (ring.sqes && (void *)ring.sqes != MAP_FAILED) {
+        munmap(ring.sqes, ring.sqes_len);
+    }
+    if (ring.fd != -1) {
+        close(ring.fd);
+    }
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+// Create and map the ring
+// Returns 0 on success, -1 if io_uring is not available
+static int uring_setup(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (fd == -1) {
+        return -1;
+    }
+    ring.fd = fd;
+    ring.owner = getpid();
+    ring.entries = params.sq_entries;
+
+    ring.sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring.cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring.cq_len > ring.sq_len) {
+            ring.sq_len = ring.cq_len;
+        }
+        ring.cq_len = ring.sq_len;
+    }
+
+    ring.sq_ptr = mmap(NULL, ring.sq_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ptr == MAP_FAILED) {
+        uring_teardown();
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.cq_ptr = ring.sq_ptr;
+    } else {
+        ring.cq_ptr = mmap(NULL, ring.cq_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring.cq_ptr == MAP_FAILED) {
+            uring_teardown();
+            return -1;
+        }
+    }
+
+    ring.sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        uring_teardown();
+        return -1;
+    }
+
+    char *sq = ring.sq_ptr;
+    char *cq = ring.cq_ptr;
+    ring.sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    ring.sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned int *)(sq + params.sq_off.array);
+    ring.cq_head = (unsigned int *)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    ring.cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+// Pick the default backend on first use
+static void choose_backend(void) {
+    if (backend_chosen) {
+        return;
+    }
+    const char *value = getenv("MYSHELL_IO_BACKEND");
+    iobatch_set_backend(value && strcmp(value, "uring") == 0 ? IO_BACKEND_URING
+                                                              : IO_BACKEND_SYNC);
+}
+
+// Select the backend
+void iobatch_set_backend(IoBackend requested) {
+    backend_chosen = 1;
+    backend = IO_BACKEND_SYNC;
+    if (requested == IO_BACKEND_URING && (ring.fd != -1 || uring_setup() == 0)) {
+        backend = IO_BACKEND_URING;
+    }
+}
+
+// Backend in use
+const char *iobatch_backend_name(void) {
+    choose_backend();
+    return backend == IO_BACKEND_URING ? "io_uring" : "sync";
+}
+
+// Returns 1 if batches should go through io_uring
+static int use_uring(void) {
+    choose_backend();
+    if (backend != IO_BACKEND_URING) {
+        return 0;
+    }
+    if (ring.owner != getpid()) {
+        // Forked: the mappings are shared with the parent - get our own ring
+        uring_teardown();
+        if (uring_setup() == -1) {
+            backend = IO_BACKEND_SYNC;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Move completions from the CQ into results
+// Returns the number reaped
+static int uring_reap(int *results) {
+    int reaped = 0;
+    unsigned int head = *ring.cq_head;
+    unsigned int cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    while (head != cq_tail) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        results[cqe->user_data] = cqe->res;
+        head++;
+        reaped++;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+// The ring failed with submitted - completed operations of the chunk at
+// first still in the kernel: wait for those, then drop the ring
+// One that never reports back gets -EIO rather than NOT_RUN, since it may
+// have taken effect and must not be run again
+static void uring_fail(int first, int submitted, int completed, int *results) {
+    while (completed < submitted) {
+        int ret = (int)syscall(__NR_io_uring_enter, ring.fd, 0, submitted - completed,
+                               IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret == -1 && errno != EINTR) {
+            break;
+        }
+        completed += uring_reap(results);
+    }
+    for (int i = first; i < first + submitted; i++) {
+        if (results[i] == NOT_RUN) {
+            results[i] = -EIO;
+        }
+    }
+    backend = IO_BACKEND_SYNC;  // Don't keep trying a broken ring
+    uring_teardown();           // Also drops the SQEs that were never submitted
+}
+
+// Run n operations through the ring, URING_ENTRIES at a time
+// results[i] receives the completion result of operation i; it must start
+// out as NOT_RUN
+// Returns 0 on success, -1 if the ring failed: operations it never
+// started are still NOT_RUN and are left to the caller
+static int uring_run(int n, PrepFn prep, void *ctx, int *results) {
+    for (int base = 0; base < n; base += (int)ring.entries) {
+        int count = n - base;
+        if (count > (int)ring.entries) {
+            count = (int)ring.entries;
+        }
+
+        // Queue the SQEs (the kernel owns the head; we own the tail)
+        unsigned int tail = *ring.sq_tail;
+        for (int i = 0; i < count; i++) {
+            unsigned int index = (tail + i) & *ring.sq_mask;
+            struct io_uring_sqe *sqe = &ring.sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            prep(sqe, base + i, ctx);
+            sqe->user_data = (unsigned long long)(base + i);
+            ring.sq_array[index] = index;
+        }
+        __atomic_store_n(ring.sq_tail, tail + count, __ATOMIC_RELEASE);
+
+        // Submit everything and wait for all completions in one call
+        // (a failed call submitted nothing: SQEs are consumed in order)
+        int submitted = 0;
+        int completed = 0;
+        while (completed < count) {
+            int to_submit = count - submitted;
+            int ret = (int)syscall(__NR_io_uring_enter, ring.fd, to_submit,
+                                   count - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (ret == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                uring_fail(base, submitted, completed, results);
+                return -1;
+            }
+            submitted += ret;
+            completed += uring_reap(results);
+        }
+    }
+    return 0;
+}
+
+// Run a batch through io_uring if it is in use
+// Returns 1 if every operation ran; otherwise the ones that did not are
+// NOT_RUN in results, for the caller to do with plain system calls
+static int run_batch(int n, PrepFn prep, void *ctx, int *results) {
+    for (int i = 0; i < n; i++) {
+        results[i] = NOT_RUN;
+    }
+    return use_uring() && uring_run(n, prep, ctx, results) == 0;
+}
+
+// Shared arguments of one batch
+typedef struct {
+    int dirfd;
+    char *const *paths;
+    int flags;
+    mode_t mode;
+    unsigned int mask;
+    struct statx *stx;
+    const int *fds;
+    void *const *bufs;
+    const size_t *lens;
+} BatchArgs;
+
+static void prep_openat(struct io_uring_sqe *sqe, int i, void *ctx) {
+    BatchArgs *args = ctx;
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = args->dirfd;
+    sqe->addr = (unsigned long long)(uintptr_t)args->paths[i];
+    sqe->len = args->mode;
+    sqe->open_flags = (unsigned int)args->flags;
+}
+
+// openat() each path
+void iobatch_openat(int dirfd, char *const *paths, int n, int flags, mode_t mode,
+                    int *results) {
+    flags |= O_CLOEXEC;
+    BatchArgs args = { .dirfd = dirfd, .paths = paths, .flags = flags, .mode = mode };
+    if (run_batch(n, prep_openat, &args, results)) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        if (results[i] != NOT_RUN) {
+            continue;  // Opened before the ring failed
+        }
+        int fd = openat(dirfd, paths[i], flags, mode);
+        results[i] = fd == -1 ? -errno : fd;
+    }
+}
+
+static void prep_close(struct io_uring_sqe *sqe, int i, void *ctx) {
+    BatchArgs *args = ctx;
+    if (args->fds[i] < 0) {
+        sqe->opcode = IORING_OP_NOP;
+        return;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = args->fds[i];
+}
+
+// close() each fd
+void iobatch_close(const int *fds, int n) {
+    BatchArgs args = { .fds = fds };
+    int *results = malloc(n * sizeof(int));
+    if (results && run_batch(n, prep_close, &args, results)) {
+        free(results);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        if (fds[i] >= 0 && (!results || results[i] == NOT_RUN)) {
+            close(fds[i]);
+        }
+    }
+    free(results);
+}
+
+static void prep_statx(struct io_uring_sqe *sqe, int i, void *ctx) {
+    BatchArgs *args = ctx;
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = args->dirfd;
+    sqe->addr = (unsigned long long)(uintptr_t)args->paths[i];
+    sqe->len = args->mask;
+    sqe->off = (unsigned long long)(uintptr_t)&args->stx[i];
+    sqe->statx_flags = (unsigned int)args->flags;
+}
+
+// statx() each path
+void iobatch_statx(int dirfd, char *const *paths, int n, int flags, unsigned int mask,
+                   struct statx *stx, int *results) {
+    BatchArgs args = { .dirfd = dirfd, .paths = paths, .flags = flags, .mask = mask,
+                       .stx = stx };
+    if (run_batch(n, prep_statx, &args, results)) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        if (results[i] != NOT_RUN) {
+            continue;
+        }
+        results[i] = statx(dirfd, paths[i], flags, mask, &stx[i]) == -1 ? -errno : 0;
+    }
+}
+
+static void prep_unlinkat(struct io_uring_sqe *sqe, int i, void *ctx) {
+    BatchArgs *args = ctx;
+    sqe->opcode = IORING_OP_UNLINKAT;
+    sqe->fd = args->dirfd;
+    sqe->addr = (unsigned long long)(uintptr_t)args->paths[i];
+    sqe->unlink_flags = (unsigned int)args->flags;
+}
+
+// unlinkat() each path
+void iobatch_unlinkat(int dirfd, char *const *paths, int n, int flags, int *results) {
+    BatchArgs args = { .dirfd = dirfd, .paths = paths, .flags = flags };
+    if (run_batch(n, prep_unlinkat, &args, results)) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        if (results[i] != NOT_RUN) {
+            continue;  // Unlinked before the ring failed: don't report ENOENT
+        }
+        results[i] = unlinkat(dirfd, paths[i], flags) == -1 ? -errno : 0;
+    }
+}
+
+static void prep_read(struct io_uring_sqe *sqe, int i, void *ctx) {
+    BatchArgs *args = ctx;
+    if (args->fds[i] < 0) {
+        sqe->opcode = IORING_OP_NOP;
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = args->fds[i];
+    sqe->addr = (unsigned long long)(uintptr_t)args->bufs[i];
+    sqe->len = (unsigned int)args->lens[i];
+    sqe->off = (unsigned long long)-1;  // Current file position
+}
+
+// read() from each fd
+void iobatch_read(const int *fds, void *const *bufs, const size_t *lens, int n,
+                  ssize_t *results) {
+    BatchArgs args = { .fds = fds, .bufs = bufs, .lens = lens };
+    int *res = malloc(n * sizeof(int));
+    if (res) {
+        run_batch(n, prep_read, &args, res);  // Whatever did not run is read below
+    }
+    for (int i = 0; i < n; i++) {
+        if (res && res[i] != NOT_RUN) {
+            results[i] = res[i];
+            continue;
+        }
+        if (fds[i] < 0) {
+            results[i] = 0;
+            continue;
+        }
+        ssize_t bytes = read(fds[i], bufs[i], lens[i]);
+        results[i] = bytes == -1 ? -errno : bytes;
+    }
+    free(res);
+}
@@ -0,0 +1,48 @@
+#ifndef IOBATCH_H
+#define IOBATCH_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+// Batched file operations for the file builtins (cat, ls, rm, touch)
+// Each call performs n independent operations. With the io_uring backend
+// they are submitted together and complete with one or two system calls;
+// the sync backend issues one blocking call per operation.
+// Results follow the io_uring convention: >= 0 on success, -errno on error.
+
+typedef enum {
+    IO_BACKEND_SYNC,       // Plain blocking system calls
+    IO_BACKEND_URING       // io_uring (raw system calls, no liburing)
+} IoBackend;
+
+// Select the backend; io_uring silently falls back to sync when the kernel
+// does not support it. The default comes from MYSHELL_IO_BACKEND
+// ("sync" or "uring"), else sync: path-based operations (openat, statx,
+// unlinkat) are punted to kernel worker threads, which costs more than the
+// saved system calls on a local filesystem
+void iobatch_set_backend(IoBackend backend);
+
+// Backend in use ("sync" or "io_uring")
+const char *iobatch_backend_name(void);
+
+// openat() each path; results[i] is the new fd (close-on-exec) or -errno
+void iobatch_openat(int dirfd, char *const *paths, int n, int flags, mode_t mode,
+                    int *results);
+
+// close() each fd (fds < 0 are skipped)
+void iobatch_close(const int *fds, int n);
+
+// statx() each path; results[i] is 0 or -errno
+void iobatch_statx(int dirfd, char *const *paths, int n, int flags, unsigned int mask,
+                   struct statx *stx, int *results);
+
+// unlinkat() each path; results[i] is 0 or -errno
+void iobatch_unlinkat(int dirfd, char *const *paths, int n, int flags, int *results);
+
+// read() from each fd at its current position; results[i] is the byte count
+// or -errno
+void iobatch_read(const int *fds, void *const *bufs, const size_t *lens, int n,
+                  ssize_t *results);
+
+#endif // IOBATCH_H
@@ -0,0 +1,150 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "jobqueue.h"
+#include "memacct.h"
+#include "jobs.h"
+#include "executor.h"
+#include "utils.h"
+
+// Queue entry - ordered by priority (high first), then submission order
+typedef struct {
+    int priority;
+    unsigned long seq;
+    int job_id;
+} QueueEntry;
+
+// Binary max-heap of queued jobs
+static QueueEntry *heap = NULL;
+static int heap_len = 0;
+static int heap_capacity = 0;
+static unsigned long next_seq = 0;
+static int limit = 0;            // 0 = number of online CPUs
+static int dispatching = 0;
+
+// Returns 1 if a should start before b
+static int entry_before(const QueueEntry *a, const QueueEntry *b) {
+    if (a->priority != b->priority) {
+        return a->priority > b->priority;
+    }
+    return a->seq < b->seq;
+}
+
+static void swap_entries(int i, int j) {
+    QueueEntry tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+// Initialize the job queue
+void init_jobqueue(void) {
+    mem_free(MEM_JOBS, heap);
+    heap = NULL;
+    heap_len = 0;
+    heap_capacity = 0;
+    next_seq = 0;
+    limit = 0;
+}
+
+// Set the concurrency limit
+void jobqueue_set_limit(int new_limit) {
+    limit = new_limit > 0 ? new_limit : 0;
+    jobqueue_dispatch();  // A higher limit may allow more jobs to start
+}
+
+// Get the concurrency limit
+int jobqueue_get_limit(void) {
+    if (limit > 0) {
+        return limit;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+// Queue a job
+int jobqueue_push(int job_id, int priority) {
+    if (heap_len == heap_capacity) {
+        int new_capacity = heap_capacity ? heap_capacity * 2 : 64;
+        QueueEntry *new_heap = mem_realloc(MEM_JOBS, heap, new_capacity * sizeof(QueueEntry));
+        if (!new_heap) {
+            perror("realloc");
+            return -1;
+        }
+        heap = new_heap;
+        heap_capacity = new_capacity;
+    }
+
+    int i = heap_len++;
+    heap[i].priority = priority;
+    heap[i].seq = next_seq++;
+    heap[i].job_id = job_id;
+
+    // Sift up
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!entry_before(&heap[i], &heap[parent])) {
+            break;
+        }
+        swap_entries(i, parent);
+        i = parent;
+    }
+
+    return 0;
+}
+
+// Remove and return the job ID at the front of the queue
+static int heap_pop(void) {
+    int job_id = heap[0].job_id;
+    heap[0] = heap[--heap_len];
+
+    // Sift down
+    int i = 0;
+    for (;;) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int best = i;
+        if (left < heap_len && entry_before(&heap[left], &heap[best])) {
+            best = left;
+        }
+        if (right < heap_len && entry_before(&heap[right], &heap[best])) {
+            best = right;
+        }
+        if (best == i) {
+            break;
+        }
+        swap_entries(i, best);
+        i = best;
+    }
+
+    return job_id;
+}
+
+// Number of jobs waiting in the queue
+int jobqueue_length(void) {
+    return count_jobs(JOB_QUEUED);
+}
+
+// Start queued jobs while fewer than the limit are running
+void jobqueue_dispatch(void) {
+    if (heap_len == 0 || dispatching) {
+        return;
+    }
+    dispatching = 1;
+
+    int running = count_jobs(JOB_RUNNING);
+    int max_running = jobqueue_get_limit();
+
+    while (heap_len > 0 && running < max_running) {
+        // Entries of jobs that were removed or started meanwhile are skipped
+        Job *job = find_job(heap_pop());
+        if (!job || job->status != JOB_QUEUED) {
+            continue;
+        }
+        if (start_queued_job(job) == 0) {
+            running++;
+        }
+    }
+
+    dispatching = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+// Job queue: jobs submitted with the "batch" prefix sit in the job table
+// as JOB_QUEUED and are started, highest priority first and FIFO within
+// a priority, whenever fewer than the limit of jobs are running
+
+// Initialize the job queue (limit defaults to the number of online CPUs)
+void init_jobqueue(void);
+
+// Set the concurrency limit (0 = number of online CPUs)
+void jobqueue_set_limit(int limit);
+
+// Get the concurrency limit
+int jobqueue_get_limit(void);
+
+// Queue a job that is already in the table with status JOB_QUEUED
+// Returns 0 on success, -1 on error
+int jobqueue_push(int job_id, int priority);
+
+// Number of jobs waiting in the queue
+int jobqueue_length(void);
+
+// Start queued jobs while fewer than the limit are running
+// Called from the SIGCHLD/event-loop path after children are reaped
+void jobqueue_dispatch(void);
+
+#endif // JOBQUEUE_H
@@ -1,150 +1,659 @@
-// Feature test macros must be defined before any includes
-#define _POSIX_C_SOURCE 200809L
-#define _GNU_SOURCE
-
-#include "jobs.h"
-#include "utils.h"
-#include <stdlib.h>
-#include <string.h>
-
-// Job table
-static Job job_table[MAX_JOBS];
-static int next_job_id = 1;
-static int num_jobs = 0;
-
-// Initialize job table
-void init_jobs(void) {
-    for (int i = 0; i < MAX_JOBS; i++) {
-        job_table[i].job_id = 0;
-        job_table[i].pgid = 0;
-        job_table[i].command = NULL;
-        job_table[i].status = JOB_DONE;
-    }
-    next_job_id = 1;
-    num_jobs = 0;
-}
-
-// Add a new job to the table
-int add_job(pid_t pgid, const char *command, JobStatus status) {
-    if (num_jobs >= MAX_JOBS) {
-        return -1;  // Table full
-    }
-
-    // Find empty slot
-    int slot = -1;
-    for (int i = 0; i < MAX_JOBS; i++) {
-        if (job_table[i].job_id == 0) {
-            slot = i;
-            break;
-        }
-    }
-
-    if (slot == -1) {
-        return -1;  // No empty slot
-    }
-
-    job_table[slot].job_id = next_job_id++;
-    job_table[slot].pgid = pgid;
-    job_table[slot].command = strdup(command);
-    if (!job_table[slot].command) {
-        perror("strdup");
-        return -1;
-    }
-    job_table[slot].status = status;
-    num_jobs++;
-
-    return job_table[slot].job_id;
-}
-
-// Remove a job from the table
-void remove_job(int job_id) {
-    for (int i = 0; i < MAX_JOBS; i++) {
-        if (job_table[i].job_id == job_id) {
-            free(job_table[i].command);
-            job_table[i].job_id = 0;
-            job_table[i].pgid = 0;
-            job_table[i].command = NULL;
-            job_table[i].status = JOB_DONE;
-            num_jobs--;
-            return;
-        }
-    }
-}
-
-// Find job by job ID
-Job *find_job(int job_id) {
-    for (int i = 0; i < MAX_JOBS; i++) {
-        if (job_table[i].job_id == job_id) {
-            return &job_table[i];
-        }
-    }
-    return NULL;
-}
-
-// Find job by process group ID
-Job *find_job_by_pgid(pid_t pgid) {
-    for (int i = 0; i < MAX_JOBS; i++) {
-        if (job_table[i].job_id != 0 && job_table[i].pgid == pgid) {
-            return &job_table[i];
-        }
-    }
-    return NULL;
-}
-
-// Update job status
-void update_job_status(int job_id, JobStatus status) {
-    Job *job = find_job(job_id);
-    if (job) {
-        job->status = status;
-    }
-}
-
-// Update job status by process group ID
-void update_job_status_by_pgid(pid_t pgid, JobStatus status) {
-    Job *job = find_job_by_pgid(pgid);
-    if (job) {
-        job->status = status;
-    }
-}
-
-// Get all jobs (for jobs command)
-int get_all_jobs(Job *jobs, int max_jobs) {
-    int count = 0;
-    for (int i = 0; i < MAX_JOBS && count < max_jobs; i++) {
-        if (job_table[i].job_id != 0 && 
-            job_table[i].status != JOB_DONE) {
-            jobs[count] = job_table[i];
-            // Don't duplicate command string, just copy pointer
-            // Caller should not free it
-            count++;
-        }
-    }
-    return count;
-}
-
-// Get next available job ID
-int get_next_job_id(void) {
-    return next_job_id;
-}
-
-// Clean up finished jobs
-void cleanup_jobs(void) {
-    for (int i = 0; i < MAX_JOBS; i++) {
-        if (job_table[i].job_id != 0 && job_table[i].status == JOB_DONE) {
-            free(job_table[i].command);
-            job_table[i].job_id = 0;
-            job_table[i].pgid = 0;
-            job_table[i].command = NULL;
-            num_jobs--;
-        }
-    }
-}
-
-// Free job resources
-void free_job(Job *job) {
-    if (job && job->command) {
-        free(job->command);
-        job->command = NULL;
-    }
-}
-
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "jobs.h"
+#include "memacct.h"
+#include "capture.h"
+#include "cgroup.h"
+#include "timeout.h"
+#include "perfstat.h"
+#include "linebuf.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Hash index from an integer key (job ID, pgid or pid) to a job
+// Open addressing with linear probing; job == NULL marks an empty slot
+typedef struct {
+    int key;
+    Job *job;
+} IndexSlot;
+
+typedef struct {
+    IndexSlot *slots;
+    int capacity;          // Power of two (0 until first insert)
+    int count;
+} JobIndex;
+
+// Job table - grows on demand up to MAX_JOBS slots
+// Jobs are allocated individually so Job pointers stay valid while it grows
+static Job **job_table = NULL;
+static int table_size = 0;
+static int next_job_id = 1;
+static int num_jobs = 0;
+static int free_hint = 0;          // No free slot below this index
+
+// Lookups by job ID, process group and process never scan the table
+static JobIndex by_id;
+static JobIndex by_pgid;
+static JobIndex by_pid;
+
+// Number of jobs in each state (count_jobs() is on the dispatch path)
+static int status_counts[JOB_DONE + 1];
+
+// Jobs ordered by recency for %+ / %- (most recently started in the
+// background or stopped first)
+static Job *most_recent = NULL;
+
+// Foreground job being waited for (not part of the table)
+static Job *foreground_job = NULL;
+
+static unsigned int hash_key(int key) {
+    return (unsigned int)key * 2654435761u;  // Knuth's multiplicative hash
+}
+
+static Job *index_get(const JobIndex *index, int key) {
+    if (index->capacity == 0) {
+        return NULL;
+    }
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    for (unsigned int i = hash_key(key) & mask; index->slots[i].job; i = (i + 1) & mask) {
+        if (index->slots[i].key == key) {
+            return index->slots[i].job;
+        }
+    }
+    return NULL;
+}
+
+// Map key to job (replacing an existing mapping)
+// Returns 0 on success, -1 on allocation failure
+static int index_put(JobIndex *index, int key, Job *job) {
+    if ((index->count + 1) * 4 > index->capacity * 3) {
+        int new_capacity = index->capacity ? index->capacity * 2 : 64;
+        IndexSlot *slots = mem_calloc(MEM_JOBS, new_capacity, sizeof(IndexSlot));
+        if (!slots) {
+            perror("calloc");
+            return -1;
+        }
+        IndexSlot *old = index->slots;
+        int old_capacity = index->capacity;
+        index->slots = slots;
+        index->capacity = new_capacity;
+        index->count = 0;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old[i].job) {
+                index_put(index, old[i].key, old[i].job);
+            }
+        }
+        mem_free(MEM_JOBS, old);
+    }
+
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int i = hash_key(key) & mask;
+    while (index->slots[i].job && index->slots[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    if (!index->slots[i].job) {
+        index->count++;
+    }
+    index->slots[i].key = key;
+    index->slots[i].job = job;
+    return 0;
+}
+
+// Remove key if it maps to job (a reused pid may belong to a newer job)
+static void index_remove(JobIndex *index, int key, const Job *job) {
+    if (index->capacity == 0) {
+        return;
+    }
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int i = hash_key(key) & mask;
+    while (index->slots[i].job && index->slots[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    if (index->slots[i].job != job || job == NULL) {
+        return;
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    index->slots[i].job = NULL;
+    index->count--;
+    unsigned int hole = i;
+    for (unsigned int j = (i + 1) & mask; index->slots[j].job; j = (j + 1) & mask) {
+        unsigned int home = hash_key(index->slots[j].key) & mask;
+        // Move the entry back if the hole lies between its home and j
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            index->slots[hole] = index->slots[j];
+            index->slots[j].job = NULL;
+            hole = j;
+        }
+    }
+}
+
+static void index_clear(JobIndex *index) {
+    mem_free(MEM_JOBS, index->slots);
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+// Unlink a job from the recency list
+static void recency_unlink(Job *job) {
+    if (job->newer) {
+        job->newer->older = job->older;
+    } else if (most_recent == job) {
+        most_recent = job->older;
+    }
+    if (job->older) {
+        job->older->newer = job->newer;
+    }
+    job->newer = NULL;
+    job->older = NULL;
+}
+
+// Make a job the current job (%+)
+static void recency_touch(Job *job) {
+    if (most_recent == job) {
+        return;
+    }
+    recency_unlink(job);
+    job->older = most_recent;
+    if (most_recent) {
+        most_recent->newer = job;
+    }
+    most_recent = job;
+}
+
+// Initialize job table
+void init_jobs(void) {
+    for (int i = 0; i < table_size; i++) {
+        if (job_table[i]) {
+            free_job(job_table[i]);
+            mem_free(MEM_JOBS, job_table[i]);
+        }
+    }
+    mem_free(MEM_JOBS, job_table);
+    job_table = NULL;
+    table_size = 0;
+    next_job_id = 1;
+    num_jobs = 0;
+    free_hint = 0;
+    index_clear(&by_id);
+    index_clear(&by_pgid);
+    index_clear(&by_pid);
+    memset(status_counts, 0, sizeof(status_counts));
+    most_recent = NULL;
+}
+
+// Find an empty slot, growing the table if needed
+// Returns slot index, or -1 if the table is full
+static int find_free_slot(void) {
+    for (int i = free_hint; i < table_size; i++) {
+        if (job_table[i] == NULL) {
+            free_hint = i + 1;
+            return i;
+        }
+    }
+
+    if (table_size >= MAX_JOBS) {
+        return -1;
+    }
+
+    int new_size = table_size ? table_size * 2 : 16;
+    if (new_size > MAX_JOBS) {
+        new_size = MAX_JOBS;
+    }
+    Job **new_table = mem_realloc(MEM_JOBS, job_table, new_size * sizeof(Job *));
+    if (!new_table) {
+        perror("realloc");
+        return -1;
+    }
+    for (int i = table_size; i < new_size; i++) {
+        new_table[i] = NULL;
+    }
+    job_table = new_table;
+
+    int slot = table_size;
+    table_size = new_size;
+    free_hint = slot + 1;
+    return slot;
+}
+
+// Add a new job to the table
+int add_job(pid_t pgid, const char *command, JobStatus status) {
+    if (num_jobs >= MAX_JOBS) {
+        return -1;  // Table full
+    }
+
+    int slot = find_free_slot();
+    if (slot == -1) {
+        return -1;  // No empty slot
+    }
+
+    Job *job = mem_calloc(MEM_JOBS, 1, sizeof(Job));
+    if (!job) {
+        perror("calloc");
+        return -1;
+    }
+    job->command = mem_strdup(MEM_JOBS, command);
+    if (!job->command) {
+        perror("strdup");
+        mem_free(MEM_JOBS, job);
+        return -1;
+    }
+    job->job_id = next_job_id;
+    job->status = status;
+    job->slot = slot;
+    if (index_put(&by_id, job->job_id, job) == -1) {
+        mem_free(MEM_JOBS, job->command);
+        mem_free(MEM_JOBS, job);
+        return -1;
+    }
+    next_job_id++;
+    job_table[slot] = job;
+    num_jobs++;
+    status_counts[status]++;
+    set_job_pgid(job, pgid);
+    recency_touch(job);
+
+    return job->job_id;
+}
+
+// Set the process group of a job once it has been launched
+void set_job_pgid(Job *job, pid_t pgid) {
+    if (job->job_id > 0 && job->pgid > 0) {
+        index_remove(&by_pgid, job->pgid, job);
+    }
+    job->pgid = pgid;
+    if (job->job_id > 0 && pgid > 0) {
+        index_put(&by_pgid, pgid, job);
+    }
+}
+
+// Change the state of a job
+void set_job_status(Job *job, JobStatus status) {
+    if (job->job_id > 0) {
+        // Only table jobs are counted (not the foreground job)
+        status_counts[job->status]--;
+        status_counts[status]++;
+        if (status == JOB_STOPPED && job->status != JOB_STOPPED) {
+            recency_touch(job);
+        }
+    }
+    job->status = status;
+}
+
+// Record a process as part of a job
+int add_job_process(int job_id, pid_t pid) {
+    Job *job = find_job(job_id);
+    if (!job) {
+        return -1;
+    }
+
+    pid_t *pids = mem_realloc(MEM_JOBS, job->pids, (job->num_procs + 1) * sizeof(pid_t));
+    if (!pids) {
+        perror("realloc");
+        return -1;
+    }
+    pids[job->num_procs] = pid;
+    job->pids = pids;
+    job->num_procs++;
+    job->live_procs++;
+    index_put(&by_pid, pid, job);
+
+    return 0;
+}
+
+// Take a job out of the table and its indexes
+static void unlink_job(Job *job) {
+    index_remove(&by_id, job->job_id, job);
+    if (job->pgid > 0) {
+        index_remove(&by_pgid, job->pgid, job);
+    }
+    for (int i = 0; i < job->num_procs; i++) {
+        index_remove(&by_pid, job->pids[i], job);
+    }
+    recency_unlink(job);
+    status_counts[job->status]--;
+
+    job_table[job->slot] = NULL;
+    if (job->slot < free_hint) {
+        free_hint = job->slot;
+    }
+    num_jobs--;
+}
+
+// Take a job out of the table and its indexes, then free it
+static void delete_job(Job *job) {
+    unlink_job(job);
+    free_job(job);
+    mem_free(MEM_JOBS, job);
+}
+
+// Remove a job from the table
+void remove_job(int job_id) {
+    Job *job = find_job(job_id);
+    if (job) {
+        delete_job(job);
+    }
+}
+
+// Drop a disowned job from the table without touching its processes' I/O
+void detach_job(int job_id) {
+    Job *job = find_job(job_id);
+    if (!job) {
+        return;
+    }
+    unlink_job(job);
+
+    // Hand the job's pipes and cgroup over instead of closing them: the
+    // capture keeps draining, and the coprocess pipes and NAME_* variables
+    // stay for as long as the shell runs
+    capture_detach(job->output);
+    job->output = NULL;
+    cgroup_detach(job->cgroup);
+    job->cgroup = NULL;
+    job->coproc_in = 0;
+    job->coproc_out = 0;
+
+    // The deadline goes with the job: once the shell stops reaping it, the
+    // process group could be reused before the timer fires
+    free_job(job);
+    mem_free(MEM_JOBS, job);
+}
+
+// Find job by job ID
+Job *find_job(int job_id) {
+    return index_get(&by_id, job_id);
+}
+
+// Find job by process group ID
+Job *find_job_by_pgid(pid_t pgid) {
+    return index_get(&by_pgid, pgid);
+}
+
+// Find job containing the given process ID
+Job *find_job_by_pid(pid_t pid) {
+    if (foreground_job) {
+        for (int j = 0; j < foreground_job->num_procs; j++) {
+            if (foreground_job->pids[j] == pid) {
+                return foreground_job;
+            }
+        }
+    }
+    return index_get(&by_pid, pid);
+}
+
+// Resolve a job specification
+Job *find_job_by_spec(const char *spec, const char **error) {
+    *error = "no such job";
+
+    // Bare numbers are job IDs (fg 2 / bg 2)
+    if (spec[0] != '%') {
+        char *end;
+        long job_id = strtol(spec, &end, 10);
+        return (*end == '\0' && job_id > 0 && job_id <= INT_MAX) ? find_job((int)job_id) : NULL;
+    }
+
+    const char *rest = spec + 1;
+    if (*rest == '\0' || strcmp(rest, "%") == 0 || strcmp(rest, "+") == 0) {
+        return most_recent;
+    }
+    if (strcmp(rest, "-") == 0) {
+        return most_recent ? most_recent->older : NULL;
+    }
+    if (*rest >= '0' && *rest <= '9') {
+        char *end;
+        long job_id = strtol(rest, &end, 10);
+        return (*end == '\0' && job_id > 0 && job_id <= INT_MAX) ? find_job((int)job_id) : NULL;
+    }
+
+    // %string (command prefix) and %?string (substring) match commands;
+    // the match must be unique
+    int substring = (*rest == '?');
+    if (substring) {
+        rest++;
+    }
+    size_t len = strlen(rest);
+    Job *match = NULL;
+    for (Job *job = most_recent; job; job = job->older) {
+        int matches = substring ? strstr(job->command, rest) != NULL
+                                : strncmp(job->command, rest, len) == 0;
+        if (matches) {
+            if (match) {
+                *error = "ambiguous job spec";
+                return NULL;
+            }
+            match = job;
+        }
+    }
+    return match;
+}
+
+// Update job status
+void update_job_status(int job_id, JobStatus status) {
+    Job *job = find_job(job_id);
+    if (job) {
+        set_job_status(job, status);
+    }
+}
+
+// Update job status by process group ID
+void update_job_status_by_pgid(pid_t pgid, JobStatus status) {
+    Job *job = find_job_by_pgid(pgid);
+    if (job) {
+        set_job_status(job, status);
+    }
+}
+
+// Find the running coprocess with the given name
+Job *find_coproc(const char *name) {
+    for (int i = 0; i < table_size; i++) {
+        if (job_table[i] && job_table[i]->coproc_name &&
+            job_table[i]->status != JOB_DONE &&
+            strcmp(job_table[i]->coproc_name, name) == 0) {
+            return job_table[i];
+        }
+    }
+    return NULL;
+}
+
+// Close a coprocess's pipes and remove its NAME_IN/NAME_OUT/NAME_PID variables
+// all = 0 only closes the write side: output it produced before exiting
+// stays readable until the job is removed
+static void close_coproc(Job *job, int all) {
+    if (!job->coproc_name) {
+        return;
+    }
+
+    char var[96];
+    if (job->coproc_in > 0) {
+        close(job->coproc_in);
+        job->coproc_in = 0;
+        snprintf(var, sizeof(var), "%s_IN", job->coproc_name);
+        unsetenv(var);
+        snprintf(var, sizeof(var), "%s_PID", job->coproc_name);
+        unsetenv(var);
+    }
+    if (all && job->coproc_out > 0) {
+        linebuf_release(job->coproc_out);
+        close(job->coproc_out);
+        job->coproc_out = 0;
+        // A newer coprocess may have reused the name
+        if (!find_coproc(job->coproc_name)) {
+            snprintf(var, sizeof(var), "%s_OUT", job->coproc_name);
+            unsetenv(var);
+        }
+    }
+}
+
+// Record a wait status reported by waitpid() for a job process
+Job *mark_process_status(pid_t pid, int status) {
+    Job *job = find_job_by_pid(pid);
+    if (!job) {
+        return NULL;
+    }
+
+    if (WIFSTOPPED(status)) {
+        set_job_status(job, JOB_STOPPED);
+        return job;
+    }
+
+    if (!WIFEXITED(status) && !WIFSIGNALED(status)) {
+        return job;  // Continued - nothing to record
+    }
+
+    // The job's status is the status of the last process in the pipeline
+    if (pid == job->pids[job->num_procs - 1]) {
+        if (WIFEXITED(status)) {
+            job->exit_status = WEXITSTATUS(status);
+        } else {
+            job->exit_status = 128 + WTERMSIG(status);
+        }
+    }
+
+    if (job->live_procs > 0) {
+        job->live_procs--;
+    }
+    if (job->live_procs == 0) {
+        set_job_status(job, JOB_DONE);
+        job_timeout_stop(job);
+        close_coproc(job, 0);
+        if (job->timed_out) {
+            job->exit_status = TIMEOUT_STATUS;
+        }
+    }
+
+    return job;
+}
+
+// Find the first job with the given status
+Job *find_job_by_status(JobStatus status) {
+    if (status_counts[status] == 0) {
+        return NULL;
+    }
+    for (int i = 0; i < table_size; i++) {
+        if (job_table[i] && job_table[i]->status == status) {
+            return job_table[i];
+        }
+    }
+    return NULL;
+}
+
+// Find a finished job whose status has not been collected by wait
+Job *find_finished_job(void) {
+    if (status_counts[JOB_DONE] == 0) {
+        return NULL;
+    }
+    for (int i = 0; i < table_size; i++) {
+        if (job_table[i] && job_table[i]->status == JOB_DONE &&
+            !job_table[i]->waited) {
+            return job_table[i];
+        }
+    }
+    return NULL;
+}
+
+// Track a foreground job that is not in the table
+void set_foreground_job(Job *job) {
+    foreground_job = job;
+}
+
+// Jobs with captured output stay around until the log has been read
+static int job_is_disposable(const Job *job) {
+    return !job->output || capture_was_read(job->output);
+}
+
+// Drop a finished job once wait has collected its status
+void release_job(Job *job) {
+    job->waited = 1;
+    if (job_is_disposable(job)) {
+        remove_job(job->job_id);
+    }
+}
+
+// Count jobs with the given status
+int count_jobs(JobStatus status) {
+    return status_counts[status];
+}
+
+// Get all jobs (for jobs command)
+int get_all_jobs(Job *jobs, int max_jobs) {
+    int count = 0;
+    for (int i = 0; i < table_size && count < max_jobs; i++) {
+        if (job_table[i]) {
+            jobs[count] = *job_table[i];
+            // Don't duplicate command string, just copy pointer
+            // Caller should not free it
+            count++;
+        }
+    }
+    return count;
+}
+
+// Get number of jobs in the table
+int get_job_count(void) {
+    return num_jobs;
+}
+
+// Get next available job ID
+int get_next_job_id(void) {
+    return next_job_id;
+}
+
+// Clean up finished jobs
+void cleanup_jobs(void) {
+    // Runs before every prompt - skip the scan when nothing has finished
+    if (status_counts[JOB_DONE] == 0) {
+        return;
+    }
+    for (int i = 0; i < table_size; i++) {
+        if (job_table[i] && job_table[i]->status == JOB_DONE &&
+            job_is_disposable(job_table[i])) {
+            delete_job(job_table[i]);
+        }
+    }
+}
+
+// Send a signal to every process in a job
+int signal_job(Job *job, int sig) {
+    if (job->pgid <= 0) {
+        errno = ESRCH;  // Not started - kill(0) would hit the shell
+        return -1;
+    }
+    if (sig == SIGKILL && job->cgroup && cgroup_kill(job->cgroup) == 0) {
+        return 0;
+    }
+    return kill(-job->pgid, sig);
+}
+
+// Free job resources
+void free_job(Job *job) {
+    if (!job) {
+        return;
+    }
+    mem_free(MEM_JOBS, job->command);
+    job->command = NULL;
+    mem_free(MEM_JOBS, job->pids);
+    job->pids = NULL;
+    job->num_procs = 0;
+    job->live_procs = 0;
+    capture_free(job->output);
+    job->output = NULL;
+    cgroup_free(job->cgroup);
+    job->cgroup = NULL;
+    perfstat_free(job->perf);
+    job->perf = NULL;
+    job_timeout_stop(job);
+    close_coproc(job, 1);
+    mem_free(MEM_JOBS, job->coproc_name);
+    job->coproc_name = NULL;
+    if (job->pending) {
+        free_pipeline(job->pending);
+        mem_free(MEM_JOBS, job->pending);
+        job->pending = NULL;
+    }
+}
+
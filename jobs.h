@@ -1,59 +1,144 @@
-#ifndef JOBS_H
-#define JOBS_H
-
-#include <sys/types.h>
-
-// Job status enumeration
-typedef enum {
-    JOB_RUNNING,
-    JOB_STOPPED,
-    JOB_DONE
-} JobStatus;
-
-// Job structure to track background/stopped processes
-typedef struct {
-    int job_id;            // Job number (1, 2, 3, ...)
-    pid_t pgid;            // Process group ID
-    char *command;         // Original command string
-    JobStatus status;      // Current status
-} Job;
-
-// Initialize job table
-void init_jobs(void);
-
-// Add a new job to the table
-// Returns job ID, or -1 on error
-int add_job(pid_t pgid, const char *command, JobStatus status);
-
-// Remove a job from the table
-void remove_job(int job_id);
-
-// Find job by job ID
-// Returns pointer to job, or NULL if not found
-Job *find_job(int job_id);
-
-// Find job by process group ID
-// Returns pointer to job, or NULL if not found
-Job *find_job_by_pgid(pid_t pgid);
-
-// Update job status
-void update_job_status(int job_id, JobStatus status);
-
-// Update job status by process group ID
-void update_job_status_by_pgid(pid_t pgid, JobStatus status);
-
-// Get all jobs (for jobs command)
-// Returns number of jobs, fills jobs array (max MAX_JOBS)
-int get_all_jobs(Job *jobs, int max_jobs);
-
-// Get next available job ID
-int get_next_job_id(void);
-
-// Clean up finished jobs
-void cleanup_jobs(void);
-
-// Free job resources
-void free_job(Job *job);
-
-#endif // JOBS_H
-
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <sys/types.h>
+#include "launch.h"
+
+struct JobOutput;
+struct JobCgroup;
+
+// Job status enumeration
+typedef enum {
+    JOB_QUEUED,            // Waiting in the job queue (see jobqueue.h)
+    JOB_RUNNING,
+    JOB_STOPPED,
+    JOB_DONE
+} JobStatus;
+
+// Job structure to track background/stopped processes
+typedef struct Job {
+    int job_id;            // Job number (1, 2, 3, ...)
+    pid_t pgid;            // Process group ID
+    char *command;         // Original command string
+    JobStatus status;      // Current status
+    pid_t *pids;           // Process IDs in the job (pipeline order)
+    int num_procs;         // Number of processes in the job
+    int live_procs;        // Processes not yet reaped
+    int exit_status;       // Exit status of the last process (valid when done)
+    int waited;            // Exit status has been collected by wait
+    struct JobOutput *output;  // Captured stdout/stderr, or NULL
+    struct JobCgroup *cgroup;  // Job's own cgroup, or NULL
+    int timer_fd;          // Deadline timerfd ("timeout" prefix), 0 if none
+    int timed_out;         // The deadline expired and the job was signalled
+    char *coproc_name;     // Coprocess name ("coproc NAME"), or NULL
+    int coproc_in;         // Shell's end of the coprocess stdin, 0 if closed
+    int coproc_out;        // Shell's end of the coprocess stdout, 0 if closed
+    struct PerfStat *perf; // Performance counters ("perfstat"), NULL if none
+    int slot;              // Index in the job table (jobs.c internal)
+    struct Job *newer;     // Recency list for %+ / %- (jobs.c internal)
+    struct Job *older;
+    Pipeline *pending;     // Pipeline to start when dequeued (JOB_QUEUED only)
+    LaunchOptions launch;  // Options the job was submitted with
+} Job;
+
+// Initialize job table
+void init_jobs(void);
+
+// Add a new job to the table
+// Returns job ID, or -1 on error
+int add_job(pid_t pgid, const char *command, JobStatus status);
+
+// Record a process as part of a job
+// Returns 0 on success, -1 on error
+int add_job_process(int job_id, pid_t pid);
+
+// Set the process group of a job once it has been launched
+void set_job_pgid(Job *job, pid_t pgid);
+
+// Change the state of a job (keeps per-state counts and %+ up to date)
+void set_job_status(Job *job, JobStatus status);
+
+// Remove a job from the table
+void remove_job(int job_id);
+
+// Remove a job from the table but leave its processes alone (disown):
+// captured output keeps being drained, coprocess pipes stay open and the
+// job's cgroup stays in place
+void detach_job(int job_id);
+
+// Find job by job ID
+// Returns pointer to job, or NULL if not found
+Job *find_job(int job_id);
+
+// Find job by process group ID
+// Returns pointer to job, or NULL if not found
+Job *find_job_by_pgid(pid_t pgid);
+
+// Find job containing the given process ID
+// Returns pointer to job, or NULL if not found
+Job *find_job_by_pid(pid_t pid);
+
+// Resolve a job specification: %N, %+ / %% / % (current job), %- (previous
+// job), %string (command starts with string), %?string (command contains
+// string), or a bare job number
+// Returns the job, or NULL with *error set ("no such job", "ambiguous job spec")
+Job *find_job_by_spec(const char *spec, const char **error);
+
+// Update job status
+void update_job_status(int job_id, JobStatus status);
+
+// Update job status by process group ID
+void update_job_status_by_pgid(pid_t pgid, JobStatus status);
+
+// Record a wait status reported by waitpid() for a job process
+// Marks the job stopped, or done once all of its processes have exited
+// Returns the job the process belongs to, or NULL if it is not in the table
+Job *mark_process_status(pid_t pid, int status);
+
+// Find the first job with the given status
+// Returns pointer to job, or NULL if not found
+Job *find_job_by_status(JobStatus status);
+
+// Find a finished job whose status has not been collected by wait
+// Returns pointer to job, or NULL if not found
+Job *find_finished_job(void);
+
+// Track a foreground job that is not in the table, so its processes are
+// recognised when reaped (NULL when the shell is in the foreground)
+void set_foreground_job(Job *job);
+
+// Drop a finished job once wait has collected its status
+// Jobs with captured output are kept until their log has been read
+void release_job(Job *job);
+
+// Count jobs with the given status
+int count_jobs(JobStatus status);
+
+// Get all jobs (for jobs command)
+// Returns number of jobs, fills jobs array (at most max_jobs entries)
+int get_all_jobs(Job *jobs, int max_jobs);
+
+// Get number of jobs in the table
+int get_job_count(void);
+
+// Get next available job ID
+int get_next_job_id(void);
+
+// Clean up finished jobs (captured output is kept until read)
+void cleanup_jobs(void);
+
+// Find the running coprocess with the given name
+// Returns pointer to job, or NULL if not found
+Job *find_coproc(const char *name);
+
+// Send a signal to every process in a job
+// SIGKILL uses the job's cgroup (if any) so strays that left the process
+// group die too
+// Returns 0 on success, -1 on error (errno set)
+int signal_job(Job *job, int sig);
+
+// Free job resources
+void free_job(Job *job);
+
+#endif // JOBS_H
+
@@ -0,0 +1,552 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "launch.h"
+#include "memacct.h"
+#include "outbuf.h"
+#include "signals.h"
+#include "timeout.h"
+#include "utils.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/ioprio.h>
+
+// ioprio_set()/ioprio_get() have no glibc wrappers
+static int ioprio_set(int which, int who, int ioprio) {
+    return (int)syscall(SYS_ioprio_set, which, who, ioprio);
+}
+
+static int ioprio_get(int which, int who) {
+    return (int)syscall(SYS_ioprio_get, which, who);
+}
+
+// Returns 1 if the environment variable is set to a true value
+static int env_flag(const char *name) {
+    const char *value = getenv(name);
+    return value && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+// Initialize options with shell-wide defaults
+void init_launch_options(LaunchOptions *opts) {
+    opts->capture = env_flag("MYSHELL_CAPTURE");
+    opts->queued = 0;
+    opts->priority = 0;
+    opts->set_affinity = 0;
+    CPU_ZERO(&opts->affinity);
+    opts->set_nice = 0;
+    opts->nice = 0;
+    opts->set_ioprio = 0;
+    opts->ioprio = 0;
+    opts->use_cgroup = env_flag("MYSHELL_CGROUPS");
+    opts->cgroup_prefix = 0;
+    opts->memory_max[0] = '\0';
+    opts->cpu_max[0] = '\0';
+    opts->pids_max[0] = '\0';
+    opts->num_rlimits = 0;
+    opts->timeout_ms = 0;
+    opts->timeout_signal = SIGTERM;
+    opts->kill_after_ms = 0;
+    opts->coproc_name[0] = '\0';
+    opts->perfstat = 0;
+}
+
+// Parse a CPU list such as "0-3,6"
+// Returns 0 on success, -1 on error
+static int parse_cpu_list(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+
+    while (*p != '\0') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return -1;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) {
+                return -1;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+// Parse an I/O priority: idle, be[:level], rt[:level] (level 0-7)
+// Returns the ioprio_set() value, or -1 on error
+static int parse_ioprio(const char *spec) {
+    int class;
+    const char *level_str = strchr(spec, ':');
+    size_t name_len = level_str ? (size_t)(level_str - spec) : strlen(spec);
+
+    if (strncmp(spec, "idle", name_len) == 0 && name_len == 4) {
+        class = IOPRIO_CLASS_IDLE;
+    } else if (strncmp(spec, "be", name_len) == 0 && name_len == 2) {
+        class = IOPRIO_CLASS_BE;
+    } else if (strncmp(spec, "rt", name_len) == 0 && name_len == 2) {
+        class = IOPRIO_CLASS_RT;
+    } else {
+        return -1;
+    }
+
+    int level = IOPRIO_NORM;
+    if (level_str) {
+        char *end;
+        level = (int)strtol(level_str + 1, &end, 10);
+        if (*end != '\0' || level < 0 || level >= IOPRIO_NR_LEVELS) {
+            return -1;
+        }
+    }
+    if (class == IOPRIO_CLASS_IDLE) {
+        level = 0;
+    }
+
+    return IOPRIO_PRIO_VALUE(class, level);
+}
+
+// Parse sched options starting at argv[*index]
+int parse_sched_options(char **argv, int *index, LaunchOptions *opts) {
+    int i = *index;
+
+    while (argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0') {
+        const char *opt = argv[i];
+        const char *value = argv[i + 1];
+
+        if (strcmp(opt, "--") == 0) {
+            i++;
+            break;
+        }
+        if (value == NULL) {
+            fprintf(stderr, "myshell: sched: %s: argument required\n", opt);
+            return -1;
+        }
+
+        if (strcmp(opt, "-c") == 0) {
+            if (parse_cpu_list(value, &opts->affinity) == -1) {
+                fprintf(stderr, "myshell: sched: %s: invalid CPU list\n", value);
+                return -1;
+            }
+            opts->set_affinity = 1;
+        } else if (strcmp(opt, "-n") == 0) {
+            char *end;
+            long nice = strtol(value, &end, 10);
+            if (*end != '\0' || nice < -20 || nice > 19) {
+                fprintf(stderr, "myshell: sched: %s: nice level must be -20..19\n", value);
+                return -1;
+            }
+            opts->nice = (int)nice;
+            opts->set_nice = 1;
+        } else if (strcmp(opt, "-i") == 0) {
+            int ioprio = parse_ioprio(value);
+            if (ioprio == -1) {
+                fprintf(stderr, "myshell: sched: %s: I/O class must be idle, be[:0-7] or rt[:0-7]\n", value);
+                return -1;
+            }
+            opts->ioprio = ioprio;
+            opts->set_ioprio = 1;
+        } else {
+            fprintf(stderr, "myshell: sched: %s: invalid option\n", opt);
+            return -1;
+        }
+        i += 2;
+    }
+
+    *index = i;
+    return 0;
+}
+
+// Parse cgroup limits (-m memory, -c cpus, -p pids) starting at argv[*index]
+// Memory takes a byte count with optional K/M/G suffix, CPUs a (fractional)
+// number of CPUs, pids a process count; "max" removes a limit
+// Returns 0 on success, -1 on error
+static int parse_cgroup_options(char **argv, int *index, LaunchOptions *opts) {
+    int i = *index;
+
+    while (argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0') {
+        const char *opt = argv[i];
+        const char *value = argv[i + 1];
+
+        if (value == NULL) {
+            fprintf(stderr, "myshell: cgroup: %s: argument required\n", opt);
+            return -1;
+        }
+
+        char *end;
+        int is_max = strcmp(value, "max") == 0;
+        if (strcmp(opt, "-m") == 0) {
+            strtoull(value, &end, 10);
+            // memory.max takes the K/M/G suffixes itself
+            if (!is_max && (end == value || value[0] == '-' ||
+                            (*end != '\0' && (strchr("KMGkmg", *end) == NULL || end[1] != '\0')))) {
+                fprintf(stderr, "myshell: cgroup: %s: invalid memory limit\n", value);
+                return -1;
+            }
+            snprintf(opts->memory_max, sizeof(opts->memory_max), "%s", value);
+        } else if (strcmp(opt, "-c") == 0) {
+            double cpus = strtod(value, &end);
+            if (is_max) {
+                snprintf(opts->cpu_max, sizeof(opts->cpu_max), "max");
+            } else if (end == value || *end != '\0' || cpus <= 0) {
+                fprintf(stderr, "myshell: cgroup: %s: invalid CPU limit\n", value);
+                return -1;
+            } else {
+                // Quota per 100ms period; the kernel minimum quota is 1ms
+                long quota = (long)(cpus * 100000);
+                snprintf(opts->cpu_max, sizeof(opts->cpu_max), "%ld 100000",
+                         quota < 1000 ? 1000 : quota);
+            }
+        } else if (strcmp(opt, "-p") == 0) {
+            long pids = strtol(value, &end, 10);
+            if (!is_max && (end == value || *end != '\0' || pids <= 0)) {
+                fprintf(stderr, "myshell: cgroup: %s: invalid process limit\n", value);
+                return -1;
+            }
+            snprintf(opts->pids_max, sizeof(opts->pids_max), "%s", value);
+        } else {
+            fprintf(stderr, "myshell: cgroup: %s: invalid option\n", opt);
+            return -1;
+        }
+        i += 2;
+    }
+
+    *index = i;
+    return 0;
+}
+
+// Returns 1 if name is a valid variable name
+static int is_identifier(const char *name) {
+    if (!isalpha((unsigned char)name[0]) && name[0] != '_') {
+        return 0;
+    }
+    for (const char *p = name + 1; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parse "[-s SIG] [-k grace] DURATION" starting at argv[*index]
+// Returns 0 on success, -1 on error
+static int parse_timeout_options(char **argv, int *index, LaunchOptions *opts) {
+    int i = *index;
+
+    while (argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0') {
+        const char *opt = argv[i];
+        const char *value = argv[i + 1];
+
+        if (value == NULL) {
+            fprintf(stderr, "myshell: timeout: %s: argument required\n", opt);
+            return -1;
+        }
+        if (strcmp(opt, "-s") == 0) {
+            opts->timeout_signal = parse_signal(value);
+            if (opts->timeout_signal == -1) {
+                fprintf(stderr, "myshell: timeout: %s: invalid signal\n", value);
+                return -1;
+            }
+        } else if (strcmp(opt, "-k") == 0) {
+            if (parse_duration(value, &opts->kill_after_ms) == -1) {
+                fprintf(stderr, "myshell: timeout: %s: invalid duration\n", value);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "myshell: timeout: %s: invalid option\n", opt);
+            return -1;
+        }
+        i += 2;
+    }
+
+    if (argv[i] == NULL) {
+        fprintf(stderr, "myshell: timeout: duration required\n");
+        return -1;
+    }
+    if (parse_duration(argv[i], &opts->timeout_ms) == -1) {
+        fprintf(stderr, "myshell: timeout: %s: invalid duration\n", argv[i]);
+        return -1;
+    }
+
+    *index = i + 1;
+    return 0;
+}
+
+// Apply scheduling options and resource limits to the calling process
+int apply_launch_options(const LaunchOptions *opts) {
+    // Failures are reported but not fatal: the command still runs
+    if (opts->set_affinity &&
+        sched_setaffinity(0, sizeof(cpu_set_t), &opts->affinity) == -1) {
+        perror("myshell: sched_setaffinity");
+    }
+    if (opts->set_nice && setpriority(PRIO_PROCESS, 0, opts->nice) == -1) {
+        perror("myshell: setpriority");
+    }
+    if (opts->set_ioprio &&
+        ioprio_set(IOPRIO_WHO_PROCESS, 0, opts->ioprio) == -1) {
+        perror("myshell: ioprio_set");
+    }
+
+    // A limit that cannot be applied must not let the command run unbounded
+    for (int i = 0; i < opts->num_rlimits; i++) {
+        if (apply_ulimit(&opts->rlimits[i], 0) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Get the process group of a process from /proc/<pid>/stat
+static pid_t proc_pgrp(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    char buf[512];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+
+    // Fields after the command name: state ppid pgrp ...
+    char *p = strrchr(buf, ')');
+    int pgrp;
+    if (!p || sscanf(p + 1, " %*c %*d %d", &pgrp) != 1) {
+        return -1;
+    }
+    return pgrp;
+}
+
+// Set CPU affinity on every thread of a process
+static int set_process_affinity(pid_t pid, const cpu_set_t *set) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return sched_setaffinity(pid, sizeof(cpu_set_t), set);
+    }
+
+    int result = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        if (tid > 0 && sched_setaffinity(tid, sizeof(cpu_set_t), set) == -1) {
+            result = -1;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+// Apply scheduling options to every task in a process group
+int apply_sched_to_pgrp(pid_t pgid, const LaunchOptions *opts) {
+    int result = 0;
+
+    // Nice level and I/O priority can address the whole group directly
+    if (opts->set_nice && setpriority(PRIO_PGRP, pgid, opts->nice) == -1) {
+        perror("myshell: sched: setpriority");
+        result = -1;
+    }
+    if (opts->set_ioprio && ioprio_set(IOPRIO_WHO_PGRP, pgid, opts->ioprio) == -1) {
+        perror("myshell: sched: ioprio_set");
+        result = -1;
+    }
+
+    // Affinity is per thread - find every process in the group
+    if (opts->set_affinity) {
+        DIR *proc = opendir("/proc");
+        if (!proc) {
+            perror("myshell: sched: /proc");
+            return -1;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(proc)) != NULL) {
+            if (!isdigit((unsigned char)entry->d_name[0])) {
+                continue;
+            }
+            pid_t pid = (pid_t)atoi(entry->d_name);
+            if (proc_pgrp(pid) == pgid && set_process_affinity(pid, &opts->affinity) == -1) {
+                fprintf(stderr, "myshell: sched: %d: ", (int)pid);
+                perror("sched_setaffinity");
+                result = -1;
+            }
+        }
+        closedir(proc);
+    }
+
+    return result;
+}
+
+// Print the scheduling settings of a process
+void print_sched_settings(pid_t pid) {
+    cpu_set_t set;
+    out_printf("affinity: ");
+    if (sched_getaffinity(pid, sizeof(set), &set) == 0) {
+        // Print as a CPU list, collapsing ranges
+        int first = 1;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &set)) {
+                continue;
+            }
+            int last = cpu;
+            while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) {
+                last++;
+            }
+            out_printf(first ? "%d" : ",%d", cpu);
+            if (last > cpu) {
+                out_printf("-%d", last);
+            }
+            first = 0;
+            cpu = last;
+        }
+        out_putc('\n');
+    } else {
+        out_printf("unknown\n");
+    }
+
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, pid);
+    if (errno == 0) {
+        out_printf("nice: %d\n", nice);
+    }
+
+    int ioprio = ioprio_get(IOPRIO_WHO_PROCESS, pid);
+    if (ioprio != -1) {
+        static const char *classes[] = { "none", "rt", "be", "idle" };
+        int class = IOPRIO_PRIO_CLASS(ioprio);
+        out_printf("ioprio: %s:%d\n", class < 4 ? classes[class] : "?",
+                   (int)IOPRIO_PRIO_DATA(ioprio));
+    }
+}
+
+// Remove the first n words of argv (freeing them)
+static void shift_argv(char **argv, int n) {
+    for (int i = 0; i < n; i++) {
+        mem_free(MEM_PARSER, argv[i]);
+    }
+    int i = 0;
+    while (argv[i + n] != NULL) {
+        argv[i] = argv[i + n];
+        i++;
+    }
+    argv[i] = NULL;
+}
+
+// Strip launch prefixes from the front of cmd->argv into opts
+int parse_launch_prefixes(Command *cmd, LaunchOptions *opts) {
+    if (!cmd || !cmd->argv) {
+        return -1;
+    }
+
+    for (;;) {
+        char *word = cmd->argv[0];
+        if (word == NULL) {
+            break;
+        }
+
+        int consumed = 0;
+        if (strcmp(word, "capture") == 0) {
+            opts->capture = 1;
+            consumed = 1;
+        } else if (strcmp(word, "batch") == 0) {
+            // batch [-p priority] cmd...
+            opts->queued = 1;
+            consumed = 1;
+            if (cmd->argv[1] != NULL && strcmp(cmd->argv[1], "-p") == 0) {
+                if (cmd->argv[2] == NULL) {
+                    fprintf(stderr, "myshell: batch: -p: priority required\n");
+                    return -1;
+                }
+                opts->priority = atoi(cmd->argv[2]);
+                consumed = 3;
+            }
+        } else if (strcmp(word, "sched") == 0) {
+            // sched [options] cmd... (sched [options] %job is the builtin)
+            int index = 1;
+            LaunchOptions sched_opts = *opts;
+            if (parse_sched_options(cmd->argv, &index, &sched_opts) == -1) {
+                return -1;
+            }
+            if (cmd->argv[index] == NULL || cmd->argv[index][0] == '%') {
+                break;
+            }
+            *opts = sched_opts;
+            consumed = index;
+        } else if (strcmp(word, "cgroup") == 0) {
+            // cgroup [-m mem] [-c cpus] [-p pids] cmd...
+            int index = 1;
+            if (parse_cgroup_options(cmd->argv, &index, opts) == -1) {
+                return -1;
+            }
+            opts->use_cgroup = 1;
+            opts->cgroup_prefix = 1;
+            consumed = index;
+        } else if (strcmp(word, "timeout") == 0) {
+            // timeout [-s SIG] [-k grace] DURATION cmd...
+            int index = 1;
+            if (parse_timeout_options(cmd->argv, &index, opts) == -1) {
+                return -1;
+            }
+            consumed = index;
+        } else if (strcmp(word, "perfstat") == 0) {
+            // perfstat cmd...
+            opts->perfstat = 1;
+            consumed = 1;
+        } else if (strcmp(word, "coproc") == 0) {
+            // coproc NAME cmd...
+            const char *name = cmd->argv[1];
+            if (name == NULL || !is_identifier(name) ||
+                strlen(name) >= sizeof(opts->coproc_name) - 8) {
+                fprintf(stderr, "myshell: coproc: %s: invalid name\n", name ? name : "");
+                return -1;
+            }
+            snprintf(opts->coproc_name, sizeof(opts->coproc_name), "%s", name);
+            consumed = 2;
+        } else if (strcmp(word, "ulimit") == 0) {
+            // ulimit -t 5 cmd... (settings only; anything else is the builtin)
+            int index = 1;
+            UlimitArgs args;
+            if (parse_ulimit_args(cmd->argv, &index, &args) == -1) {
+                return -1;
+            }
+            if (cmd->argv[index] == NULL || args.num_settings == 0 ||
+                args.num_queries > 0 || args.show_all) {
+                break;
+            }
+            if (opts->num_rlimits + args.num_settings > MAX_ULIMIT_SETTINGS) {
+                fprintf(stderr, "myshell: ulimit: too many limits\n");
+                return -1;
+            }
+            memcpy(&opts->rlimits[opts->num_rlimits], args.settings,
+                   args.num_settings * sizeof(UlimitSetting));
+            opts->num_rlimits += args.num_settings;
+            consumed = index;
+        } else {
+            break;
+        }
+
+        if (cmd->argv[consumed] == NULL) {
+            fprintf(stderr, "myshell: %s: command required\n", word);
+            return -1;
+        }
+        shift_argv(cmd->argv, consumed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef LAUNCH_H
+#define LAUNCH_H
+
+#include "parser.h"
+#include "ulimit.h"
+#include <sched.h>
+#include <sys/types.h>
+
+// Per-job launch options, set by prefix words in front of a command
+// (e.g. "capture make -j8 &") or by shell-wide defaults
+typedef struct {
+    int capture;           // Capture stdout/stderr into the job log (background only)
+    int queued;            // Submitted with "batch": wait in the job queue
+    int priority;          // Queue priority ("batch -p N"), higher starts first
+    int set_affinity;      // "sched -c": restrict the job to affinity
+    cpu_set_t affinity;
+    int set_nice;          // "sched -n": nice level for the job
+    int nice;
+    int set_ioprio;        // "sched -i": I/O priority (ioprio_set() encoding)
+    int ioprio;
+    int use_cgroup;        // Run the job in its own cgroup (see cgroup.h)
+    int cgroup_prefix;     // Asked for with a "cgroup" prefix, not just MYSHELL_CGROUPS
+    char memory_max[32];   // "cgroup -m": memory.max value, "" = unlimited
+    char cpu_max[32];      // "cgroup -c": cpu.max value, "" = unlimited
+    char pids_max[32];     // "cgroup -p": pids.max value, "" = unlimited
+    UlimitSetting rlimits[MAX_ULIMIT_SETTINGS];  // "ulimit -t 5": set in the child
+    int num_rlimits;
+    long timeout_ms;       // "timeout": deadline after start, 0 = none
+    int timeout_signal;    // "timeout -s": signal sent at the deadline
+    long kill_after_ms;    // "timeout -k": SIGKILL this long after, 0 = never
+    char coproc_name[64];  // "coproc NAME": run as a coprocess, "" = no
+    int perfstat;          // "perfstat": count perf events, summary at job exit
+} LaunchOptions;
+
+// Initialize options with shell-wide defaults
+// MYSHELL_CAPTURE=1 captures the output of every background job
+// MYSHELL_CGROUPS=1 runs every job in its own cgroup
+void init_launch_options(LaunchOptions *opts);
+
+// Strip launch prefixes from the front of cmd->argv into opts
+// Returns 0 on success, -1 on error (message already printed)
+int parse_launch_prefixes(Command *cmd, LaunchOptions *opts);
+
+// Parse sched options (-c cpulist, -n nice, -i class[:level]) starting at
+// argv[*index]; *index is left at the first non-option word
+// Returns 0 on success, -1 on error (message already printed)
+int parse_sched_options(char **argv, int *index, LaunchOptions *opts);
+
+// Apply scheduling options and resource limits to the calling process
+// (child, before exec)
+// Returns 0 on success, -1 if a resource limit could not be set
+int apply_launch_options(const LaunchOptions *opts);
+
+// Apply scheduling options to every task in a process group
+// Returns 0 on success, -1 if any task could not be updated
+int apply_sched_to_pgrp(pid_t pgid, const LaunchOptions *opts);
+
+// Print the scheduling settings of a process (0 = the shell) to the
+// builtin output buffer
+void print_sched_settings(pid_t pid);
+
+#endif // LAUNCH_H
@@ -0,0 +1,323 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "linebuf.h"
+#include "memacct.h"
+#include "utils.h"
+#include <sys/stat.h>
+
+#define LINEBUF_SLOTS 16           // Descriptors with a buffer at a time
+#define READ_BLOCK 65536           // Initial buffer size and read size
+
+typedef struct {
+    int used;
+    int fd;
+    int owned;                     // Only the shell reads fd (read-ahead is safe)
+    dev_t dev;                     // Regular files: identity and state when
+    ino_t ino;                     // the buffer was filled
+    off_t size;
+    struct timespec mtime;
+    off_t offset;                  // Regular files: file offset of buf[0]
+    char *buf;
+    size_t cap;
+    size_t len;                    // Bytes in buf
+    size_t pos;                    // Bytes of buf already consumed
+} LineBuf;
+
+static LineBuf slots[LINEBUF_SLOTS];
+
+// The shell's command input, read by the REPL through the stdin FILE
+static int have_input = 0;
+static dev_t input_dev;
+static ino_t input_ino;
+
+// Remember the shell's command input (call once at startup)
+void init_linebuf(void) {
+    struct stat st;
+    if (fstat(STDIN_FILENO, &st) == 0) {
+        input_dev = st.st_dev;
+        input_ino = st.st_ino;
+        have_input = 1;
+    }
+}
+
+static LineBuf *find_slot(int fd) {
+    for (int i = 0; i < LINEBUF_SLOTS; i++) {
+        if (slots[i].used && slots[i].fd == fd) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void reset_slot(LineBuf *b) {
+    b->len = 0;
+    b->pos = 0;
+    b->offset = 0;
+    b->dev = 0;
+    b->ino = 0;
+}
+
+// Slot for fd, taking a free one (or one that is not owned) if needed
+// Returns NULL if every slot holds an owned descriptor
+static LineBuf *get_slot(int fd) {
+    LineBuf *b = find_slot(fd);
+    if (b) {
+        return b;
+    }
+    for (int i = 0; i < LINEBUF_SLOTS && !b; i++) {
+        if (!slots[i].used) {
+            b = &slots[i];
+        }
+    }
+    for (int i = 0; i < LINEBUF_SLOTS && !b; i++) {
+        if (!slots[i].owned) {
+            b = &slots[i];
+        }
+    }
+    if (!b) {
+        return NULL;
+    }
+    b->used = 1;
+    b->fd = fd;
+    b->owned = 0;
+    reset_slot(b);
+    return b;
+}
+
+// Mark fd as read only by the shell, so it may be read ahead
+void linebuf_own(int fd) {
+    LineBuf *b = get_slot(fd);
+    if (b) {
+        reset_slot(b);
+        b->owned = 1;
+    }
+}
+
+// Drop fd's buffer (call before closing it)
+void linebuf_release(int fd) {
+    LineBuf *b = find_slot(fd);
+    if (b) {
+        mem_free(MEM_INPUT, b->buf);
+        memset(b, 0, sizeof(*b));
+    }
+}
+
+// Append n bytes to the caller's line
+static int put(char **line, size_t *cap, size_t *len, const char *data, size_t n) {
+    if (*len + n + 1 > *cap) {
+        size_t new_cap = *cap ? *cap : 128;
+        while (*len + n + 1 > new_cap) {
+            new_cap *= 2;
+        }
+        char *grown = mem_realloc(MEM_INPUT, *line, new_cap);
+        if (!grown) {
+            return -1;
+        }
+        *line = grown;
+        *cap = new_cap;
+    }
+    memcpy(*line + *len, data, n);
+    *len += n;
+    (*line)[*len] = '\0';
+    return 0;
+}
+
+// Look for the end of a line in the unconsumed part of the buffer
+// Sets *take (bytes of line) and *skip (bytes consumed, with delim)
+// Returns 1 if the line is complete, 0 if more input is needed
+static int scan(const LineBuf *b, int delim, long max, size_t *take, size_t *skip) {
+    size_t avail = b->len - b->pos;
+    size_t limit = max >= 0 && (size_t)max < avail ? (size_t)max : avail;
+    const char *end = memchr(b->buf + b->pos, delim, limit);
+    if (end) {
+        *take = end - (b->buf + b->pos);
+        *skip = *take + 1;
+        return 1;
+    }
+    if (max >= 0 && limit == (size_t)max) {
+        *take = *skip = limit;
+        return 1;
+    }
+    return 0;
+}
+
+// Read more input into the buffer, dropping consumed bytes first
+// Regular files are read with pread() just past the buffered bytes, as
+// the descriptor's offset stays at the start of the unconsumed ones
+// Returns bytes read, 0 at end of input, -1 on error
+static ssize_t fill(LineBuf *b, int fd, int positioned) {
+    if (b->pos > 0) {
+        memmove(b->buf, b->buf + b->pos, b->len - b->pos);
+        b->offset += b->pos;
+        b->len -= b->pos;
+        b->pos = 0;
+    }
+    if (b->len == b->cap) {
+        size_t new_cap = b->cap ? b->cap * 2 : READ_BLOCK;
+        char *grown = mem_realloc(MEM_INPUT, b->buf, new_cap);
+        if (!grown) {
+            return -1;
+        }
+        b->buf = grown;
+        b->cap = new_cap;
+    }
+    ssize_t n;
+    do {
+        n = positioned ? pread(fd, b->buf + b->len, b->cap - b->len, b->offset + (off_t)b->len)
+                       : read(fd, b->buf + b->len, b->cap - b->len);
+    } while (n == -1 && errno == EINTR);
+    if (n > 0) {
+        b->len += n;
+    }
+    return n;
+}
+
+// Fill the buffer until it holds a whole line (or input ends)
+// Returns 1 if complete, 0 at end of input, -1 on error
+static int fill_line(LineBuf *b, int fd, int positioned, int delim, long max, size_t *take,
+                     size_t *skip) {
+    while (!scan(b, delim, max, take, skip)) {
+        ssize_t n = fill(b, fd, positioned);
+        if (n == -1) {
+            return -1;
+        }
+        if (n == 0) {
+            *take = *skip = b->len - b->pos;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// One byte per read(), never taking more than the line
+static int read_bytes(int fd, int delim, long max, char **line, size_t *cap, size_t *len) {
+    for (long count = 0; max < 0 || count < max; count++) {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (n == -1 && errno == EINTR) {
+            count--;
+            continue;
+        }
+        if (n <= 0) {
+            return n == 0 ? 0 : -1;
+        }
+        if (c == delim) {
+            return 1;
+        }
+        if (put(line, cap, len, &c, 1) == -1) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// The shell's command input: share the stdin FILE's buffer with the REPL
+static int read_stdio(int delim, long max, char **line, size_t *cap, size_t *len) {
+    for (long count = 0; max < 0 || count < max; count++) {
+        int c = getc_unlocked(stdin);
+        if (c == EOF) {
+            int failed = ferror(stdin);
+            clearerr(stdin);  // Ctrl+D ends the read, not the shell
+            return failed ? -1 : 0;
+        }
+        if (c == delim) {
+            return 1;
+        }
+        char byte = c;
+        if (put(line, cap, len, &byte, 1) == -1) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static int same_file(const LineBuf *b, const struct stat *st) {
+    return b->dev == st->st_dev && b->ino == st->st_ino && b->size == st->st_size &&
+           b->mtime.tv_sec == st->st_mtim.tv_sec && b->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+// Regular file: read ahead, then leave the offset just past the line
+static int read_regular(LineBuf *b, int fd, const struct stat *st, int delim, long max,
+                        char **line, size_t *cap, size_t *len) {
+    size_t take, skip;
+
+    // Fast path: the line is already buffered and nobody moved the offset;
+    // one relative lseek() both checks that and consumes the line
+    if (same_file(b, st) && b->pos < b->len && scan(b, delim, max, &take, &skip)) {
+        off_t expected = b->offset + (off_t)(b->pos + skip);
+        off_t now = lseek(fd, (off_t)skip, SEEK_CUR);
+        if (now == expected) {
+            b->pos += skip;
+            return put(line, cap, len, b->buf + b->pos - skip, take) == -1 ? -1 : 1;
+        }
+        if (now != -1) {
+            lseek(fd, now - (off_t)skip, SEEK_SET);  // Undo, then read afresh
+        }
+    }
+
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset == -1) {
+        return read_bytes(fd, delim, max, line, cap, len);
+    }
+    if (!same_file(b, st) || offset != b->offset + (off_t)b->pos) {
+        reset_slot(b);
+        b->offset = offset;
+        b->dev = st->st_dev;
+        b->ino = st->st_ino;
+        b->size = st->st_size;
+        b->mtime = st->st_mtim;
+    }
+
+    int result = fill_line(b, fd, 1, delim, max, &take, &skip);
+    if (result == -1) {
+        return -1;
+    }
+    if (lseek(fd, b->offset + (off_t)(b->pos + skip), SEEK_SET) == -1) {
+        return -1;
+    }
+    b->pos += skip;
+    if (put(line, cap, len, b->buf + b->pos - skip, take) == -1) {
+        return -1;
+    }
+    return result;
+}
+
+// Read up to delim (not stored) or max bytes (max < 0: no limit)
+int linebuf_read(int fd, int delim, long max, char **line, size_t *cap, size_t *len) {
+    *len = 0;
+    if (put(line, cap, len, "", 0) == -1) {
+        return -1;
+    }
+    if (max == 0) {
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        return -1;
+    }
+    if (fd == STDIN_FILENO && have_input && st.st_dev == input_dev && st.st_ino == input_ino) {
+        return read_stdio(delim, max, line, cap, len);
+    }
+
+    LineBuf *b = find_slot(fd);
+    if (b && b->owned) {
+        size_t take, skip;
+        int result = fill_line(b, fd, 0, delim, max, &take, &skip);
+        if (result == -1) {
+            return -1;
+        }
+        b->pos += skip;
+        if (put(line, cap, len, b->buf + b->pos - skip, take) == -1) {
+            return -1;
+        }
+        return result;
+    }
+
+    if (S_ISREG(st.st_mode) && (b = get_slot(fd)) != NULL) {
+        return read_regular(b, fd, &st, delim, max, line, cap, len);
+    }
+    return read_bytes(fd, delim, max, line, cap, len);
+}
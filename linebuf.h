@@ -0,0 +1,34 @@
+#ifndef LINEBUF_H
+#define LINEBUF_H
+
+#include <stddef.h>
+
+// Line reading for the read builtin
+// Reading must not take input that belongs to someone else, so the
+// strategy depends on the descriptor:
+//   - the shell's own command input (stdin, not redirected): through the
+//     stdin FILE, sharing its buffer with the REPL
+//   - regular files: block reads, then lseek() back to just past the line;
+//     the block is kept and reused while the file's identity, size, mtime
+//     and offset are unchanged, so a read loop costs one lseek() per line
+//   - descriptors only the shell reads (coprocess output, see
+//     linebuf_own()): a persistent buffer refilled with block reads
+//   - anything else (pipes, terminals shared with children): one byte per
+//     read(), the only way not to over-consume
+
+// Remember the shell's command input (call once at startup)
+void init_linebuf(void);
+
+// Mark fd as read only by the shell, so it may be read ahead
+void linebuf_own(int fd);
+
+// Drop fd's buffer (call before closing it)
+void linebuf_release(int fd);
+
+// Read up to delim (not stored) or max bytes (max < 0: no limit)
+// into *line (grown as needed, NUL-terminated), setting *len
+// Returns 1 if a line was read, 0 at end of input (*len may be > 0 for a
+// last line without delim), -1 on error (errno set)
+int linebuf_read(int fd, int delim, long max, char **line, size_t *cap, size_t *len);
+
+#endif // LINEBUF_H
@@ -0,0 +1,106 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "memacct.h"
+#include "utils.h"
+#include <malloc.h>
+
+static MemStats stats[NUM_MEM_SUBSYSTEMS];
+static MemStats total;
+
+static const char *const subsystem_names[NUM_MEM_SUBSYSTEMS] = {
+    "parser", "history", "jobs", "capture", "input", "caches",
+};
+
+// Add (or with a negative delta, remove) bytes and blocks
+static void account(MemStats *s, ptrdiff_t bytes, int blocks) {
+    s->current += bytes;
+    s->blocks += blocks;
+    if (blocks > 0) {
+        s->allocs += blocks;
+    }
+    if (s->current > s->peak) {
+        s->peak = s->current;
+    }
+}
+
+static void account_alloc(MemSubsystem sub, void *ptr) {
+    size_t size = malloc_usable_size(ptr);
+    account(&stats[sub], size, 1);
+    account(&total, size, 1);
+}
+
+static void account_free(MemSubsystem sub, void *ptr) {
+    size_t size = malloc_usable_size(ptr);
+    account(&stats[sub], -(ptrdiff_t)size, -1);
+    account(&total, -(ptrdiff_t)size, -1);
+}
+
+void *mem_malloc(MemSubsystem sub, size_t size) {
+    void *ptr = malloc(size);
+    if (ptr) {
+        account_alloc(sub, ptr);
+    }
+    return ptr;
+}
+
+void *mem_calloc(MemSubsystem sub, size_t count, size_t size) {
+    void *ptr = calloc(count, size);
+    if (ptr) {
+        account_alloc(sub, ptr);
+    }
+    return ptr;
+}
+
+void *mem_realloc(MemSubsystem sub, void *ptr, size_t size) {
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        return NULL;  // ptr is untouched
+    }
+    if (!ptr) {
+        account_alloc(sub, new_ptr);
+        return new_ptr;
+    }
+    ptrdiff_t delta = (ptrdiff_t)malloc_usable_size(new_ptr) - (ptrdiff_t)old_size;
+    account(&stats[sub], delta, 0);
+    account(&total, delta, 0);
+    return new_ptr;
+}
+
+char *mem_strdup(MemSubsystem sub, const char *s) {
+    size_t len = strlen(s) + 1;
+    char *copy = mem_malloc(sub, len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+void mem_free(MemSubsystem sub, void *ptr) {
+    if (ptr) {
+        account_free(sub, ptr);
+        free(ptr);
+    }
+}
+
+const MemStats *mem_stats(MemSubsystem sub) {
+    return &stats[sub];
+}
+
+const MemStats *mem_total_stats(void) {
+    return &total;
+}
+
+const char *mem_subsystem_name(MemSubsystem sub) {
+    return subsystem_names[sub];
+}
+
+// Reset every peak to the current usage
+void mem_reset_peaks(void) {
+    for (int i = 0; i < NUM_MEM_SUBSYSTEMS; i++) {
+        stats[i].peak = stats[i].current;
+    }
+    total.peak = total.current;
+}
@@ -0,0 +1,48 @@
+#ifndef MEMACCT_H
+#define MEMACCT_H
+
+#include <stddef.h>
+
+// Memory accounting per subsystem (shown by the shellmem builtin)
+// Long-lived allocations go through the wrappers below, which count the
+// bytes malloc actually handed out (malloc_usable_size) against a
+// subsystem. Memory must be freed with the same subsystem it was
+// allocated with.
+
+typedef enum {
+    MEM_PARSER,            // Token arrays, token and argv buffers, parsed commands
+    MEM_HISTORY,           // History ring entries
+    MEM_JOBS,              // Job table, job index, job structs, queue heap
+    MEM_CAPTURE,           // Captured job output rings
+    MEM_INPUT,             // read builtin buffers and lines
+    MEM_CACHE,             // Lookup caches
+    NUM_MEM_SUBSYSTEMS
+} MemSubsystem;
+
+typedef struct {
+    size_t current;        // Bytes in use
+    size_t peak;           // Highest value of current
+    size_t blocks;         // Live allocations
+    unsigned long allocs;  // Allocations made so far
+} MemStats;
+
+// Drop-in replacements for malloc, calloc, realloc, strdup and free
+void *mem_malloc(MemSubsystem sub, size_t size);
+void *mem_calloc(MemSubsystem sub, size_t count, size_t size);
+void *mem_realloc(MemSubsystem sub, void *ptr, size_t size);
+char *mem_strdup(MemSubsystem sub, const char *s);
+void mem_free(MemSubsystem sub, void *ptr);
+
+// Counters of one subsystem
+const MemStats *mem_stats(MemSubsystem sub);
+
+// Counters over all subsystems (the peak is the highest combined usage)
+const MemStats *mem_total_stats(void);
+
+// Name of a subsystem (for reports)
+const char *mem_subsystem_name(MemSubsystem sub);
+
+// Reset every peak to the current usage
+void mem_reset_peaks(void);
+
+#endif // MEMACCT_H
@@ -0,0 +1,442 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "metrics.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+#define METRICS_DEFAULT_INTERVAL 10  // Seconds
+#define SAMPLE_RING_SIZE 4096        // StatsD samples between writes (power of two)
+#define STATSD_PACKET 1400           // Stay under a typical MTU-sized datagram
+
+// Histogram upper bounds; a final +Inf bucket is implied
+static const double launch_bounds[] = {    // Seconds
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+};
+static const double depth_bounds[] = { 1, 2, 3, 4, 6, 8, 16 };
+
+#define NUM_LAUNCH_BUCKETS (sizeof(launch_bounds) / sizeof(launch_bounds[0]) + 1)
+#define NUM_DEPTH_BUCKETS (sizeof(depth_bounds) / sizeof(depth_bounds[0]) + 1)
+
+typedef struct {
+    atomic_ulong input_lines;
+    atomic_ulong parse_errors;
+    atomic_ulong builtin_commands;
+    atomic_ulong external_commands;
+    atomic_ulong launch_buckets[NUM_LAUNCH_BUCKETS];
+    atomic_ulong launch_sum_ns;
+    atomic_ulong depth_buckets[NUM_DEPTH_BUCKETS];
+    atomic_ulong depth_sum;
+    atomic_int running_jobs;
+    atomic_int stopped_jobs;
+    atomic_int history_entries;
+} Metrics;
+
+// Plain copy of the counters, taken by the writer thread
+typedef struct {
+    unsigned long input_lines, parse_errors, builtin_commands, external_commands;
+    unsigned long launch_buckets[NUM_LAUNCH_BUCKETS], launch_sum_ns;
+    unsigned long depth_buckets[NUM_DEPTH_BUCKETS], depth_sum;
+    int running_jobs, stopped_jobs, history_entries;
+} MetricsSnapshot;
+
+// Single-producer single-consumer ring of raw samples for StatsD timers:
+// the REPL appends at head, the writer thread consumes from tail
+typedef struct {
+    uint32_t launch_us;
+    uint32_t depth;
+} LaunchSample;
+
+static int exporting = 0;
+static Metrics metrics;
+static pid_t metrics_pid;            // Process that owns the writer thread
+
+static char *file_path;              // Prometheus text file
+static char *tmp_path;
+static int statsd_fd = -1;           // StatsD datagram socket
+static struct sockaddr_un statsd_addr;
+static MetricsSnapshot last_sent;    // StatsD counters are sent as deltas
+
+static LaunchSample samples[SAMPLE_RING_SIZE];
+static atomic_size_t sample_head = 0;
+static atomic_size_t sample_tail = 0;
+static atomic_ulong samples_dropped = 0;
+
+static long interval_sec = METRICS_DEFAULT_INTERVAL;
+static pthread_t writer_thread;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wakeup = PTHREAD_COND_INITIALIZER;
+static int writer_stop = 0;
+
+static void add(atomic_ulong *counter, unsigned long n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static unsigned long load(atomic_ulong *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void take_snapshot(MetricsSnapshot *s) {
+    s->input_lines = load(&metrics.input_lines);
+    s->parse_errors = load(&metrics.parse_errors);
+    s->builtin_commands = load(&metrics.builtin_commands);
+    s->external_commands = load(&metrics.external_commands);
+    for (size_t i = 0; i < NUM_LAUNCH_BUCKETS; i++) {
+        s->launch_buckets[i] = load(&metrics.launch_buckets[i]);
+    }
+    s->launch_sum_ns = load(&metrics.launch_sum_ns);
+    for (size_t i = 0; i < NUM_DEPTH_BUCKETS; i++) {
+        s->depth_buckets[i] = load(&metrics.depth_buckets[i]);
+    }
+    s->depth_sum = load(&metrics.depth_sum);
+    s->running_jobs = atomic_load_explicit(&metrics.running_jobs, memory_order_relaxed);
+    s->stopped_jobs = atomic_load_explicit(&metrics.stopped_jobs, memory_order_relaxed);
+    s->history_entries = atomic_load_explicit(&metrics.history_entries, memory_order_relaxed);
+}
+
+// Append printf-style text to buf (silently truncated when full)
+static void append(char *buf, size_t size, size_t *used, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void append(char *buf, size_t size, size_t *used, const char *fmt, ...) {
+    if (*used >= size) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *used, size - *used, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        *used = *used + n < size ? *used + n : size;
+    }
+}
+
+// Cumulative buckets, _sum and _count of one histogram
+// The count is taken from the buckets, so it always matches +Inf even if a
+// sample lands while the snapshot is being read
+static void append_histogram(char *buf, size_t size, size_t *used, const char *name,
+                             const double *bounds, size_t num_bounds,
+                             const unsigned long *buckets, double sum) {
+    unsigned long cumulative = 0;
+    for (size_t i = 0; i < num_bounds; i++) {
+        cumulative += buckets[i];
+        append(buf, size, used, "%s_bucket{le=\"%g\"} %lu\n", name, bounds[i], cumulative);
+    }
+    cumulative += buckets[num_bounds];
+    append(buf, size, used, "%s_bucket{le=\"+Inf\"} %lu\n", name, cumulative);
+    append(buf, size, used, "%s_sum %g\n", name, sum);
+    append(buf, size, used, "%s_count %lu\n", name, cumulative);
+}
+
+// Rewrite the Prometheus file (written aside and renamed, so a scrape
+// never sees half a file)
+static void write_prometheus(const MetricsSnapshot *s) {
+    char buf[8192];
+    size_t used = 0;
+    unsigned long commands = s->builtin_commands + s->external_commands;
+
+    append(buf, sizeof(buf), &used,
+           "# HELP myshell_input_lines_total Command lines run by the shell.\n"
+           "# TYPE myshell_input_lines_total counter\n"
+           "myshell_input_lines_total %lu\n"
+           "# HELP myshell_commands_total Commands run, by builtin or external.\n"
+           "# TYPE myshell_commands_total counter\n"
+           "myshell_commands_total{kind=\"builtin\"} %lu\n"
+           "myshell_commands_total{kind=\"external\"} %lu\n"
+           "# HELP myshell_builtin_ratio Fraction of commands that were builtins.\n"
+           "# TYPE myshell_builtin_ratio gauge\n"
+           "myshell_builtin_ratio %g\n"
+           "# HELP myshell_parse_errors_total Lines rejected by the tokenizer or parser.\n"
+           "# TYPE myshell_parse_errors_total counter\n"
+           "myshell_parse_errors_total %lu\n",
+           s->input_lines, s->builtin_commands, s->external_commands,
+           commands ? (double)s->builtin_commands / commands : 0.0, s->parse_errors);
+
+    append(buf, sizeof(buf), &used,
+           "# HELP myshell_launch_duration_seconds Time to fork and set up a pipeline.\n"
+           "# TYPE myshell_launch_duration_seconds histogram\n");
+    append_histogram(buf, sizeof(buf), &used, "myshell_launch_duration_seconds",
+                     launch_bounds, NUM_LAUNCH_BUCKETS - 1, s->launch_buckets,
+                     s->launch_sum_ns / 1e9);
+    append(buf, sizeof(buf), &used,
+           "# HELP myshell_pipeline_depth Stages per launched pipeline.\n"
+           "# TYPE myshell_pipeline_depth histogram\n");
+    append_histogram(buf, sizeof(buf), &used, "myshell_pipeline_depth",
+                     depth_bounds, NUM_DEPTH_BUCKETS - 1, s->depth_buckets,
+                     (double)s->depth_sum);
+
+    append(buf, sizeof(buf), &used,
+           "# HELP myshell_jobs Jobs in the job table.\n"
+           "# TYPE myshell_jobs gauge\n"
+           "myshell_jobs{state=\"running\"} %d\n"
+           "myshell_jobs{state=\"stopped\"} %d\n"
+           "# HELP myshell_history_entries Entries in the command history.\n"
+           "# TYPE myshell_history_entries gauge\n"
+           "myshell_history_entries %d\n",
+           s->running_jobs, s->stopped_jobs, s->history_entries);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return;
+    }
+    ssize_t written = write(fd, buf, used);
+    close(fd);
+    if (written == (ssize_t)used) {
+        rename(tmp_path, file_path);
+    } else {
+        unlink(tmp_path);
+    }
+}
+
+// Queue one StatsD line, sending the packet first if it would not fit
+static void statsd_line(char *packet, size_t *used, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void statsd_send(const char *packet, size_t len) {
+    // Nobody listening (yet) is fine: StatsD is fire and forget
+    sendto(statsd_fd, packet, len, MSG_DONTWAIT, (struct sockaddr *)&statsd_addr,
+           sizeof(statsd_addr));
+}
+
+static void statsd_line(char *packet, size_t *used, const char *fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len <= 0 || len >= (int)sizeof(line)) {
+        return;
+    }
+    if (*used > 0 && *used + len + 1 > STATSD_PACKET) {
+        statsd_send(packet, *used);
+        *used = 0;
+    }
+    if (*used > 0) {
+        packet[(*used)++] = '\n';
+    }
+    memcpy(packet + *used, line, len);
+    *used += len;
+}
+
+// Send counter deltas since the last write, gauges, and the queued samples
+static void write_statsd(const MetricsSnapshot *s) {
+    char packet[STATSD_PACKET];
+    size_t used = 0;
+
+    struct { const char *name; unsigned long now, before; } counters[] = {
+        { "input_lines", s->input_lines, last_sent.input_lines },
+        { "commands.builtin", s->builtin_commands, last_sent.builtin_commands },
+        { "commands.external", s->external_commands, last_sent.external_commands },
+        { "parse_errors", s->parse_errors, last_sent.parse_errors },
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        if (counters[i].now != counters[i].before) {
+            statsd_line(packet, &used, "myshell.%s:%lu|c", counters[i].name,
+                        counters[i].now - counters[i].before);
+        }
+    }
+    last_sent = *s;
+
+    statsd_line(packet, &used, "myshell.jobs.running:%d|g", s->running_jobs);
+    statsd_line(packet, &used, "myshell.jobs.stopped:%d|g", s->stopped_jobs);
+    statsd_line(packet, &used, "myshell.history_entries:%d|g", s->history_entries);
+
+    size_t head = atomic_load_explicit(&sample_head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&sample_tail, memory_order_relaxed);
+    for (; tail != head; tail++) {
+        const LaunchSample *sample = &samples[tail % SAMPLE_RING_SIZE];
+        statsd_line(packet, &used, "myshell.launch_duration:%.3f|ms",
+                    sample->launch_us / 1e3);
+        statsd_line(packet, &used, "myshell.pipeline_depth:%u|h", sample->depth);
+    }
+    atomic_store_explicit(&sample_tail, tail, memory_order_release);
+
+    unsigned long dropped = atomic_exchange(&samples_dropped, 0);
+    if (dropped > 0) {
+        statsd_line(packet, &used, "myshell.samples_dropped:%lu|c", dropped);
+    }
+
+    if (used > 0) {
+        statsd_send(packet, used);
+    }
+}
+
+static void write_metrics(void) {
+    MetricsSnapshot snapshot;
+    take_snapshot(&snapshot);
+    if (file_path) {
+        write_prometheus(&snapshot);
+    }
+    if (statsd_fd != -1) {
+        write_statsd(&snapshot);
+    }
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&writer_lock);
+    while (!writer_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += interval_sec;
+        pthread_cond_timedwait(&writer_wakeup, &writer_lock, &deadline);
+
+        pthread_mutex_unlock(&writer_lock);
+        write_metrics();
+        pthread_mutex_lock(&writer_lock);
+    }
+    pthread_mutex_unlock(&writer_lock);
+    return NULL;
+}
+
+// Stop the writer thread after one last write
+static void finish_metrics(void) {
+    if (!exporting || getpid() != metrics_pid) {
+        return;  // Forked children have no writer thread
+    }
+
+    pthread_mutex_lock(&writer_lock);
+    writer_stop = 1;
+    pthread_cond_signal(&writer_wakeup);
+    pthread_mutex_unlock(&writer_lock);
+    pthread_join(writer_thread, NULL);
+    exporting = 0;
+}
+
+// Start the exporter if MYSHELL_METRICS_FILE or MYSHELL_METRICS_SOCKET is set
+void init_metrics(void) {
+    const char *path = getenv("MYSHELL_METRICS_FILE");
+    const char *socket_path = getenv("MYSHELL_METRICS_SOCKET");
+    const char *interval = getenv("MYSHELL_METRICS_INTERVAL");
+
+    if (interval && interval[0] != '\0') {
+        char *end;
+        long value = strtol(interval, &end, 10);
+        if (*end != '\0' || value <= 0) {
+            fprintf(stderr, "myshell: MYSHELL_METRICS_INTERVAL: %s: invalid interval\n",
+                    interval);
+        } else {
+            interval_sec = value;
+        }
+    }
+
+    if (path && path[0] != '\0') {
+        file_path = strdup(path);
+        if (file_path && asprintf(&tmp_path, "%s.tmp", path) == -1) {
+            tmp_path = NULL;
+        }
+        if (!file_path || !tmp_path) {
+            perror("myshell: metrics");
+            free(file_path);
+            file_path = NULL;
+        }
+    }
+
+    if (socket_path && socket_path[0] != '\0') {
+        if (strlen(socket_path) >= sizeof(statsd_addr.sun_path)) {
+            fprintf(stderr, "myshell: MYSHELL_METRICS_SOCKET: %s: path too long\n", socket_path);
+        } else {
+            statsd_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+            if (statsd_fd == -1) {
+                perror("myshell: metrics: socket");
+            } else {
+                statsd_addr.sun_family = AF_UNIX;
+                strcpy(statsd_addr.sun_path, socket_path);
+            }
+        }
+    }
+
+    if (!file_path && statsd_fd == -1) {
+        return;
+    }
+
+    metrics_pid = getpid();
+    int err = pthread_create(&writer_thread, NULL, writer_main, NULL);
+    if (err != 0) {
+        fprintf(stderr, "myshell: metrics: %s\n", strerror(err));
+        return;
+    }
+    exporting = 1;
+    atexit(finish_metrics);
+}
+
+int metrics_enabled(void) {
+    return exporting;
+}
+
+void metrics_input_line(void) {
+    if (exporting) {
+        add(&metrics.input_lines, 1);
+    }
+}
+
+void metrics_parse_error(void) {
+    if (exporting) {
+        add(&metrics.parse_errors, 1);
+    }
+}
+
+void metrics_command(int builtin) {
+    if (exporting) {
+        add(builtin ? &metrics.builtin_commands : &metrics.external_commands, 1);
+    }
+}
+
+uint64_t metrics_clock(void) {
+    if (!exporting) {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void metrics_launch(uint64_t start, int depth) {
+    if (!exporting || start == 0) {
+        return;
+    }
+    uint64_t ns = metrics_clock() - start;
+
+    size_t bucket = 0;
+    while (bucket < NUM_LAUNCH_BUCKETS - 1 && ns / 1e9 > launch_bounds[bucket]) {
+        bucket++;
+    }
+    add(&metrics.launch_buckets[bucket], 1);
+    add(&metrics.launch_sum_ns, ns);
+
+    bucket = 0;
+    while (bucket < NUM_DEPTH_BUCKETS - 1 && depth > depth_bounds[bucket]) {
+        bucket++;
+    }
+    add(&metrics.depth_buckets[bucket], 1);
+    add(&metrics.depth_sum, depth);
+
+    if (statsd_fd == -1) {
+        return;
+    }
+    size_t head = atomic_load_explicit(&sample_head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&sample_tail, memory_order_acquire);
+    if (head - tail >= SAMPLE_RING_SIZE) {
+        add(&samples_dropped, 1);  // Writer is behind; never block the REPL
+        return;
+    }
+    samples[head % SAMPLE_RING_SIZE].launch_us = ns / 1000 > UINT32_MAX ? UINT32_MAX : ns / 1000;
+    samples[head % SAMPLE_RING_SIZE].depth = depth;
+    atomic_store_explicit(&sample_head, head + 1, memory_order_release);
+}
+
+void metrics_set_gauges(int running_jobs, int stopped_jobs, int history_entries) {
+    if (!exporting) {
+        return;
+    }
+    atomic_store_explicit(&metrics.running_jobs, running_jobs, memory_order_relaxed);
+    atomic_store_explicit(&metrics.stopped_jobs, stopped_jobs, memory_order_relaxed);
+    atomic_store_explicit(&metrics.history_entries, history_entries, memory_order_relaxed);
+}
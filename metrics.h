@@ -0,0 +1,39 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+// Metrics export for fleet monitoring
+// MYSHELL_METRICS_FILE=path rewrites a Prometheus text-format file (for the
+// node exporter's textfile collector); MYSHELL_METRICS_SOCKET=path sends
+// StatsD lines to a Unix datagram socket. A background thread writes every
+// MYSHELL_METRICS_INTERVAL seconds (default 10) and once more at exit.
+// The recording calls below only touch atomics (and the vDSO clock), so the
+// REPL makes no extra system calls; with metrics off they return at once.
+
+// Start the exporter if MYSHELL_METRICS_FILE or MYSHELL_METRICS_SOCKET is set
+void init_metrics(void);
+
+// Returns 1 if metrics are being exported
+int metrics_enabled(void);
+
+// One input line run by the REPL
+void metrics_input_line(void);
+
+// A tokenize or syntax error
+void metrics_parse_error(void);
+
+// A command run in the shell (builtin = 1) or launched as a process stage
+// (builtin = 1 if the stage runs a builtin in the child)
+void metrics_command(int builtin);
+
+// Monotonic timestamp for metrics_launch(), 0 when metrics are off
+uint64_t metrics_clock(void);
+
+// A pipeline of depth stages was launched, starting at metrics_clock() start
+void metrics_launch(uint64_t start, int depth);
+
+// Current job and history sizes (sampled by the REPL before each prompt)
+void metrics_set_gauges(int running_jobs, int stopped_jobs, int history_entries);
+
+#endif // METRICS_H
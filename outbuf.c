@@ -0,0 +1,103 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "outbuf.h"
+#include "utils.h"
+#include <stdarg.h>
+
+#define OUTBUF_SIZE 16384
+
+static char buf[OUTBUF_SIZE];
+static size_t used = 0;
+static int write_errno = 0;        // First failed write since the last flush
+
+// Write all of data to stdout, remembering the first failure
+static void write_out(const char *data, size_t len) {
+    while (len > 0 && write_errno == 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n == -1) {
+            if (errno != EINTR) {
+                write_errno = errno;
+            }
+            continue;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+// Append len bytes
+void out_write(const char *data, size_t len) {
+    if (used + len > OUTBUF_SIZE) {
+        write_out(buf, used);
+        used = 0;
+        if (len >= OUTBUF_SIZE) {
+            write_out(data, len);  // Too big to be worth copying
+            return;
+        }
+    }
+    memcpy(buf + used, data, len);
+    used += len;
+}
+
+// Append a string
+void out_puts(const char *s) {
+    out_write(s, strlen(s));
+}
+
+// Append one character
+void out_putc(char c) {
+    if (used == OUTBUF_SIZE) {
+        write_out(buf, used);
+        used = 0;
+    }
+    buf[used++] = c;
+}
+
+// Append formatted text, straight into the buffer when it fits
+void out_printf(const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(buf + used, OUTBUF_SIZE - used, format, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n < OUTBUF_SIZE - used) {
+        used += n;
+        return;
+    }
+
+    // Did not fit: make room, or format into a temporary if it never will
+    write_out(buf, used);
+    used = 0;
+    if ((size_t)n < OUTBUF_SIZE) {
+        va_start(ap, format);
+        vsnprintf(buf, OUTBUF_SIZE, format, ap);
+        va_end(ap);
+        used = n;
+        return;
+    }
+    char *big = malloc(n + 1);
+    if (!big) {
+        return;
+    }
+    va_start(ap, format);
+    vsnprintf(big, n + 1, format, ap);
+    va_end(ap);
+    write_out(big, n);
+    free(big);
+}
+
+// Write out everything buffered
+int out_flush(void) {
+    write_out(buf, used);
+    used = 0;
+    if (write_errno != 0) {
+        errno = write_errno;
+        write_errno = 0;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+
+// Buffered standard output for builtins
+// Builtins append their output here instead of using stdio or calling
+// write() per piece. execute_builtin() flushes it when the builtin
+// returns, and it is also flushed when it fills up, before fork() (so a
+// child never inherits unwritten output) and before fg hands the terminal
+// to a job. A failed write is remembered and reported by the next
+// out_flush().
+
+// Append len bytes
+void out_write(const char *data, size_t len);
+
+// Append a string
+void out_puts(const char *s);
+
+// Append one character
+void out_putc(char c);
+
+// Append formatted text (printf format)
+void out_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Write out everything buffered
+// Returns 0 on success, -1 if this or an earlier write failed (errno set)
+int out_flush(void);
+
+#endif // OUTBUF_H
@@ -0,0 +1,166 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "perfstat.h"
+#include "utils.h"
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+// Counters collected for every process, in report order
+typedef struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} PerfCounter;
+
+static const PerfCounter counters[] = {
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK,       "task-clock" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "context-switches" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS,   "cpu-migrations" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,      "page-faults" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions" },
+};
+
+#define NUM_COUNTERS (sizeof(counters) / sizeof(counters[0]))
+
+enum { TASK_CLOCK, CONTEXT_SWITCHES, CPU_MIGRATIONS, PAGE_FAULTS, CYCLES, INSTRUCTIONS };
+
+struct PerfStat {
+    int (*fds)[NUM_COUNTERS];  // One row per attached process, -1 = unavailable
+    int num_procs;
+    struct timespec start;
+};
+
+static int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd,
+                           unsigned long flags) {
+    return (int)syscall(SYS_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+// Start a counter set for a job
+PerfStat *perfstat_create(void) {
+    PerfStat *perf = calloc(1, sizeof(PerfStat));
+    if (!perf) {
+        perror("calloc");
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &perf->start);
+    return perf;
+}
+
+// Open the counters on a freshly forked process
+int perfstat_attach(PerfStat *perf, pid_t pid, int enable_on_exec) {
+    int (*fds)[NUM_COUNTERS] = realloc(perf->fds, (perf->num_procs + 1) * sizeof(*fds));
+    if (!fds) {
+        perror("realloc");
+        return -1;
+    }
+    perf->fds = fds;
+    int *row = fds[perf->num_procs++];
+
+    int opened = 0;
+    for (size_t i = 0; i < NUM_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counters[i].type;
+        attr.config = counters[i].config;
+        attr.inherit = 1;  // Count the job's children too
+        attr.disabled = enable_on_exec;
+        attr.enable_on_exec = enable_on_exec;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        row[i] = perf_event_open(&attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (row[i] == -1 && errno == EACCES) {
+            // perf_event_paranoid may still allow user-space-only counting
+            attr.exclude_kernel = 1;
+            row[i] = perf_event_open(&attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        }
+        if (row[i] != -1) {
+            opened++;
+        } else if (counters[i].type == PERF_TYPE_SOFTWARE && perf->num_procs == 1) {
+            // Missing hardware counters (VMs, containers) are expected and
+            // show as <not supported>; warn about software ones, once per job
+            fprintf(stderr, "myshell: perfstat: %s: %s\n", counters[i].name, strerror(errno));
+        }
+    }
+    return opened > 0 ? 0 : -1;
+}
+
+// Sum one counter over every process, scaled for multiplexing
+// Returns 0 on success, -1 if the counter is unavailable
+static int read_counter(const PerfStat *perf, size_t counter, double *value) {
+    int found = 0;
+    *value = 0;
+    for (int p = 0; p < perf->num_procs; p++) {
+        int fd = perf->fds[p][counter];
+        uint64_t data[3];  // value, time enabled, time running
+        if (fd == -1 || read(fd, data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        found = 1;
+        if (data[2] == 0) {
+            continue;  // Never scheduled on the PMU
+        }
+        double scaled = (double)data[0];
+        if (data[2] < data[1]) {
+            scaled *= (double)data[1] / data[2];
+        }
+        *value += scaled;
+    }
+    return found ? 0 : -1;
+}
+
+// Print the counter summary for a finished job
+void perfstat_report(const PerfStat *perf, const char *command) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - perf->start.tv_sec) +
+                     (end.tv_nsec - perf->start.tv_nsec) / 1e9;
+
+    double values[NUM_COUNTERS];
+    int available[NUM_COUNTERS];
+    for (size_t i = 0; i < NUM_COUNTERS; i++) {
+        available[i] = read_counter(perf, i, &values[i]) == 0;
+    }
+
+    fprintf(stderr, "\n Performance counter stats for '%s':\n\n", command);
+    for (size_t i = 0; i < NUM_COUNTERS; i++) {
+        if (!available[i]) {
+            fprintf(stderr, "   %16s      %s\n", "<not supported>", counters[i].name);
+            continue;
+        }
+        if (i == TASK_CLOCK) {
+            // task-clock counts nanoseconds
+            fprintf(stderr, "   %16.2f msec %-18s #  %6.3f CPUs utilized\n",
+                    values[i] / 1e6, counters[i].name,
+                    elapsed > 0 ? values[i] / 1e9 / elapsed : 0);
+        } else if (i == INSTRUCTIONS && available[CYCLES] && values[CYCLES] > 0) {
+            fprintf(stderr, "   %16.0f      %-18s #  %6.2f insn per cycle\n",
+                    values[i], counters[i].name, values[i] / values[CYCLES]);
+        } else {
+            fprintf(stderr, "   %16.0f      %s\n", values[i], counters[i].name);
+        }
+    }
+    fprintf(stderr, "\n   %16.9f seconds time elapsed\n\n", elapsed);
+}
+
+// Close the counters and free the set
+void perfstat_free(PerfStat *perf) {
+    if (!perf) {
+        return;
+    }
+    for (int p = 0; p < perf->num_procs; p++) {
+        for (size_t i = 0; i < NUM_COUNTERS; i++) {
+            if (perf->fds[p][i] != -1) {
+                close(perf->fds[p][i]);
+            }
+        }
+    }
+    free(perf->fds);
+    free(perf);
+}
@@ -0,0 +1,29 @@
+#ifndef PERFSTAT_H
+#define PERFSTAT_H
+
+#include <sys/types.h>
+
+// Performance counters for a job ("perfstat cmd ...")
+// Counters are opened with perf_event_open() on every process of the job's
+// pipeline and inherited by their children. Software counters (task-clock,
+// context switches, CPU migrations, page faults) are always available;
+// cycles and instructions only where the PMU can be used.
+typedef struct PerfStat PerfStat;
+
+// Start a counter set for a job (elapsed time is measured from here)
+// Returns the counter set, or NULL on error
+PerfStat *perfstat_create(void);
+
+// Open the counters on a freshly forked process that has not exec'd yet
+// With enable_on_exec the counters start at exec, otherwise immediately
+// (builtins run in a forked child never exec)
+// Returns 0 on success, -1 if no counter could be opened
+int perfstat_attach(PerfStat *perf, pid_t pid, int enable_on_exec);
+
+// Print the counter summary for a finished job to stderr
+void perfstat_report(const PerfStat *perf, const char *command);
+
+// Close the counters and free the set
+void perfstat_free(PerfStat *perf);
+
+#endif // PERFSTAT_H
@@ -0,0 +1,552 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "printfmt.h"
+#include "outbuf.h"
+#include "memacct.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdarg.h>
+
+#define FORMAT_CACHE_SIZE 64       // Compiled formats kept
+#define FORMAT_BUCKETS 128
+#define SPEC_SIZE 24               // "%" + 5 flags + "*.*" + "ll" + conv + NUL
+
+typedef enum {
+    OP_LITERAL,                    // Bytes of the compiled text
+    OP_INT,                        // d i
+    OP_UINT,                       // o u x X
+    OP_FLOAT,                      // e E f F g G a A
+    OP_STRING,                     // s, and c (precision 1)
+    OP_ESCAPED,                    // b: string with backslash escapes
+    OP_INVALID,                    // Unknown conversion: stop with an error
+} OpKind;
+
+typedef struct {
+    OpKind kind;
+    size_t start;                  // Literal: offset and length in text
+    size_t len;
+    int star_width;                // Width / precision taken from the arguments
+    int star_prec;
+    int width;                     // Fixed width (0 if none)
+    int prec;                      // Fixed precision (-1 if none)
+    char spec[SPEC_SIZE];          // C format, always "%<flags>*.*<length><conv>"
+} FormatOp;
+
+// A parsed format string, in a hash bucket and on the LRU list
+typedef struct Format {
+    char *key;
+    unsigned long hash;
+    char *text;                    // Literal bytes, escapes already processed
+    FormatOp *ops;
+    int num_ops;
+    int num_convs;                 // Conversions that consume arguments
+    struct Format *bucket_next;
+    struct Format *lru_prev;       // Most recently used first
+    struct Format *lru_next;
+} Format;
+
+static Format *buckets[FORMAT_BUCKETS];
+static Format *lru_head = NULL;
+static Format *lru_tail = NULL;
+static int num_cached = 0;
+
+static unsigned long hash_string(const char *s) {
+    unsigned long h = 14695981039346656037UL;  // FNV-1a
+    for (; *s; s++) {
+        h = (h ^ (unsigned char)*s) * 1099511628211UL;
+    }
+    return h;
+}
+
+static int is_octal(char c) {
+    return c >= '0' && c <= '7';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Decode the escape after a backslash at **p, advancing *p past it
+// In %b arguments octal escapes are \0NNN and \c stops all output
+// Returns the byte, or -1 for \c; an unknown escape yields the backslash
+// itself and leaves *p on the following character
+static int decode_escape(const char **p, int in_argument) {
+    const char *s = *p;
+    int value;
+    switch (*s) {
+        case '\\': value = '\\'; break;
+        case 'a':  value = '\a'; break;
+        case 'b':  value = '\b'; break;
+        case 'f':  value = '\f'; break;
+        case 'n':  value = '\n'; break;
+        case 'r':  value = '\r'; break;
+        case 't':  value = '\t'; break;
+        case 'v':  value = '\v'; break;
+        case '"':  value = '"';  break;
+        case '\'': value = '\''; break;
+        case 'c':
+            if (in_argument) {
+                *p = s + 1;
+                return -1;
+            }
+            return '\\';
+        case 'x':
+            if (hex_value(s[1]) < 0) {
+                return '\\';
+            }
+            value = hex_value(s[1]);
+            s++;
+            if (hex_value(s[1]) >= 0) {
+                value = value * 16 + hex_value(s[1]);
+                s++;
+            }
+            break;
+        default:
+            if (!is_octal(*s)) {
+                return '\\';
+            }
+            // Format: \N, \NN or \NNN; %b argument: \0 followed by up to three digits
+            if (in_argument && *s == '0') {
+                s++;
+                value = 0;
+                for (int i = 0; i < 3 && is_octal(*s); i++, s++) {
+                    value = value * 8 + (*s - '0');
+                }
+                *p = s;
+                return value & 0xff;
+            }
+            value = 0;
+            for (int i = 0; i < 3 && is_octal(*s); i++, s++) {
+                value = value * 8 + (*s - '0');
+            }
+            *p = s;
+            return value & 0xff;
+    }
+    *p = s + 1;
+    return value;
+}
+
+// Parse a width or precision written in the format
+static int parse_number(const char **p) {
+    long value = 0;
+    while (**p >= '0' && **p <= '9') {
+        if (value < INT_MAX) {
+            value = value * 10 + (**p - '0');
+        }
+        (*p)++;
+    }
+    return value > INT_MAX ? INT_MAX : (int)value;
+}
+
+// Parse one conversion after its '%' into op
+static void compile_conversion(const char **p, FormatOp *op) {
+    const char *s = *p;
+    char flags[6] = "";
+    int num_flags = 0;
+    while (*s && strchr("-+ #0", *s)) {
+        if (!strchr(flags, *s)) {
+            flags[num_flags++] = *s;
+            flags[num_flags] = '\0';
+        }
+        s++;
+    }
+
+    op->width = 0;
+    op->prec = -1;
+    if (*s == '*') {
+        op->star_width = 1;
+        s++;
+    } else {
+        op->width = parse_number(&s);
+    }
+    if (*s == '.') {
+        s++;
+        if (*s == '*') {
+            op->star_prec = 1;
+            s++;
+        } else {
+            op->prec = parse_number(&s);
+        }
+    }
+    while (*s && strchr("hlLjzt", *s)) {
+        s++;  // Length modifiers do not matter: arguments are strings
+    }
+
+    char conv = *s;
+    const char *length = "";
+    if (conv == '\0') {
+        op->kind = OP_INVALID;
+        *p = s;
+        return;
+    }
+    s++;
+    switch (conv) {
+        case 'd':
+        case 'i':
+            op->kind = OP_INT;
+            length = "ll";
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            op->kind = OP_UINT;
+            length = "ll";
+            break;
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            op->kind = OP_FLOAT;
+            length = "L";
+            break;
+        case 'c':
+            op->kind = OP_STRING;
+            op->star_prec = 0;
+            op->prec = 1;
+            conv = 's';
+            break;
+        case 's':
+            op->kind = OP_STRING;
+            break;
+        case 'b':
+            op->kind = OP_ESCAPED;
+            conv = 's';
+            break;
+        default:
+            op->kind = OP_INVALID;
+            op->start = (unsigned char)conv;  // Reported in the error
+            *p = s;
+            return;
+    }
+    snprintf(op->spec, sizeof(op->spec), "%%%s*.*%s%c", flags, length, conv);
+    *p = s;
+}
+
+static void free_format(Format *f) {
+    mem_free(MEM_CACHE, f->key);
+    mem_free(MEM_CACHE, f->text);
+    mem_free(MEM_CACHE, f->ops);
+    mem_free(MEM_CACHE, f);
+}
+
+// Parse a format string into literal runs and conversions
+// Returns NULL if out of memory
+static Format *compile_format(const char *format, unsigned long hash) {
+    size_t format_len = strlen(format);
+    Format *f = mem_calloc(MEM_CACHE, 1, sizeof(Format));
+    if (!f) {
+        return NULL;
+    }
+    f->hash = hash;
+    f->key = mem_strdup(MEM_CACHE, format);
+    f->text = mem_malloc(MEM_CACHE, format_len + 1);  // Escapes only shrink
+    f->ops = mem_calloc(MEM_CACHE, format_len + 1, sizeof(FormatOp));
+    if (!f->key || !f->text || !f->ops) {
+        free_format(f);
+        return NULL;
+    }
+
+    size_t text_len = 0;
+    const char *p = format;
+    while (*p) {
+        int literal = -1;
+        if (*p == '\\') {
+            p++;
+            literal = decode_escape(&p, 0);
+        } else if (*p == '%' && p[1] == '%') {
+            literal = '%';
+            p += 2;
+        } else if (*p == '%') {
+            p++;
+            FormatOp *op = &f->ops[f->num_ops++];
+            compile_conversion(&p, op);
+            if (op->kind != OP_INVALID) {
+                f->num_convs++;
+            }
+            continue;
+        } else {
+            literal = (unsigned char)*p++;
+        }
+
+        // Extend the previous literal run, or start one
+        FormatOp *last = f->num_ops > 0 ? &f->ops[f->num_ops - 1] : NULL;
+        if (!last || last->kind != OP_LITERAL) {
+            last = &f->ops[f->num_ops++];
+            last->kind = OP_LITERAL;
+            last->start = text_len;
+            last->len = 0;
+        }
+        f->text[text_len++] = (char)literal;
+        last->len++;
+    }
+    return f;
+}
+
+static void lru_unlink(Format *f) {
+    if (f->lru_prev) {
+        f->lru_prev->lru_next = f->lru_next;
+    } else {
+        lru_head = f->lru_next;
+    }
+    if (f->lru_next) {
+        f->lru_next->lru_prev = f->lru_prev;
+    } else {
+        lru_tail = f->lru_prev;
+    }
+    f->lru_prev = f->lru_next = NULL;
+}
+
+static void lru_push_front(Format *f) {
+    f->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = f;
+    }
+    lru_head = f;
+    if (!lru_tail) {
+        lru_tail = f;
+    }
+}
+
+// Drop the least recently used format
+static void evict_format(void) {
+    Format *f = lru_tail;
+    lru_unlink(f);
+    Format **link = &buckets[f->hash % FORMAT_BUCKETS];
+    while (*link != f) {
+        link = &(*link)->bucket_next;
+    }
+    *link = f->bucket_next;
+    free_format(f);
+    num_cached--;
+}
+
+// Cached compiled format for a format string, compiling it on a miss
+static Format *get_format(const char *format) {
+    unsigned long hash = hash_string(format);
+    Format **bucket = &buckets[hash % FORMAT_BUCKETS];
+    for (Format *f = *bucket; f; f = f->bucket_next) {
+        if (f->hash == hash && strcmp(f->key, format) == 0) {
+            if (f != lru_head) {
+                lru_unlink(f);
+                lru_push_front(f);
+            }
+            return f;
+        }
+    }
+
+    Format *f = compile_format(format, hash);
+    if (!f) {
+        return NULL;
+    }
+    if (num_cached == FORMAT_CACHE_SIZE) {
+        evict_format();
+    }
+    f->bucket_next = *bucket;
+    *bucket = f;
+    lru_push_front(f);
+    num_cached++;
+    return f;
+}
+
+// Format one conversion into the output buffer
+// Arguments after spec: width, precision, value
+static void emit(const char *spec, ...) {
+    char small[256];
+    va_list ap, retry;
+    va_start(ap, spec);
+    va_copy(retry, ap);
+    int n = vsnprintf(small, sizeof(small), spec, ap);
+    if (n >= (int)sizeof(small)) {
+        char *big = malloc(n + 1);
+        if (big) {
+            vsnprintf(big, n + 1, spec, retry);
+            out_write(big, n);
+            free(big);
+        }
+    } else if (n > 0) {
+        out_write(small, n);
+    }
+    va_end(retry);
+    va_end(ap);
+}
+
+// Numeric arguments: decimal, 0octal, 0xhex, or 'c / "c for a character code
+static int char_constant(const char *arg) {
+    return (arg[0] == '\'' || arg[0] == '"') && arg[1] != '\0';
+}
+
+static void number_error(const char *arg, int *status) {
+    fprintf(stderr, "myshell: printf: %s: %s\n", arg,
+            errno == ERANGE ? "Numerical result out of range" : "invalid number");
+    *status = 1;
+}
+
+static long long int_arg(const char *arg, int *status) {
+    if (!arg) {
+        return 0;
+    }
+    if (char_constant(arg)) {
+        return (unsigned char)arg[1];
+    }
+    char *end;
+    errno = 0;
+    long long value = strtoll(arg, &end, 0);
+    if (end == arg || *end != '\0' || errno == ERANGE) {
+        if (errno != ERANGE) {
+            errno = EINVAL;
+        }
+        number_error(arg, status);
+    }
+    return value;
+}
+
+static unsigned long long uint_arg(const char *arg, int *status) {
+    if (!arg) {
+        return 0;
+    }
+    if (char_constant(arg)) {
+        return (unsigned char)arg[1];
+    }
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(arg, &end, 0);
+    if (end == arg || *end != '\0' || errno == ERANGE) {
+        if (errno != ERANGE) {
+            errno = EINVAL;
+        }
+        number_error(arg, status);
+    }
+    return value;
+}
+
+static long double float_arg(const char *arg, int *status) {
+    if (!arg) {
+        return 0;
+    }
+    if (char_constant(arg)) {
+        return (unsigned char)arg[1];
+    }
+    char *end;
+    errno = 0;
+    long double value = strtold(arg, &end);
+    if (end == arg || *end != '\0') {
+        errno = EINVAL;
+        number_error(arg, status);
+    }
+    return value;
+}
+
+// Expand the escapes of a %b argument into out (at least strlen(arg) + 1)
+// Returns 1 if it ended with \c (stop printing), 0 otherwise
+static int expand_escapes(const char *arg, char *out) {
+    size_t n = 0;
+    const char *p = arg;
+    while (*p) {
+        if (*p != '\\') {
+            out[n++] = *p++;
+            continue;
+        }
+        p++;
+        int c = decode_escape(&p, 1);
+        if (c == -1) {
+            out[n] = '\0';
+            return 1;
+        }
+        out[n++] = (char)c;
+    }
+    out[n] = '\0';
+    return 0;
+}
+
+// Print every argument through one compiled format
+// Returns 0 on success, 1 on an invalid argument or format
+static int run_format(const Format *f, char **args) {
+    int status = 0;
+    char **arg = args;
+    do {
+        for (int i = 0; i < f->num_ops; i++) {
+            const FormatOp *op = &f->ops[i];
+            if (op->kind == OP_LITERAL) {
+                out_write(f->text + op->start, op->len);
+                continue;
+            }
+            if (op->kind == OP_INVALID) {
+                if (op->start) {
+                    fprintf(stderr, "myshell: printf: %%%c: invalid format character\n",
+                            (int)op->start);
+                } else {
+                    fprintf(stderr, "myshell: printf: missing format character\n");
+                }
+                return 1;
+            }
+
+            int width = op->width;
+            int prec = op->prec;
+            if (op->star_width) {
+                width = (int)int_arg(*arg, &status);
+                arg += *arg != NULL;
+            }
+            if (op->star_prec) {
+                prec = (int)int_arg(*arg, &status);
+                arg += *arg != NULL;
+            }
+            const char *value = *arg;
+            arg += *arg != NULL;
+
+            switch (op->kind) {
+                case OP_INT:
+                    emit(op->spec, width, prec, int_arg(value, &status));
+                    break;
+                case OP_UINT:
+                    emit(op->spec, width, prec, uint_arg(value, &status));
+                    break;
+                case OP_FLOAT:
+                    emit(op->spec, width, prec, float_arg(value, &status));
+                    break;
+                case OP_STRING:
+                    emit(op->spec, width, prec, value ? value : "");
+                    break;
+                case OP_ESCAPED: {
+                    const char *s = value ? value : "";
+                    char *expanded = malloc(strlen(s) + 1);
+                    if (!expanded) {
+                        perror("myshell: printf: malloc");
+                        return 1;
+                    }
+                    int stop = expand_escapes(s, expanded);
+                    emit(op->spec, width, prec, expanded);
+                    free(expanded);
+                    if (stop) {
+                        return status;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        // The format is reused while it consumes arguments and some remain
+    } while (f->num_convs > 0 && *arg != NULL && arg != args);
+
+    return status;
+}
+
+// Print args through format (see printfmt.h)
+int format_print(const char *format, char **args) {
+    Format *f = get_format(format);
+    if (!f) {
+        perror("myshell: printf");
+        return 1;
+    }
+    return run_format(f, args);
+}
@@ -0,0 +1,14 @@
+#ifndef PRINTFMT_H
+#define PRINTFMT_H
+
+// The printf builtin: printf FORMAT [ARGUMENT ...]
+// Supports the POSIX conversions (d i o u x X c s b e E f F g G a A %)
+// with flags, width and precision (also as *), backslash escapes in
+// FORMAT and in %b arguments, and reuse of FORMAT while arguments remain.
+// Parsed formats are kept in an LRU cache keyed by the format string, so
+// printing many lines with one format parses it once.
+// Output goes to the builtin output buffer (outbuf.h); the caller flushes.
+// Returns 0 on success, 1 if an argument or the format was invalid
+int format_print(const char *format, char **args);
+
+#endif // PRINTFMT_H
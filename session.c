@@ -0,0 +1,314 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "session.h"
+#include "memacct.h"
+#include "sysacct.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define SESSION_MAGIC "MYSHREC"
+#define SESSION_VERSION 1
+#define SESSION_HEADER_SIZE 8
+#define MAX_VARINT_BYTES 10
+#define LATE_THRESHOLD_US 1000     // Paced lines starting later than this count as late
+
+// Recording
+static int record_fd = -1;
+static uint64_t last_record_us;
+
+// Replay
+static int replaying = 0;
+static int paced = 0;
+static pid_t replay_pid;           // Only the shell prints the summary
+static const char *replay_path;
+static unsigned char *log_data;    // Whole recording, read up front
+static size_t log_size;
+static size_t log_pos;
+static uint64_t replay_start_us;
+static uint64_t schedule_us;       // Recorded time of the current line
+static uint64_t handed_out_us;     // When the current line was returned
+static double *latencies;          // Per line, microseconds
+static size_t num_latencies;
+static size_t latency_capacity;
+static unsigned long late_lines;
+static uint64_t max_lag_us;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+// Encode value as an unsigned LEB128 varint
+// Returns the number of bytes written
+static size_t put_varint(unsigned char *out, uint64_t value) {
+    size_t n = 0;
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        out[n++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return n;
+}
+
+// Decode a varint at log_pos
+// Returns 0 on success, -1 if the log ends inside it
+static int get_varint(uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (log_pos >= log_size) {
+            return -1;
+        }
+        unsigned char byte = log_data[log_pos++];
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Write all of buf to the recording
+static int write_all(const unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(record_fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Start appending input lines to a new recording at path
+int session_record_start(const char *path) {
+    record_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (record_fd == -1) {
+        fprintf(stderr, "myshell: --record: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    unsigned char header[SESSION_HEADER_SIZE];
+    memcpy(header, SESSION_MAGIC, 7);
+    header[7] = SESSION_VERSION;
+    if (write_all(header, sizeof(header)) == -1) {
+        fprintf(stderr, "myshell: --record: %s: %s\n", path, strerror(errno));
+        close(record_fd);
+        record_fd = -1;
+        return -1;
+    }
+    last_record_us = now_us();
+    return 0;
+}
+
+// Add one input line (without its newline) to the recording, if any
+void session_record_line(const char *line, size_t len) {
+    if (record_fd == -1) {
+        return;
+    }
+    uint64_t now = now_us();
+    unsigned char prefix[2 * MAX_VARINT_BYTES];
+    size_t n = put_varint(prefix, now - last_record_us);
+    n += put_varint(prefix + n, len);
+    last_record_us = now;
+
+    // One write per line, so a killed shell leaves whole records behind
+    unsigned char stack_buf[512];
+    unsigned char *record = n + len <= sizeof(stack_buf) ? stack_buf : malloc(n + len);
+    if (!record) {
+        perror("myshell: --record: malloc");
+        return;
+    }
+    memcpy(record, prefix, n);
+    memcpy(record + n, line, len);
+    if (write_all(record, n + len) == -1) {
+        perror("myshell: --record");
+        close(record_fd);
+        record_fd = -1;  // Stop recording rather than write a torn log
+    }
+    if (record != stack_buf) {
+        free(record);
+    }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Close the latency of the line handed out last
+static void finish_line(void) {
+    if (handed_out_us == 0) {
+        return;
+    }
+    if (num_latencies == latency_capacity) {
+        size_t capacity = latency_capacity ? latency_capacity * 2 : 1024;
+        double *grown = realloc(latencies, capacity * sizeof(double));
+        if (!grown) {
+            return;
+        }
+        latencies = grown;
+        latency_capacity = capacity;
+    }
+    latencies[num_latencies++] = now_us() - handed_out_us;
+    handed_out_us = 0;
+}
+
+// Print the replay summary to stderr (at exit, also after "exit")
+static void finish_replay(void) {
+    if (!replaying || getpid() != replay_pid) {
+        return;  // Forked children exit through here too
+    }
+    replaying = 0;
+    finish_line();
+
+    double elapsed = (now_us() - replay_start_us) / 1e6;
+    fprintf(stderr, "\nreplay: %s: %zu lines in %.3f s (%.1f lines/s, %s)\n", replay_path,
+            num_latencies, elapsed, elapsed > 0 ? num_latencies / elapsed : 0.0,
+            paced ? "paced" : "as fast as possible");
+
+    if (num_latencies > 0) {
+        double sum = 0;
+        for (size_t i = 0; i < num_latencies; i++) {
+            sum += latencies[i];
+        }
+        qsort(latencies, num_latencies, sizeof(double), compare_doubles);
+        size_t n = num_latencies;
+        fprintf(stderr, "latency: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, "
+                "max %.3f ms\n",
+                sum / n / 1e3, latencies[n / 2] / 1e3, latencies[n * 95 / 100] / 1e3,
+                latencies[n * 99 / 100] / 1e3, latencies[n - 1] / 1e3);
+    }
+    if (paced) {
+        fprintf(stderr, "pacing: %lu lines started over 1 ms late, max lag %.3f ms\n", late_lines,
+                max_lag_us / 1e3);
+    }
+    const MemStats *mem = mem_total_stats();
+    fprintf(stderr, "memory: %zu bytes in use, peak %zu bytes (tracked subsystems)\n",
+            mem->current, mem->peak);
+    if (sysacct_enabled()) {
+        fflush(stdout);
+        sysacct_report();
+    }
+
+    free(latencies);
+    free(log_data);
+}
+
+// Start replaying the recording at path (paced: keep the recorded delays)
+int session_replay_start(const char *path, int pace) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        fprintf(stderr, "myshell: --replay: %s: %s\n", path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // Read it all now, so replay itself does no file I/O
+    log_size = st.st_size;
+    log_data = malloc(log_size ? log_size : 1);
+    size_t got = 0;
+    while (log_data && got < log_size) {
+        ssize_t n = read(fd, log_data + got, log_size - got);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        got += n;
+    }
+    close(fd);
+    if (!log_data || got != log_size) {
+        fprintf(stderr, "myshell: --replay: %s: read failed\n", path);
+        free(log_data);
+        log_data = NULL;
+        return -1;
+    }
+
+    if (log_size < SESSION_HEADER_SIZE || memcmp(log_data, SESSION_MAGIC, 7) != 0) {
+        fprintf(stderr, "myshell: --replay: %s: not a session recording\n", path);
+        free(log_data);
+        log_data = NULL;
+        return -1;
+    }
+    if (log_data[7] != SESSION_VERSION) {
+        fprintf(stderr, "myshell: --replay: %s: unsupported version %d\n", path, log_data[7]);
+        free(log_data);
+        log_data = NULL;
+        return -1;
+    }
+
+    log_pos = SESSION_HEADER_SIZE;
+    replay_path = path;
+    paced = pace;
+    replaying = 1;
+    replay_pid = getpid();
+    replay_start_us = now_us();
+    schedule_us = 0;
+    atexit(finish_replay);
+    return 0;
+}
+
+int session_replaying(void) {
+    return replaying;
+}
+
+// Next replayed line, like getline() (no newline is stored)
+ssize_t session_replay_line(char **line, size_t *size) {
+    finish_line();
+    if (log_pos >= log_size) {
+        return -1;
+    }
+
+    uint64_t delay, len;
+    if (get_varint(&delay) == -1 || get_varint(&len) == -1 || len > log_size - log_pos) {
+        fprintf(stderr, "myshell: --replay: %s: truncated record\n", replay_path);
+        log_pos = log_size;
+        return -1;
+    }
+    schedule_us += delay;
+
+    if (*size < len + 1) {
+        char *grown = realloc(*line, len + 1);
+        if (!grown) {
+            perror("realloc");
+            return -1;
+        }
+        *line = grown;
+        *size = len + 1;
+    }
+    memcpy(*line, log_data + log_pos, len);
+    (*line)[len] = '\0';
+    log_pos += len;
+
+    if (paced) {
+        uint64_t due = replay_start_us + schedule_us;
+        uint64_t now = now_us();
+        if (now < due) {
+            struct timespec ts = { (due - now) / 1000000, (due - now) % 1000000 * 1000 };
+            while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+            }
+        } else if (now - due > LATE_THRESHOLD_US) {
+            // The shell is slower than the recorded session was
+            late_lines++;
+            if (now - due > max_lag_us) {
+                max_lag_us = now - due;
+            }
+        }
+    }
+
+    handed_out_us = now_us();
+    return (ssize_t)len;
+}
@@ -0,0 +1,33 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <sys/types.h>
+
+// Session recording and replay (--record FILE, --replay FILE [--paced])
+// A recording holds every input line with the time since the previous one,
+// in a compact binary log:
+//   header   "MYSHREC" + version byte (1)
+//   record   varint delay (microseconds), varint length, line bytes
+// Varints are unsigned LEB128. Replay feeds the lines back to the REPL
+// instead of stdin, as fast as possible or at the recorded pace, and
+// prints a latency summary to stderr when the shell exits.
+
+// Start appending input lines to a new recording at path
+// Returns 0 on success, -1 on error
+int session_record_start(const char *path);
+
+// Add one input line (without its newline) to the recording, if any
+void session_record_line(const char *line, size_t len);
+
+// Start replaying the recording at path (paced: keep the recorded delays)
+// Returns 0 on success, -1 on error
+int session_replay_start(const char *path, int paced);
+
+// Returns 1 if input comes from a replayed recording
+int session_replaying(void);
+
+// Next replayed line, like getline() (no newline is stored)
+// Returns the line length, or -1 at the end of the recording or on error
+ssize_t session_replay_line(char **line, size_t *size);
+
+#endif // SESSION_H
@@ -1,166 +1,287 @@
-// Feature test macros must be defined before any includes
-#define _POSIX_C_SOURCE 200809L
-#define _GNU_SOURCE
-
-#include "utils.h"
-#include "parser.h"
-#include "executor.h"
-#include "jobs.h"
-#include "signals.h"
-#include "history.h"
-
-// Flag to track if we should continue running
-static volatile int running = 1;
-
-int main(void) {
-    char *input = NULL;
-    size_t input_size = 0;
-    ssize_t nread;
-
-    // Initialize job table
-    init_jobs();
-    
-    // Initialize history
-    init_history();
-    
-    // Initialize signal handlers
-    init_signals();
-    
-    // Put shell in its own process group
-    setpgid(0, 0);
-    
-    // Set shell as foreground process group
-    if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-        // Ignore error if not a terminal
-    }
-
-    // Main REPL loop
-    while (running) {
-        // Clean up finished jobs before showing prompt
-        cleanup_jobs();
-        
-        // Ensure shell's process group is foreground (important for getline)
-        if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-            // Ignore error if not a terminal
-        }
-        
-        // Display prompt
-        printf("myshell> ");
-        fflush(stdout);
-
-        // Read input using getline (handles long lines automatically)
-        // getline may be interrupted by signals - retry on EINTR
-        nread = getline(&input, &input_size, stdin);
-        
-        // Handle EOF (Ctrl+D)
-        if (nread == -1) {
-            if (feof(stdin)) {
-                // EOF - exit gracefully
-                printf("\n");
-                break;
-            } else if (errno == EINTR) {
-                // Interrupted by signal - clear error, restore foreground, and retry
-                clearerr(stdin);
-                // Ensure shell is still foreground
-                if (tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
-                    // Ignore error if not a terminal
-                }
-                continue;  // Retry getline
-            } else {
-                perror("getline");
-                continue;
-            }
-        }
-
-        // Remove newline if present
-        if (nread > 0 && input[nread - 1] == '\n') {
-            input[nread - 1] = '\0';
-            nread--;
-        }
-
-        // Skip empty input
-        if (nread == 0) {
-            continue;
-        }
-
-        // Add to history (before processing, but after removing newline)
-        add_to_history(input);
-
-        // Tokenize input
-        char **tokens = NULL;
-        int token_count = tokenize(input, &tokens);
-
-        if (token_count < 0) {
-            fprintf(stderr, "myshell: tokenization error\n");
-            continue;
-        }
-
-        if (token_count == 0) {
-            // Empty line after tokenization
-            free_tokens(tokens, 0);
-            continue;
-        }
-
-        // Check if there are pipes
-        int has_pipe = 0;
-        for (int i = 0; tokens[i] != NULL; i++) {
-            if (strcmp(tokens[i], "|") == 0) {
-                has_pipe = 1;
-                break;
-            }
-        }
-
-        if (has_pipe) {
-            // Parse and execute pipeline
-            Pipeline pipeline;
-            if (parse_pipeline(tokens, &pipeline) == -1) {
-                // Error already printed by parse_pipeline
-                free_tokens(tokens, token_count);
-                continue;
-            }
-
-            // Execute pipeline
-            (void)execute_pipeline(&pipeline);  // Status ignored for now
-
-            // Check if exit command was executed (check first command)
-            if (pipeline.num_commands > 0 && 
-                pipeline.commands[0].argv && 
-                pipeline.commands[0].argv[0] && 
-                strcmp(pipeline.commands[0].argv[0], "exit") == 0) {
-                // exit command will have already called exit(), but just in case
-                running = 0;
-            }
-
-            // Free pipeline and tokens
-            free_pipeline(&pipeline);
-            free_tokens(tokens, token_count);
-        } else {
-            // Parse command with redirections (no pipes)
-            Command cmd;
-            if (parse_command(tokens, &cmd) == -1) {
-                // Error already printed by parse_command
-                free_tokens(tokens, token_count);
-                continue;
-            }
-
-            // Execute command
-            (void)execute_command(&cmd);  // Status ignored for now
-
-            // Check if exit command was executed
-            if (cmd.argv && cmd.argv[0] && strcmp(cmd.argv[0], "exit") == 0) {
-                // exit command will have already called exit(), but just in case
-                running = 0;
-            }
-
-            // Free command and tokens
-            free_command(&cmd);
-            free_tokens(tokens, token_count);
-        }
-    }
-
-    // Clean up
-    free(input);
-
-    return 0;
-}
-
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "utils.h"
+#include "parser.h"
+#include "executor.h"
+#include "jobs.h"
+#include "signals.h"
+#include "history.h"
+#include "eventloop.h"
+#include "jobqueue.h"
+#include "ulimit.h"
+#include "trace.h"
+#include "sysacct.h"
+#include "metrics.h"
+#include "session.h"
+#include "slo.h"
+#include "linebuf.h"
+
+// Flag to track if we should continue running
+static volatile int running = 1;
+
+// Parse command-line options: --record FILE, --replay FILE [--paced]
+// Returns 0 on success, -1 on error (message already printed)
+static int parse_options(int argc, char **argv) {
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    int paced = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--paced") == 0) {
+            paced = 1;
+        } else {
+            fprintf(stderr, "myshell: %s: invalid option\n"
+                    "usage: myshell [--record FILE] [--replay FILE [--paced]]\n", argv[i]);
+            return -1;
+        }
+    }
+    if (paced && !replay_path) {
+        fprintf(stderr, "myshell: --paced needs --replay\n");
+        return -1;
+    }
+
+    if (replay_path && session_replay_start(replay_path, paced) == -1) {
+        return -1;
+    }
+    if (record_path && session_record_start(record_path) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    char *input = NULL;
+    size_t input_size = 0;
+    ssize_t nread;
+
+    // Record or replay a session if asked to
+    if (parse_options(argc, argv) == -1) {
+        return 2;
+    }
+    int replaying = session_replaying();
+
+    // Raise the open file limit if MYSHELL_NOFILE asks for it
+    init_nofile_limit();
+
+    // Start event tracing if MYSHELL_TRACE_FILE is set
+    init_trace();
+
+    // Start syscall accounting if MYSHELL_SYSCALL_STATS is set
+    init_sysacct();
+
+    // Start exporting metrics if MYSHELL_METRICS_FILE or _SOCKET is set
+    init_metrics();
+
+    // Start the latency watchdog if MYSHELL_SLO_MS is set
+    init_slo();
+
+    // Initialize job table
+    init_jobs();
+
+    // Initialize job queue
+    init_jobqueue();
+    
+    // Initialize history
+    init_history();
+
+    // Remember the command input, which the read builtin shares with getline
+    init_linebuf();
+    
+    // Initialize event loop (before signals, which register with it)
+    init_event_loop();
+
+    // Initialize signal handlers
+    init_signals();
+    
+    // Put shell in its own process group
+    sysacct_setpgid(0, 0);
+    
+    // Set shell as foreground process group
+    if (sysacct_tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+        // Ignore error if not a terminal
+    }
+
+    // Main REPL loop
+    while (running) {
+        sysacct_set_phase(PHASE_PROMPT);
+
+        // Collect exited children, then clean up finished jobs before showing prompt
+        reap_children();
+        cleanup_jobs();
+        metrics_set_gauges(count_jobs(JOB_RUNNING), count_jobs(JOB_STOPPED),
+                           get_history_count());
+        
+        // Ensure shell's process group is foreground (important for getline)
+        if (sysacct_tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+            // Ignore error if not a terminal
+        }
+        
+        // The previous line's shell-internal work ends here
+        slo_line_end();
+
+        // Replayed sessions run in batch mode: no prompt, no stdin
+        if (replaying) {
+            nread = session_replay_line(&input, &input_size);
+            if (nread == -1) {
+                break;  // End of the recording
+            }
+        } else {
+            // Display prompt
+            printf("myshell> ");
+            fflush(stdout);
+
+            // Keep background work (reaping, output capture) going while idle
+            // Only for terminals: a tty read returns one line at a time, so
+            // nothing is left sitting in stdin's buffer when we poll
+            if (isatty(STDIN_FILENO)) {
+                event_wait_fd(STDIN_FILENO);
+            }
+
+            // Read input using getline (handles long lines automatically)
+            // getline may be interrupted by signals - retry on EINTR
+            nread = getline(&input, &input_size, stdin);
+
+            // Handle EOF (Ctrl+D)
+            if (nread == -1) {
+                if (feof(stdin)) {
+                    // EOF - exit gracefully
+                    printf("\n");
+                    break;
+                } else if (errno == EINTR) {
+                    // Interrupted by signal - clear error, restore foreground, and retry
+                    clearerr(stdin);
+                    // Ensure shell is still foreground
+                    if (sysacct_tcsetpgrp(STDIN_FILENO, getpgrp()) == -1) {
+                        // Ignore error if not a terminal
+                    }
+                    continue;  // Retry getline
+                } else {
+                    perror("getline");
+                    continue;
+                }
+            }
+        }
+
+        // Remove newline if present
+        if (nread > 0 && input[nread - 1] == '\n') {
+            input[nread - 1] = '\0';
+            nread--;
+        }
+
+        session_record_line(input, nread);
+
+        // Skip empty input
+        if (nread == 0) {
+            continue;
+        }
+
+        slo_line_start(input, nread);
+
+        // Add to history (before processing, but after removing newline)
+        add_to_history(input);
+
+        // Tokenize input
+        sysacct_set_phase(PHASE_PARSE);
+        sysacct_command_done();
+        metrics_input_line();
+        trace_instant("command", input);
+        trace_begin("tokenize", NULL);
+        char **tokens = NULL;
+        int token_count = tokenize(input, &tokens);
+        trace_end("tokenize");
+
+        if (token_count < 0) {
+            fprintf(stderr, "myshell: tokenization error\n");
+            metrics_parse_error();
+            continue;
+        }
+
+        if (token_count == 0) {
+            // Empty line after tokenization
+            free_tokens(tokens, 0);
+            continue;
+        }
+
+        // Check if there are pipes
+        int has_pipe = 0;
+        for (int i = 0; tokens[i] != NULL; i++) {
+            if (strcmp(tokens[i], "|") == 0) {
+                has_pipe = 1;
+                break;
+            }
+        }
+
+        if (has_pipe) {
+            // Parse and execute pipeline
+            Pipeline pipeline;
+            trace_begin("parse", NULL);
+            int parsed = parse_pipeline(tokens, &pipeline);
+            trace_end("parse");
+            if (parsed == -1) {
+                // Error already printed by parse_pipeline
+                metrics_parse_error();
+                free_tokens(tokens, token_count);
+                continue;
+            }
+
+            // Execute pipeline
+            sysacct_set_phase(PHASE_EXECUTE);
+            trace_begin("execute", NULL);
+            (void)execute_pipeline(&pipeline);  // Status ignored for now
+            trace_end("execute");
+
+            // Check if exit command was executed (check first command)
+            if (pipeline.num_commands > 0 && 
+                pipeline.commands[0].argv && 
+                pipeline.commands[0].argv[0] && 
+                strcmp(pipeline.commands[0].argv[0], "exit") == 0) {
+                // exit command will have already called exit(), but just in case
+                running = 0;
+            }
+
+            // Free pipeline and tokens
+            free_pipeline(&pipeline);
+            free_tokens(tokens, token_count);
+        } else {
+            // Parse command with redirections (no pipes)
+            Command cmd;
+            trace_begin("parse", NULL);
+            int parsed = parse_command(tokens, &cmd);
+            trace_end("parse");
+            if (parsed == -1) {
+                // Error already printed by parse_command
+                metrics_parse_error();
+                free_tokens(tokens, token_count);
+                continue;
+            }
+
+            // Execute command
+            sysacct_set_phase(PHASE_EXECUTE);
+            trace_begin("execute", NULL);
+            (void)execute_command(&cmd);  // Status ignored for now
+            trace_end("execute");
+
+            // Check if exit command was executed
+            if (cmd.argv && cmd.argv[0] && strcmp(cmd.argv[0], "exit") == 0) {
+                // exit command will have already called exit(), but just in case
+                running = 0;
+            }
+
+            // Free command and tokens
+            free_command(&cmd);
+            free_tokens(tokens, token_count);
+        }
+    }
+
+    // Clean up
+    free(input);
+
+    return 0;
+}
+
@@ -1,97 +1,221 @@
-// Feature test macros must be defined before any includes
-#define _POSIX_C_SOURCE 200809L
-#define _GNU_SOURCE
-
-#include "signals.h"
-#include "jobs.h"
-#include "utils.h"
-#include <signal.h>
-#include <sys/wait.h>
-
-// SIGCHLD handler - reap zombie processes
-static void sigchld_handler(int sig) {
-    (void)sig; // Unused parameter
-    
-    int status;
-    pid_t pid;
-    
-    // Reap all zombie processes
-    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED)) > 0) {
-        // Get process group ID of the process
-        pid_t pgid = getpgid(pid);
-        if (pgid == -1) {
-            continue;
-        }
-        
-        // Find job by process group
-        // Only process jobs that are in the job table (background/stopped jobs)
-        // Foreground processes should be waited for by the executor, not the handler
-        Job *job = find_job_by_pgid(pgid);
-        if (!job) {
-            // Not a background/stopped job - skip it
-            // The executor will handle waiting for foreground processes
-            continue;
-        }
-        
-        if (WIFSTOPPED(status)) {
-            // Process was stopped (Ctrl+Z)
-            update_job_status_by_pgid(pgid, JOB_STOPPED);
-            printf("\n[%d]+  Stopped    %s\n", job->job_id, job->command);
-            fflush(stdout);
-        } else if (WIFEXITED(status) || WIFSIGNALED(status)) {
-            // Process finished - mark as done
-            // Only update status, don't remove yet (let jobs command show it)
-            update_job_status_by_pgid(pgid, JOB_DONE);
-        }
-    }
-}
-
-// SIGTSTP handler - Note: SIGTSTP cannot be reliably caught/ignored
-// It will always suspend the process. We set it to SIG_IGN to try to ignore it
-// when the shell is in foreground, but this may not work on all systems.
-// The standard approach is to ensure shell is foreground when waiting for input.
-
-// SIGINT handler - kill foreground process
-static void sigint_handler(int sig) {
-    (void)sig; // Unused parameter
-    
-    // Get foreground process group
-    pid_t fg_pgid = tcgetpgrp(STDIN_FILENO);
-    if (fg_pgid == -1) {
-        return;  // No foreground process
-    }
-    
-    // Don't kill the shell itself
-    if (fg_pgid == getpgrp()) {
-        return;
-    }
-    
-    // Send SIGINT to foreground process group
-    kill(-fg_pgid, SIGINT);
-}
-
-// Initialize signal handlers
-void init_signals(void) {
-    struct sigaction sa;
-    
-    // SIGCHLD - reap zombies
-    sa.sa_handler = sigchld_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-    sigaction(SIGCHLD, &sa, NULL);
-    
-    // SIGTSTP - suspend (Ctrl+Z)
-    // Try to ignore SIGTSTP in the shell (may not work on all systems)
-    // The key is ensuring shell is foreground when waiting for input
-    sa.sa_handler = SIG_IGN;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGTSTP, &sa, NULL);
-    
-    // SIGINT - interrupt (Ctrl+C)
-    sa.sa_handler = sigint_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART;  // Restart interrupted system calls
-    sigaction(SIGINT, &sa, NULL);
-}
-
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "signals.h"
+#include "jobs.h"
+#include "eventloop.h"
+#include "jobqueue.h"
+#include "trace.h"
+#include "perfstat.h"
+#include "sysacct.h"
+#include "utils.h"
+#include <signal.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <strings.h>
+
+// Self-pipe used to turn SIGCHLD into a readable file descriptor
+static int sigchld_pipe[2] = {-1, -1};
+
+// Set when SIGINT arrives while the shell itself is in the foreground
+static volatile sig_atomic_t interrupted = 0;
+
+// SIGCHLD handler - notify the main loop
+// Reaping happens in reap_children(), outside signal context, so the
+// job table is never modified asynchronously
+static void sigchld_handler(int sig) {
+    (void)sig; // Unused parameter
+
+    int saved_errno = errno;
+    if (sigchld_pipe[1] != -1) {
+        // Pipe is non-blocking - if it is full a wakeup is already pending
+        ssize_t ret = write(sigchld_pipe[1], "c", 1);
+        (void)ret;
+    }
+    errno = saved_errno;
+}
+
+// Event loop callback for the notification pipe
+static void sigchld_readable(int fd, void *data) {
+    (void)fd;
+    (void)data;
+    reap_children();
+}
+
+// SIGTSTP handler - Note: SIGTSTP cannot be reliably caught/ignored
+// It will always suspend the process. We set it to SIG_IGN to try to ignore it
+// when the shell is in foreground, but this may not work on all systems.
+// The standard approach is to ensure shell is foreground when waiting for input.
+
+// SIGINT handler - kill foreground process
+static void sigint_handler(int sig) {
+    (void)sig; // Unused parameter
+    
+    // Get foreground process group
+    pid_t fg_pgid = tcgetpgrp(STDIN_FILENO);
+    if (fg_pgid == -1) {
+        return;  // No foreground process
+    }
+    
+    // Don't kill the shell itself
+    if (fg_pgid == getpgrp()) {
+        interrupted = 1;
+        return;
+    }
+    
+    // Send SIGINT to foreground process group
+    kill(-fg_pgid, SIGINT);
+}
+
+// Initialize signal handlers
+void init_signals(void) {
+    struct sigaction sa;
+
+    // Notification pipe for SIGCHLD (close-on-exec so children never see it)
+    if (pipe2(sigchld_pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+        perror("myshell: pipe2");
+        sigchld_pipe[0] = sigchld_pipe[1] = -1;
+    } else {
+        event_add_fd(sigchld_pipe[0], sigchld_readable, NULL);
+    }
+    
+    // SIGCHLD - wake the main loop (stops are reported too, for Ctrl+Z)
+    sa.sa_handler = sigchld_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGCHLD, &sa, NULL);
+    
+    // SIGTSTP - suspend (Ctrl+Z)
+    // Try to ignore SIGTSTP in the shell (may not work on all systems)
+    // The key is ensuring shell is foreground when waiting for input
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGTSTP, &sa, NULL);
+    
+    // SIGTTOU/SIGTTIN - the shell calls tcsetpgrp() while a job owns the
+    // terminal; without ignoring these it would stop itself
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGTTOU, &sa, NULL);
+    sigaction(SIGTTIN, &sa, NULL);
+
+    // SIGINT - interrupt (Ctrl+C)
+    sa.sa_handler = sigint_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;  // Restart interrupted system calls
+    sigaction(SIGINT, &sa, NULL);
+}
+
+
+// Restore default signal dispositions in a child before it runs a job
+void reset_child_signals(void) {
+    // Ignored dispositions survive exec, so Ctrl+Z would otherwise never
+    // stop a job; handlers are replaced for builtins running in the child
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+}
+
+// Get the read end of the SIGCHLD notification pipe
+int get_sigchld_fd(void) {
+    return sigchld_pipe[0];
+}
+
+// Record a child's state change in the trace
+static void trace_child_status(pid_t pid, int status) {
+    char detail[32];
+    if (WIFSTOPPED(status)) {
+        snprintf(detail, sizeof(detail), "pid %d", (int)pid);
+        trace_instant("stop", detail);
+    } else if (WIFEXITED(status)) {
+        snprintf(detail, sizeof(detail), "exit %d", WEXITSTATUS(status));
+        trace_async_end("process", pid, detail);
+    } else if (WIFSIGNALED(status)) {
+        snprintf(detail, sizeof(detail), "signal %s", sigabbrev_np(WTERMSIG(status)));
+        trace_async_end("process", pid, detail);
+    }
+}
+
+// Reap all children that changed state and update the job table
+void reap_children(void) {
+    // Drain pending notifications first so a SIGCHLD that arrives while
+    // reaping leaves the pipe readable for the next wait
+    if (sigchld_pipe[0] != -1) {
+        char buf[64];
+        while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0) {
+            // Discard
+        }
+    }
+
+    int status;
+    pid_t pid;
+    while ((pid = sysacct_waitpid(-1, &status, WNOHANG | WUNTRACED)) > 0) {
+        trace_child_status(pid, status);
+
+        // Processes that belong to no job are simply reaped; the executor
+        // reports stops of the foreground job itself
+        Job *job = mark_process_status(pid, status);
+        if (job && job->job_id > 0 && WIFSTOPPED(status)) {
+            printf("\n[%d]+  Stopped    %s\n", job->job_id, job->command);
+            fflush(stdout);
+        } else if (job && job->job_id > 0 && job->status == JOB_DONE && job->timed_out) {
+            printf("\n[%d]   Timed out    %s\n", job->job_id, job->command);
+            fflush(stdout);
+        }
+
+        // Counter summary once the whole job has exited
+        if (job && job->job_id > 0 && job->status == JOB_DONE && job->perf) {
+            perfstat_report(job->perf, job->command);
+            perfstat_free(job->perf);
+            job->perf = NULL;
+        }
+    }
+
+    // Finished jobs free up room for queued ones
+    jobqueue_dispatch();
+}
+
+// Forget any SIGINT received before a blocking wait started
+void clear_interrupt(void) {
+    interrupted = 0;
+}
+
+// Block until the next event (child state change, job output, ...) is handled
+int wait_for_event(void) {
+    if (interrupted) {
+        interrupted = 0;
+        return -1;
+    }
+
+    if (event_run_once(-1) == -1 && interrupted) {
+        interrupted = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Parse a signal name or number
+int parse_signal(const char *name) {
+    if (name[0] >= '0' && name[0] <= '9') {
+        char *end;
+        long sig = strtol(name, &end, 10);
+        return (*end == '\0' && sig > 0 && sig < NSIG) ? (int)sig : -1;
+    }
+
+    if (strncasecmp(name, "SIG", 3) == 0) {
+        name += 3;
+    }
+    for (int sig = 1; sig < NSIG; sig++) {
+        const char *abbrev = sigabbrev_np(sig);
+        if (abbrev && strcasecmp(name, abbrev) == 0) {
+            return sig;
+        }
+    }
+    return -1;
+}
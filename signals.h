@@ -1,8 +1,30 @@
-#ifndef SIGNALS_H
-#define SIGNALS_H
-
-// Initialize signal handlers
-void init_signals(void);
-
-#endif // SIGNALS_H
-
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+// Initialize signal handlers
+void init_signals(void);
+
+// Restore default signal dispositions in a child before it runs a job
+void reset_child_signals(void);
+
+// Get the read end of the SIGCHLD notification pipe
+// Becomes readable whenever a child changes state
+int get_sigchld_fd(void);
+
+// Reap all children that changed state and update the job table
+// Must be called from the main loop, never from a signal handler
+void reap_children(void);
+
+// Forget any SIGINT received before a blocking wait started
+void clear_interrupt(void);
+
+// Block until the next event (child state change, job output, ...) is
+// handled by the event loop
+// Returns 0 on success, -1 if interrupted by SIGINT
+int wait_for_event(void);
+
+// Parse a signal name ("TERM", "SIGTERM") or number
+// Returns the signal number, or -1 if it is not a valid signal
+int parse_signal(const char *name);
+
+#endif // SIGNALS_H
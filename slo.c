@@ -0,0 +1,171 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "slo.h"
+#include "trace.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+
+#define INPUT_PREVIEW 200          // Bytes of input quoted in a log line
+
+// Phases a line is charged for, in the order they happen
+typedef enum {
+    SLO_HISTORY,           // Adding the line to history
+    SLO_PARSE,             // Tokenize (variable expansion, globs) and parse
+    SLO_EXECUTE,           // Builtins, redirections, forks and pipes
+    SLO_WAIT,              // Waiting for a foreground job (not charged)
+    SLO_REAP,              // Reaping and job cleanup before the next prompt
+    NUM_SLO_PHASES
+} SloPhase;
+
+static const char *const phase_names[NUM_SLO_PHASES] = {
+    "history", "parse", "execute", "wait", "reap",
+};
+
+// REPL phase to the phase it is charged as
+static const SloPhase repl_phases[NUM_PHASES] = {
+    [PHASE_PROMPT] = SLO_REAP,
+    [PHASE_PARSE] = SLO_PARSE,
+    [PHASE_EXECUTE] = SLO_EXECUTE,
+    [PHASE_WAIT] = SLO_WAIT,
+};
+
+static uint64_t budget_ns = 0;     // 0: watchdog off
+static int log_fd = STDERR_FILENO;
+static int in_line = 0;
+static SloPhase current;
+static uint64_t phase_start_ns;
+static uint64_t phase_ns[NUM_SLO_PHASES];
+static char input_preview[INPUT_PREVIEW + 1];
+static size_t input_len;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Enable the watchdog if MYSHELL_SLO_MS is set
+void init_slo(void) {
+    const char *value = getenv("MYSHELL_SLO_MS");
+    if (value == NULL || value[0] == '\0') {
+        return;
+    }
+    char *end;
+    double ms = strtod(value, &end);
+    if (*end != '\0' || !(ms > 0)) {
+        fprintf(stderr, "myshell: MYSHELL_SLO_MS: %s: invalid threshold\n", value);
+        return;
+    }
+
+    const char *path = getenv("MYSHELL_SLO_LOG");
+    if (path && path[0] != '\0') {
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            fprintf(stderr, "myshell: MYSHELL_SLO_LOG: %s: %s\n", path, strerror(errno));
+        } else {
+            log_fd = fd;
+        }
+    }
+    budget_ns = (uint64_t)(ms * 1e6);
+}
+
+// Start timing a line that was just read
+void slo_line_start(const char *input, size_t len) {
+    if (budget_ns == 0) {
+        return;
+    }
+    // Keep a printable copy; the input buffer is reused by the time we log
+    size_t n = len < INPUT_PREVIEW ? len : INPUT_PREVIEW;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = input[i];
+        input_preview[i] = c < 0x20 || c == 0x7f ? '?' : (char)c;
+    }
+    input_preview[n] = '\0';
+    input_len = len;
+
+    memset(phase_ns, 0, sizeof(phase_ns));
+    current = SLO_HISTORY;
+    phase_start_ns = now_ns();
+    in_line = 1;
+}
+
+// Follow a REPL phase change (called by sysacct_set_phase)
+void slo_set_phase(ReplPhase phase) {
+    if (!in_line) {
+        return;
+    }
+    uint64_t now = now_ns();
+    phase_ns[current] += now - phase_start_ns;
+    phase_start_ns = now;
+    current = repl_phases[phase];
+}
+
+// Write one over-budget report
+static void report(uint64_t charged_ns, SloPhase slowest) {
+    char line[1024];
+    int len = 0;
+    if (log_fd != STDERR_FILENO) {
+        // Log files get a wall-clock timestamp and the shell's pid
+        time_t now = time(NULL);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        len = strftime(line, sizeof(line), "%Y-%m-%dT%H:%M:%S ", &tm);
+        len += snprintf(line + len, sizeof(line) - len, "myshell[%d]: ", (int)getpid());
+    } else {
+        len = snprintf(line, sizeof(line), "myshell: ");
+    }
+
+    len += snprintf(line + len, sizeof(line) - len,
+                    "slo: %.3f ms over %.3f ms budget, %s ran longest (",
+                    charged_ns / 1e6, budget_ns / 1e6, phase_names[slowest]);
+    for (int i = 0; i < NUM_SLO_PHASES; i++) {
+        if (i != SLO_WAIT) {
+            len += snprintf(line + len, sizeof(line) - len, "%s%s %.3f ms",
+                            i == 0 ? "" : ", ", phase_names[i], phase_ns[i] / 1e6);
+        }
+    }
+    len += snprintf(line + len, sizeof(line) - len,
+                    "; %.3f ms waiting on children not counted): %s%s (%zu bytes)\n",
+                    phase_ns[SLO_WAIT] / 1e6, input_preview,
+                    input_len > INPUT_PREVIEW ? "..." : "", input_len);
+    if (len >= (int)sizeof(line)) {
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+
+    // One write, so reports from several shells don't interleave
+    if (write(log_fd, line, len) == -1) {
+        // Nothing sensible to do if the log is gone
+    }
+}
+
+// Stop timing the current line and log it if it was over budget
+void slo_line_end(void) {
+    if (!in_line) {
+        return;
+    }
+    slo_set_phase(PHASE_PROMPT);  // Close the running phase
+    in_line = 0;
+
+    uint64_t charged_ns = 0;
+    SloPhase slowest = SLO_HISTORY;
+    for (int i = 0; i < NUM_SLO_PHASES; i++) {
+        if (i == SLO_WAIT) {
+            continue;
+        }
+        charged_ns += phase_ns[i];
+        if (phase_ns[i] > phase_ns[slowest]) {
+            slowest = i;
+        }
+    }
+    if (charged_ns <= budget_ns) {
+        return;
+    }
+
+    trace_instant("slo", phase_names[slowest]);
+    report(charged_ns, slowest);
+}
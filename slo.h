@@ -0,0 +1,27 @@
+#ifndef SLO_H
+#define SLO_H
+
+#include <stddef.h>
+#include "sysacct.h"
+
+// Latency SLO watchdog for shell-internal work
+// With MYSHELL_SLO_MS set (e.g. 5 or 0.5), every input line is timed from
+// the moment it is read until the next prompt, split into phases: history,
+// parse, execute and reaping/cleanup before the next prompt. Time spent
+// waiting on a foreground job is left out. A line whose shell-internal
+// time exceeds the budget is logged with its breakdown and input, to
+// MYSHELL_SLO_LOG (appended) or stderr.
+
+// Enable the watchdog if MYSHELL_SLO_MS is set
+void init_slo(void);
+
+// Start timing a line that was just read
+void slo_line_start(const char *input, size_t len);
+
+// Follow a REPL phase change (called by sysacct_set_phase)
+void slo_set_phase(ReplPhase phase);
+
+// Stop timing the current line and log it if it was over budget
+void slo_line_end(void);
+
+#endif // SLO_H
@@ -0,0 +1,174 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "sysacct.h"
+#include "outbuf.h"
+#include "slo.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <time.h>
+
+typedef struct {
+    unsigned long calls;
+    unsigned long errors;
+    uint64_t ns;
+} SyscallStats;
+
+static const char *const phase_names[NUM_PHASES] = {
+    "prompt", "parse", "execute", "wait",
+};
+
+static const char *const syscall_names[NUM_ACCT_CALLS] = {
+    "dup", "dup2", "open", "close", "pipe", "fork", "waitpid", "tcsetpgrp", "setpgid",
+};
+
+static int enabled = 0;
+static ReplPhase current_phase = PHASE_PROMPT;
+static SyscallStats stats[NUM_PHASES][NUM_ACCT_CALLS];
+static unsigned long commands = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Enable accounting if MYSHELL_SYSCALL_STATS is set
+void init_sysacct(void) {
+    const char *value = getenv("MYSHELL_SYSCALL_STATS");
+    enabled = value && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+void sysacct_enable(int enable) {
+    enabled = enable;
+}
+
+int sysacct_enabled(void) {
+    return enabled;
+}
+
+ReplPhase sysacct_set_phase(ReplPhase phase) {
+    ReplPhase previous = current_phase;
+    current_phase = phase;
+    slo_set_phase(phase);  // Phases also drive the SLO watchdog
+    return previous;
+}
+
+void sysacct_command_done(void) {
+    if (enabled) {
+        commands++;
+    }
+}
+
+uint64_t sysacct_start(void) {
+    return enabled ? now_ns() : 0;
+}
+
+void sysacct_record(AccountedSyscall call, uint64_t start, int failed) {
+    if (!enabled || start == 0) {
+        return;  // Off, or switched on in the middle of the call
+    }
+    SyscallStats *s = &stats[current_phase][call];
+    s->calls++;
+    s->ns += now_ns() - start;
+    if (failed) {
+        s->errors++;
+    }
+}
+
+int sysacct_dup(int fd) {
+    uint64_t start = sysacct_start();
+    int result = dup(fd);
+    sysacct_record(ACCT_DUP, start, result == -1);
+    return result;
+}
+
+int sysacct_dup2(int fd, int fd2) {
+    uint64_t start = sysacct_start();
+    int result = dup2(fd, fd2);
+    sysacct_record(ACCT_DUP2, start, result == -1);
+    return result;
+}
+
+int sysacct_open(const char *path, int flags, mode_t mode) {
+    uint64_t start = sysacct_start();
+    int result = open(path, flags, mode);
+    sysacct_record(ACCT_OPEN, start, result == -1);
+    return result;
+}
+
+int sysacct_close(int fd) {
+    uint64_t start = sysacct_start();
+    int result = close(fd);
+    sysacct_record(ACCT_CLOSE, start, result == -1);
+    return result;
+}
+
+int sysacct_pipe(int fds[2]) {
+    uint64_t start = sysacct_start();
+    int result = pipe(fds);
+    sysacct_record(ACCT_PIPE, start, result == -1);
+    return result;
+}
+
+int sysacct_pipe2(int fds[2], int flags) {
+    uint64_t start = sysacct_start();
+    int result = pipe2(fds, flags);
+    sysacct_record(ACCT_PIPE, start, result == -1);
+    return result;
+}
+
+pid_t sysacct_waitpid(pid_t pid, int *status, int options) {
+    uint64_t start = sysacct_start();
+    pid_t result = waitpid(pid, status, options);
+    sysacct_record(ACCT_WAITPID, start, result == -1);
+    return result;
+}
+
+int sysacct_tcsetpgrp(int fd, pid_t pgrp) {
+    uint64_t start = sysacct_start();
+    int result = tcsetpgrp(fd, pgrp);
+    sysacct_record(ACCT_TCSETPGRP, start, result == -1);
+    return result;
+}
+
+int sysacct_setpgid(pid_t pid, pid_t pgid) {
+    uint64_t start = sysacct_start();
+    int result = setpgid(pid, pgid);
+    sysacct_record(ACCT_SETPGID, start, result == -1);
+    return result;
+}
+
+// Print the counts per phase and call
+void sysacct_report(void) {
+    out_printf("syscall accounting %s, %lu commands\n", enabled ? "on" : "off", commands);
+    out_printf("%-8s %-10s %10s %8s %12s %10s %10s\n",
+               "phase", "syscall", "calls", "errors", "total us", "avg ns", "per cmd");
+
+    unsigned long total_calls = 0;
+    uint64_t total_ns = 0;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        for (int c = 0; c < NUM_ACCT_CALLS; c++) {
+            const SyscallStats *s = &stats[p][c];
+            if (s->calls == 0) {
+                continue;
+            }
+            out_printf("%-8s %-10s %10lu %8lu %12.1f %10.0f %10.2f\n",
+                       phase_names[p], syscall_names[c], s->calls, s->errors, s->ns / 1e3,
+                       (double)s->ns / s->calls, commands ? (double)s->calls / commands : 0.0);
+            total_calls += s->calls;
+            total_ns += s->ns;
+        }
+    }
+    out_printf("%-8s %-10s %10lu %8s %12.1f %10.0f %10.2f\n", "total", "", total_calls, "",
+               total_ns / 1e3, total_calls ? (double)total_ns / total_calls : 0.0,
+               commands ? (double)total_calls / commands : 0.0);
+}
+
+// Clear all counts
+void sysacct_reset(void) {
+    memset(stats, 0, sizeof(stats));
+    commands = 0;
+}
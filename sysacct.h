@@ -0,0 +1,73 @@
+#ifndef SYSACCT_H
+#define SYSACCT_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// System call accounting for the shell process itself
+// The shell's own job-control and fd-juggling calls go through the
+// wrappers below, which count and time them per REPL phase when
+// accounting is on (MYSHELL_SYSCALL_STATS=1 or "syscalls on"); otherwise
+// they are plain calls. Calls made in forked children are not counted.
+
+typedef enum {
+    PHASE_PROMPT,          // Reaping, job cleanup and prompt before reading input
+    PHASE_PARSE,           // Tokenize and parse
+    PHASE_EXECUTE,         // Launching: forks, pipes, redirections, builtins
+    PHASE_WAIT,            // Waiting for a foreground job
+    NUM_PHASES
+} ReplPhase;
+
+typedef enum {
+    ACCT_DUP,
+    ACCT_DUP2,
+    ACCT_OPEN,
+    ACCT_CLOSE,
+    ACCT_PIPE,
+    ACCT_FORK,
+    ACCT_WAITPID,
+    ACCT_TCSETPGRP,
+    ACCT_SETPGID,
+    NUM_ACCT_CALLS
+} AccountedSyscall;
+
+// Enable accounting if MYSHELL_SYSCALL_STATS is set
+void init_sysacct(void);
+
+// Turn accounting on or off
+void sysacct_enable(int enable);
+
+// Set the current REPL phase; returns the previous one
+ReplPhase sysacct_set_phase(ReplPhase phase);
+
+// Count one input line (for per-command averages)
+void sysacct_command_done(void);
+
+// Time a call that has no wrapper (e.g. fork through cgroup_fork):
+//   uint64_t start = sysacct_start();
+//   ... call ...
+//   sysacct_record(ACCT_FORK, start, failed);
+uint64_t sysacct_start(void);
+void sysacct_record(AccountedSyscall call, uint64_t start, int failed);
+
+// Wrappers with the same signatures and results as the system calls
+int sysacct_dup(int fd);
+int sysacct_dup2(int fd, int fd2);
+int sysacct_open(const char *path, int flags, mode_t mode);
+int sysacct_close(int fd);
+int sysacct_pipe(int fds[2]);
+int sysacct_pipe2(int fds[2], int flags);
+pid_t sysacct_waitpid(pid_t pid, int *status, int options);
+int sysacct_tcsetpgrp(int fd, pid_t pgrp);
+int sysacct_setpgid(pid_t pid, pid_t pgid);
+
+// Print the counts per phase and call (to the builtin output buffer)
+void sysacct_report(void);
+
+// Clear all counts
+void sysacct_reset(void);
+
+// Returns 1 if accounting is on
+int sysacct_enabled(void);
+
+#endif // SYSACCT_H
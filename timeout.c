@@ -0,0 +1,124 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "timeout.h"
+#include "eventloop.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+
+// Parse a duration into milliseconds
+int parse_duration(const char *str, long *ms) {
+    char *end;
+    double value = strtod(str, &end);
+    if (end == str || value < 0) {
+        return -1;
+    }
+
+    double scale = 1000;
+    if (*end != '\0') {
+        switch (*end) {
+            case 's': scale = 1000; break;
+            case 'm': scale = 60 * 1000; break;
+            case 'h': scale = 60 * 60 * 1000; break;
+            case 'd': scale = 24 * 60 * 60 * 1000; break;
+            default: return -1;
+        }
+        if (end[1] != '\0') {
+            return -1;
+        }
+    }
+
+    double total = value * scale;
+    if (total > (double)LONG_MAX / 2) {
+        return -1;
+    }
+    *ms = (long)total;
+    if (*ms == 0 && value > 0) {
+        *ms = 1;  // Round tiny deadlines up rather than disabling them
+    }
+    return 0;
+}
+
+// Arm a one-shot timer
+static int arm_timer(int fd, long ms) {
+    struct itimerspec spec = {0};
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    return timerfd_settime(fd, 0, &spec, NULL);
+}
+
+// Timer expired: signal the job, then escalate to SIGKILL after the grace period
+static void on_job_timeout(int fd, void *data) {
+    Job *job = data;
+
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) == -1) {
+        return;  // Spurious wakeup
+    }
+
+    if (!job->timed_out) {
+        job->timed_out = 1;
+        signal_job(job, job->launch.timeout_signal);
+        // Let a stopped job see the signal (as coreutils timeout does)
+        signal_job(job, SIGCONT);
+
+        if (job->launch.kill_after_ms > 0 && arm_timer(fd, job->launch.kill_after_ms) == 0) {
+            return;
+        }
+    } else {
+        signal_job(job, SIGKILL);
+    }
+
+    job_timeout_stop(job);
+}
+
+// Arm the job's deadline
+int job_timeout_start(Job *job) {
+    job->timer_fd = 0;
+    if (job->launch.timeout_ms <= 0) {
+        return 0;
+    }
+
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) {
+        perror("myshell: timerfd_create");
+        return -1;
+    }
+    if (arm_timer(fd, job->launch.timeout_ms) == -1 ||
+        event_add_fd(fd, on_job_timeout, job) == -1) {
+        perror("myshell: timeout");
+        close(fd);
+        return -1;
+    }
+
+    job->timer_fd = fd;
+    return 0;
+}
+
+// Hand a running deadline over to another Job structure
+void job_timeout_move(Job *from, Job *to) {
+    to->timer_fd = from->timer_fd;
+    to->timed_out = from->timed_out;
+    from->timer_fd = 0;
+
+    if (to->timer_fd > 0) {
+        // Re-register so the callback gets the new structure
+        event_remove_fd(to->timer_fd);
+        if (event_add_fd(to->timer_fd, on_job_timeout, to) == -1) {
+            close(to->timer_fd);
+            to->timer_fd = 0;
+        }
+    }
+}
+
+// Disarm the job's deadline
+void job_timeout_stop(Job *job) {
+    if (job->timer_fd > 0) {
+        event_remove_fd(job->timer_fd);
+        close(job->timer_fd);
+    }
+    job->timer_fd = 0;
+}
@@ -0,0 +1,25 @@
+#ifndef TIMEOUT_H
+#define TIMEOUT_H
+
+#include "jobs.h"
+
+// Exit status of a job killed by its deadline (as coreutils timeout)
+#define TIMEOUT_STATUS 124
+
+// Parse a duration such as "10", "1.5s", "2m", "1h" or "1d" into milliseconds
+// Returns 0 on success, -1 if it is not a valid duration
+int parse_duration(const char *str, long *ms);
+
+// Arm the job's deadline (job->launch.timeout_ms) as a timerfd in the
+// event loop; does nothing if the job has no deadline
+// Returns 0 on success, -1 on error
+int job_timeout_start(Job *job);
+
+// Hand a running deadline over to another Job structure (a stopped
+// foreground job moving into the job table)
+void job_timeout_move(Job *from, Job *to);
+
+// Disarm the job's deadline and close its timer
+void job_timeout_stop(Job *job);
+
+#endif // TIMEOUT_H
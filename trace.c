@@ -0,0 +1,298 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "trace.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define TRACE_BUFFER_EVENTS 16384  // Per thread (power of two)
+#define TRACE_ARG_SIZE 64
+#define TRACE_FLUSH_MS 100         // How often the flush thread drains buffers
+
+typedef struct {
+    double ts;             // Microseconds (CLOCK_MONOTONIC)
+    const char *name;      // String literal
+    long id;               // Async events only
+    pid_t pid;
+    pid_t tid;
+    char phase;            // 'B', 'E', 'i', 'b' or 'e'
+    char arg[TRACE_ARG_SIZE];
+} TraceEvent;
+
+// Single-producer single-consumer ring: the owning thread appends at head,
+// the flush thread consumes from tail
+typedef struct TraceBuffer {
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+    atomic_size_t head;
+    atomic_size_t tail;
+    struct TraceBuffer *next;  // Registry of all buffers
+} TraceBuffer;
+
+static int tracing = 0;
+static int direct = 0;         // Forked child: write events immediately
+static int trace_fd = -1;
+static pid_t trace_pid;        // Process that owns the flush thread
+
+static _Atomic(TraceBuffer *) buffers = NULL;
+static _Thread_local TraceBuffer *local_buffer = NULL;
+static _Thread_local pid_t local_tid = 0;
+static atomic_long dropped = 0;
+
+static pthread_t flush_thread;
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_wakeup = PTHREAD_COND_INITIALIZER;
+static int flush_stop = 0;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Write all of buf (the file is O_APPEND, so whole writes never interleave
+// with a child's)
+static void write_out(const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(trace_fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+// Format one event as ",\n{...}"
+// Returns the number of bytes written into buf
+static int format_event(const TraceEvent *ev, char *buf, size_t size) {
+    int len = snprintf(buf, size, ",\n{\"name\":\"%s\",\"cat\":\"myshell\",\"ph\":\"%c\","
+                       "\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+                       ev->name, ev->phase, ev->ts, (int)ev->pid, (int)ev->tid);
+    if (ev->phase == 'b' || ev->phase == 'e') {
+        len += snprintf(buf + len, size - len, ",\"id\":%ld", ev->id);
+    } else if (ev->phase == 'i') {
+        len += snprintf(buf + len, size - len, ",\"s\":\"t\"");
+    }
+
+    if (ev->arg[0] != '\0') {
+        len += snprintf(buf + len, size - len, ",\"args\":{\"arg\":\"");
+        for (const char *p = ev->arg; *p && (size_t)len < size - 8; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c == '"' || c == '\\') {
+                buf[len++] = '\\';
+                buf[len++] = c;
+            } else if (c < 0x20) {
+                buf[len++] = ' ';
+            } else {
+                buf[len++] = c;
+            }
+        }
+        len += snprintf(buf + len, size - len, "\"}");
+    }
+    len += snprintf(buf + len, size - len, "}");
+    return len;
+}
+
+// Drain every registered buffer into the trace file
+// Only the flush thread (or the exit handler after joining it) calls this
+static void drain_buffers(void) {
+    char out[65536];
+    size_t used = 0;
+
+    for (TraceBuffer *buffer = atomic_load(&buffers); buffer; buffer = buffer->next) {
+        size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        for (; tail != head; tail++) {
+            if (sizeof(out) - used < 512) {
+                write_out(out, used);
+                used = 0;
+            }
+            used += format_event(&buffer->events[tail % TRACE_BUFFER_EVENTS],
+                                 out + used, sizeof(out) - used);
+        }
+        // Hand the slots back to the producer
+        atomic_store_explicit(&buffer->tail, tail, memory_order_release);
+    }
+
+    if (used > 0) {
+        write_out(out, used);
+    }
+}
+
+static void *flush_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&flush_lock);
+    while (!flush_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += TRACE_FLUSH_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&flush_wakeup, &flush_lock, &deadline);
+
+        pthread_mutex_unlock(&flush_lock);
+        drain_buffers();
+        pthread_mutex_lock(&flush_lock);
+    }
+    pthread_mutex_unlock(&flush_lock);
+    return NULL;
+}
+
+// Stop the flush thread, write what is left and close the JSON array
+static void finish_trace(void) {
+    if (!tracing || direct) {
+        return;  // Forked children leave the file to the shell
+    }
+
+    pthread_mutex_lock(&flush_lock);
+    flush_stop = 1;
+    pthread_cond_signal(&flush_wakeup);
+    pthread_mutex_unlock(&flush_lock);
+    pthread_join(flush_thread, NULL);
+
+    drain_buffers();
+    long lost = atomic_load(&dropped);
+    if (lost > 0) {
+        char buf[256];
+        int len = snprintf(buf, sizeof(buf),
+                           ",\n{\"name\":\"trace_events_dropped\",\"ph\":\"i\",\"s\":\"g\","
+                           "\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"count\":%ld}}",
+                           now_us(), (int)trace_pid, (int)trace_pid, lost);
+        write_out(buf, len);
+    }
+    write_out("\n]\n", 3);
+    close(trace_fd);
+    tracing = 0;
+}
+
+// Start tracing if MYSHELL_TRACE_FILE is set
+void init_trace(void) {
+    const char *path = getenv("MYSHELL_TRACE_FILE");
+    if (path == NULL || path[0] == '\0') {
+        return;
+    }
+
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (trace_fd == -1) {
+        fprintf(stderr, "myshell: MYSHELL_TRACE_FILE: %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    trace_pid = getpid();
+    char header[256];
+    int len = snprintf(header, sizeof(header),
+                       "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                       "\"args\":{\"name\":\"myshell\"}}",
+                       (int)trace_pid, (int)trace_pid);
+    write_out(header, len);
+
+    int err = pthread_create(&flush_thread, NULL, flush_main, NULL);
+    if (err != 0) {
+        fprintf(stderr, "myshell: trace: %s\n", strerror(err));
+        close(trace_fd);
+        trace_fd = -1;
+        return;
+    }
+
+    tracing = 1;
+    atexit(finish_trace);
+}
+
+// Append an event to this thread's buffer (or the file, in a child)
+static void record(char phase, const char *name, long id, const char *arg) {
+    TraceEvent ev;
+    ev.ts = now_us();
+    ev.name = name;
+    ev.id = id;
+    ev.pid = trace_pid;
+    if (local_tid == 0) {
+        local_tid = gettid();
+    }
+    ev.tid = local_tid;
+    ev.phase = phase;
+    snprintf(ev.arg, sizeof(ev.arg), "%s", arg ? arg : "");
+
+    if (direct) {
+        char buf[512];
+        int len = format_event(&ev, buf, sizeof(buf));
+        write_out(buf, len);
+        return;
+    }
+
+    TraceBuffer *buffer = local_buffer;
+    if (buffer == NULL) {
+        buffer = calloc(1, sizeof(TraceBuffer));
+        if (buffer == NULL) {
+            atomic_fetch_add(&dropped, 1);
+            return;
+        }
+        // Lock-free push onto the registry
+        buffer->next = atomic_load(&buffers);
+        while (!atomic_compare_exchange_weak(&buffers, &buffer->next, buffer)) {
+            // buffer->next now holds the current head - retry
+        }
+        local_buffer = buffer;
+    }
+
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+    if (head - tail == TRACE_BUFFER_EVENTS) {
+        atomic_fetch_add(&dropped, 1);  // Full - never block the shell
+        return;
+    }
+    buffer->events[head % TRACE_BUFFER_EVENTS] = ev;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+void trace_begin(const char *name, const char *arg) {
+    if (tracing) {
+        record('B', name, 0, arg);
+    }
+}
+
+void trace_end(const char *name) {
+    if (tracing) {
+        record('E', name, 0, NULL);
+    }
+}
+
+void trace_instant(const char *name, const char *arg) {
+    if (tracing) {
+        record('i', name, 0, arg);
+    }
+}
+
+void trace_async_begin(const char *name, long id, const char *arg) {
+    if (tracing) {
+        record('b', name, id, arg);
+    }
+}
+
+void trace_async_end(const char *name, long id, const char *arg) {
+    if (tracing) {
+        record('e', name, id, arg);
+    }
+}
+
+int trace_fileno(void) {
+    return tracing ? trace_fd : -1;
+}
+
+// Switch a forked child to direct writes
+void trace_after_fork(void) {
+    if (!tracing) {
+        return;
+    }
+    direct = 1;
+    trace_pid = getpid();
+    local_tid = trace_pid;
+}
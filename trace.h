@@ -0,0 +1,34 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Event tracing in Chrome trace format (chrome://tracing, ui.perfetto.dev)
+// Enabled by setting MYSHELL_TRACE_FILE to the output path at startup.
+// Events are recorded into a per-thread ring buffer without locks and
+// written out by a background thread; when tracing is off every call
+// returns immediately.
+// Names must be string literals (they are stored by pointer); args are
+// copied and may be truncated.
+
+// Start tracing if MYSHELL_TRACE_FILE is set
+void init_trace(void);
+
+// Duration events: begin/end pairs must nest on each thread
+void trace_begin(const char *name, const char *arg);
+void trace_end(const char *name);
+
+// Point-in-time event
+void trace_instant(const char *name, const char *arg);
+
+// Spans that start and end in different places (e.g. a child process from
+// fork to reap), matched by id
+void trace_async_begin(const char *name, long id, const char *arg);
+void trace_async_end(const char *name, long id, const char *arg);
+
+// File descriptor of the trace file, or -1 when tracing is off
+int trace_fileno(void);
+
+// Call in a forked child: there is no flush thread in the child, so its
+// events (e.g. exec) are written to the trace file directly
+void trace_after_fork(void);
+
+#endif // TRACE_H
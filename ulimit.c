@@ -0,0 +1,249 @@
+// Feature test macros must be defined before any includes
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "ulimit.h"
+#include "outbuf.h"
+#include "utils.h"
+
+// Resource table: option letter, resource, unit (bytes per value) and label
+typedef struct {
+    char option;
+    int resource;
+    rlim_t unit;
+    const char *label;
+} UlimitResource;
+
+static const UlimitResource resources[] = {
+    { 'R', RLIMIT_RTTIME,     1,    "real-time non-blocking time  (microseconds, -R)" },
+    { 'c', RLIMIT_CORE,       1024, "core file size               (kbytes, -c)" },
+    { 'd', RLIMIT_DATA,       1024, "data seg size                (kbytes, -d)" },
+    { 'e', RLIMIT_NICE,       1,    "scheduling priority                  (-e)" },
+    { 'f', RLIMIT_FSIZE,      1024, "file size                    (kbytes, -f)" },
+    { 'i', RLIMIT_SIGPENDING, 1,    "pending signals                      (-i)" },
+    { 'l', RLIMIT_MEMLOCK,    1024, "max locked memory            (kbytes, -l)" },
+    { 'm', RLIMIT_RSS,        1024, "max memory size              (kbytes, -m)" },
+    { 'n', RLIMIT_NOFILE,     1,    "open files                           (-n)" },
+    { 'q', RLIMIT_MSGQUEUE,   1,    "POSIX message queues          (bytes, -q)" },
+    { 'r', RLIMIT_RTPRIO,     1,    "real-time priority                   (-r)" },
+    { 's', RLIMIT_STACK,      1024, "stack size                   (kbytes, -s)" },
+    { 't', RLIMIT_CPU,        1,    "cpu time                    (seconds, -t)" },
+    { 'u', RLIMIT_NPROC,      1,    "max user processes                   (-u)" },
+    { 'v', RLIMIT_AS,         1024, "virtual memory               (kbytes, -v)" },
+    { 'x', RLIMIT_LOCKS,      1,    "file locks                           (-x)" },
+};
+
+#define NUM_RESOURCES (sizeof(resources) / sizeof(resources[0]))
+
+static const UlimitResource *find_by_option(char option) {
+    for (size_t i = 0; i < NUM_RESOURCES; i++) {
+        if (resources[i].option == option) {
+            return &resources[i];
+        }
+    }
+    return NULL;
+}
+
+static const UlimitResource *find_by_resource(int resource) {
+    for (size_t i = 0; i < NUM_RESOURCES; i++) {
+        if (resources[i].resource == resource) {
+            return &resources[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns 1 if word can be a limit value
+static int is_limit_value(const char *word) {
+    if (strcmp(word, "unlimited") == 0 || strcmp(word, "hard") == 0 ||
+        strcmp(word, "soft") == 0) {
+        return 1;
+    }
+    if (*word == '\0') {
+        return 0;
+    }
+    for (const char *p = word; *p; p++) {
+        if (*p < '0' || *p > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parse ulimit options
+int parse_ulimit_args(char **argv, int *index, UlimitArgs *args) {
+    int i = *index;
+    int which = 0;
+
+    memset(args, 0, sizeof(*args));
+
+    while (argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0') {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        }
+
+        const char *opts = argv[i] + 1;
+        i++;
+        for (const char *p = opts; *p; p++) {
+            if (*p == 'H') {
+                which |= ULIMIT_HARD;
+                continue;
+            }
+            if (*p == 'S') {
+                which |= ULIMIT_SOFT;
+                continue;
+            }
+            if (*p == 'a') {
+                args->show_all = 1;
+                continue;
+            }
+
+            const UlimitResource *res = find_by_option(*p);
+            if (!res) {
+                fprintf(stderr, "myshell: ulimit: -%c: invalid option\n", *p);
+                return -1;
+            }
+
+            // The value (if any) follows the last option of a cluster
+            if (p[1] != '\0' || argv[i] == NULL || !is_limit_value(argv[i])) {
+                if (args->num_queries == MAX_ULIMIT_SETTINGS) {
+                    fprintf(stderr, "myshell: ulimit: too many options\n");
+                    return -1;
+                }
+                args->queries[args->num_queries++] = res->resource;
+                continue;
+            }
+
+            if (args->num_settings == MAX_ULIMIT_SETTINGS) {
+                fprintf(stderr, "myshell: ulimit: too many options\n");
+                return -1;
+            }
+            UlimitSetting *setting = &args->settings[args->num_settings++];
+            setting->resource = res->resource;
+            setting->value = 0;
+
+            const char *value = argv[i++];
+            if (strcmp(value, "unlimited") == 0) {
+                setting->kind = ULIMIT_UNLIMITED;
+            } else if (strcmp(value, "hard") == 0) {
+                setting->kind = ULIMIT_CURRENT_HARD;
+            } else if (strcmp(value, "soft") == 0) {
+                setting->kind = ULIMIT_CURRENT_SOFT;
+            } else {
+                errno = 0;
+                unsigned long long n = strtoull(value, NULL, 10);
+                if (errno == ERANGE || (res->unit > 1 && n > (unsigned long long)RLIM_INFINITY / res->unit)) {
+                    fprintf(stderr, "myshell: ulimit: %s: limit out of range\n", value);
+                    return -1;
+                }
+                setting->kind = ULIMIT_VALUE;
+                setting->value = (rlim_t)n * res->unit;
+            }
+        }
+    }
+
+    // Settings change both limits unless -H or -S was given
+    for (int j = 0; j < args->num_settings; j++) {
+        args->settings[j].which = which ? which : (ULIMIT_SOFT | ULIMIT_HARD);
+    }
+    args->which = which ? which : ULIMIT_SOFT;
+
+    *index = i;
+    return 0;
+}
+
+// Apply a setting with prlimit()
+int apply_ulimit(const UlimitSetting *setting, pid_t pid) {
+    struct rlimit current;
+    if (prlimit(pid, setting->resource, NULL, &current) == -1) {
+        perror("myshell: ulimit");
+        return -1;
+    }
+
+    rlim_t value;
+    switch (setting->kind) {
+        case ULIMIT_UNLIMITED:
+            value = RLIM_INFINITY;
+            break;
+        case ULIMIT_CURRENT_HARD:
+            value = current.rlim_max;
+            break;
+        case ULIMIT_CURRENT_SOFT:
+            value = current.rlim_cur;
+            break;
+        default:
+            value = setting->value;
+            break;
+    }
+
+    struct rlimit limit = current;
+    if (setting->which & ULIMIT_SOFT) {
+        limit.rlim_cur = value;
+    }
+    if (setting->which & ULIMIT_HARD) {
+        limit.rlim_max = value;
+    }
+
+    if (prlimit(pid, setting->resource, &limit, NULL) == -1) {
+        const UlimitResource *res = find_by_resource(setting->resource);
+        fprintf(stderr, "myshell: ulimit: -%c: cannot modify limit: %s\n",
+                res ? res->option : '?', strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Print the limit of one resource
+void print_ulimit(int resource, int which, int label) {
+    const UlimitResource *res = find_by_resource(resource);
+    struct rlimit limit;
+    if (!res || getrlimit(resource, &limit) == -1) {
+        return;
+    }
+
+    rlim_t value = (which & ULIMIT_HARD) ? limit.rlim_max : limit.rlim_cur;
+    if (label) {
+        out_printf("%s ", res->label);
+    }
+    if (value == RLIM_INFINITY) {
+        out_printf("unlimited\n");
+    } else {
+        out_printf("%llu\n", (unsigned long long)(value / res->unit));
+    }
+}
+
+// Print every limit
+void print_all_ulimits(int which) {
+    for (size_t i = 0; i < NUM_RESOURCES; i++) {
+        print_ulimit(resources[i].resource, which, 1);
+    }
+}
+
+// Raise the RLIMIT_NOFILE soft limit at startup
+void init_nofile_limit(void) {
+    const char *value = getenv("MYSHELL_NOFILE");
+    if (value == NULL || value[0] == '\0') {
+        return;
+    }
+
+    UlimitSetting setting = { RLIMIT_NOFILE, ULIMIT_SOFT, ULIMIT_CURRENT_HARD, 0 };
+    if (strcmp(value, "max") != 0) {
+        char *end;
+        unsigned long long n = strtoull(value, &end, 10);
+        if (end == value || *end != '\0' || value[0] == '-') {
+            fprintf(stderr, "myshell: MYSHELL_NOFILE: %s: invalid limit\n", value);
+            return;
+        }
+        setting.kind = ULIMIT_VALUE;
+        setting.value = (rlim_t)n;
+
+        // Never above the hard limit
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && setting.value > limit.rlim_max) {
+            setting.value = limit.rlim_max;
+        }
+    }
+
+    apply_ulimit(&setting, 0);
+}
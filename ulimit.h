@@ -0,0 +1,62 @@
+#ifndef ULIMIT_H
+#define ULIMIT_H
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+// Maximum number of limits one ulimit command (or prefix) can set
+#define MAX_ULIMIT_SETTINGS 16
+
+// Which of the two limits a setting applies to
+#define ULIMIT_SOFT 1
+#define ULIMIT_HARD 2
+
+// Value of a limit setting
+typedef enum {
+    ULIMIT_VALUE,          // value (already scaled to the resource's unit)
+    ULIMIT_UNLIMITED,      // RLIM_INFINITY
+    ULIMIT_CURRENT_HARD,   // "hard": the current hard limit
+    ULIMIT_CURRENT_SOFT    // "soft": the current soft limit
+} UlimitKind;
+
+// One limit to change, e.g. "-t 5"
+typedef struct {
+    int resource;          // RLIMIT_*
+    int which;             // ULIMIT_SOFT and/or ULIMIT_HARD
+    UlimitKind kind;
+    rlim_t value;
+} UlimitSetting;
+
+// Parsed ulimit arguments
+typedef struct {
+    UlimitSetting settings[MAX_ULIMIT_SETTINGS];
+    int num_settings;
+    int queries[MAX_ULIMIT_SETTINGS];  // Resources to print
+    int num_queries;
+    int show_all;          // -a
+    int which;             // -H/-S for queries (soft by default)
+} UlimitArgs;
+
+// Parse ulimit options starting at argv[*index]:
+//   [-HS] [-a] [-c|-d|-e|-f|-i|-l|-m|-n|-q|-r|-s|-t|-u|-v|-x|-R [value]] ...
+// Values are numbers in the resource's unit, "unlimited", "hard" or "soft"
+// *index is left at the first word that is neither an option nor a value
+// Returns 0 on success, -1 on error (message already printed)
+int parse_ulimit_args(char **argv, int *index, UlimitArgs *args);
+
+// Apply a setting to a process (0 = the caller) with prlimit()
+// Returns 0 on success, -1 on error (message already printed)
+int apply_ulimit(const UlimitSetting *setting, pid_t pid);
+
+// Print the limit of one resource ("unlimited" or a number in its unit)
+// With label, prefixes the line with a description ("-a" format)
+void print_ulimit(int resource, int which, int label);
+
+// Print every limit ("-a")
+void print_all_ulimits(int which);
+
+// Raise the RLIMIT_NOFILE soft limit at startup
+// MYSHELL_NOFILE=max raises it to the hard limit, MYSHELL_NOFILE=N to N
+void init_nofile_limit(void);
+
+#endif // ULIMIT_H